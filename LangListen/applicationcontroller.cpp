@@ -11,9 +11,12 @@ ApplicationController::ApplicationController(QObject* parent)
     : QObject(parent)
     , m_worker(nullptr)
     , m_workerThread(nullptr)
+    , m_decodeService(nullptr)
     , m_subtitleGenerator(nullptr)
     , m_playbackController(nullptr)
     , m_waveformGenerator(nullptr)
+    , m_logModel(nullptr)
+    , m_jobQueue(nullptr)
     , m_progress(0)
     , m_isProcessing(false)
     , m_modelLoaded(false)
@@ -24,18 +27,40 @@ ApplicationController::ApplicationController(QObject* parent)
     , m_modeType("edit")
     , m_loopSingleSegment(false)
     , m_autoPause(false)
+    , m_streamingTranscription(true)
+    , m_silenceSkipping(true)
+    , m_benchmarkRequested(false)
+    , m_modelCacheHits(0)
+    , m_modelCacheMisses(0)
+    , m_modelLoadTimeMs(0)
     , m_lastSegmentStartTime(0)
     , m_lastSegmentEndTime(0)
 {
+    m_logModel = new LogModel(this);
+    m_decodeService = new AudioDecodeService(this);
+
     m_worker = new WhisperWorker();
+    m_worker->setDecodeService(m_decodeService);
     m_workerThread = new QThread(this);
     m_worker->moveToThread(m_workerThread);
 
     m_subtitleGenerator = new SubtitleGenerator(this);
     m_playbackController = new AudioPlaybackController(this);
     m_waveformGenerator = new WaveformGenerator(this);
+    m_waveformGenerator->setDecodeService(m_decodeService);
+    m_jobQueue = new TranscriptionJobQueue(QString(), this);
+
+    connect(m_decodeService, &AudioDecodeService::logMessage, this, [this](const QString& message) {
+        appendLog(message, "decoder");
+        });
+
+    connect(m_waveformGenerator, &WaveformGenerator::logMessage, this, [this](const QString& message) {
+        appendLog(message, "waveform");
+        });
+    connect(m_jobQueue, &TranscriptionJobQueue::logMessage, this, [this](const QString& message) {
+        appendLog(message, "queue");
+        });
 
-    connect(m_waveformGenerator, &WaveformGenerator::logMessage, this, &ApplicationController::onLogMessage);
     connect(m_waveformGenerator, &WaveformGenerator::loadingCompleted, this, &ApplicationController::onWaveformLoadingCompleted);
 
     connect(m_worker, &WhisperWorker::modelLoaded, this, &ApplicationController::onModelLoaded);
@@ -43,17 +68,28 @@ ApplicationController::ApplicationController(QObject* parent)
     connect(m_worker, &WhisperWorker::transcriptionProgress, this, &ApplicationController::onTranscriptionProgress);
     connect(m_worker, &WhisperWorker::transcriptionCompleted, this, &ApplicationController::onTranscriptionCompleted);
     connect(m_worker, &WhisperWorker::transcriptionFailed, this, &ApplicationController::onTranscriptionFailed);
-    connect(m_worker, &WhisperWorker::logMessage, this, &ApplicationController::onLogMessage);
+    connect(m_worker, &WhisperWorker::transcriptionCancelled, this, &ApplicationController::onTranscriptionCancelled);
+    connect(m_worker, &WhisperWorker::logMessage, this, [this](const QString& message) {
+        appendLog(message, "whisper");
+        });
     connect(m_worker, &WhisperWorker::computeModeDetected, this, &ApplicationController::onComputeModeDetected);
     connect(m_worker, &WhisperWorker::segmentTranscribed, this, &ApplicationController::onSegmentTranscribed);
+    connect(m_worker, &WhisperWorker::modelCacheStatsChanged, this, &ApplicationController::onModelCacheStatsChanged);
 
-    connect(m_subtitleGenerator, &SubtitleGenerator::segmentAdded, this, &ApplicationController::segmentCountChanged);
+    connect(m_subtitleGenerator, &SubtitleGenerator::segmentAdded, this, &ApplicationController::onSubtitleSegmentAdded);
     connect(m_subtitleGenerator, &SubtitleGenerator::segmentUpdated, this, &ApplicationController::segmentUpdated);
     connect(m_subtitleGenerator, &SubtitleGenerator::segmentRemoved, this, &ApplicationController::segmentDeleted);
 
-    m_workerThread->start();
+    // Inference runs alongside playback practice. The priority only covers
+    // this dispatch thread, not whisper's compute threads, so cores are also
+    // kept free of inference while audio plays.
+    m_workerThread->start(QThread::LowPriority);
+    connect(m_playbackController, &AudioPlaybackController::isPlayingChanged, this, [this]() {
+        m_worker->setReservedCores(m_playbackController->isPlaying() ? 2 : 0);
+        });
 
     initializeDefaultModelPath();
+    syncJobQueue();
 
     appendLog("程序启动成功");
     appendLog(QString("模型目录: %1").arg(m_modelBasePath));
@@ -62,6 +98,7 @@ ApplicationController::ApplicationController(QObject* parent)
 ApplicationController::~ApplicationController()
 {
     if (m_workerThread) {
+        m_worker->requestCancel();
         m_workerThread->quit();
         m_workerThread->wait();
     }
@@ -74,6 +111,14 @@ void ApplicationController::setAudioPath(const QString& path)
     if (m_audioPath != path) {
         m_audioPath = path;
         emit audioPathChanged();
+
+        if (!m_audioPath.isEmpty()) {
+            m_decodeService->prefetch(m_audioPath);
+        }
+        else {
+            m_decodeService->release();
+        }
+
         checkAndLoadSubtitleFile();
     }
 }
@@ -85,6 +130,7 @@ void ApplicationController::setModelType(const QString& type)
         m_modelLoaded = false;
         emit modelTypeChanged();
         appendLog(QString("切换模型类型为: %1").arg(type));
+        syncJobQueue();
     }
 }
 
@@ -94,6 +140,7 @@ void ApplicationController::setModelBasePath(const QString& path)
         m_modelBasePath = path;
         emit modelBasePathChanged();
         appendLog(QString("设置模型目录: %1").arg(path));
+        syncJobQueue();
     }
 }
 
@@ -128,6 +175,25 @@ void ApplicationController::setAutoPause(bool enabled)
     }
 }
 
+void ApplicationController::setStreamingTranscription(bool enabled)
+{
+    if (m_streamingTranscription != enabled) {
+        m_streamingTranscription = enabled;
+        emit streamingTranscriptionChanged();
+        appendLog(enabled ? "已启用流式转写" : "已关闭流式转写");
+    }
+}
+
+void ApplicationController::setSilenceSkipping(bool enabled)
+{
+    if (m_silenceSkipping != enabled) {
+        m_silenceSkipping = enabled;
+        emit silenceSkippingChanged();
+        appendLog(enabled ? "已启用静音跳过" : "已关闭静音跳过");
+        syncJobQueue();
+    }
+}
+
 QString ApplicationController::getModelPath() const
 {
     if (m_modelBasePath.isEmpty()) {
@@ -169,6 +235,14 @@ void ApplicationController::setCurrentStatus(const QString& status)
     }
 }
 
+void ApplicationController::syncJobQueue()
+{
+    TranscriptionOptions options;
+    options.skipSilence = m_silenceSkipping;
+    m_jobQueue->setTranscriptionOptions(options);
+    m_jobQueue->setModelPath(getModelPath());
+}
+
 void ApplicationController::initializeDefaultModelPath()
 {
     QStringList candidatePaths;
@@ -393,17 +467,46 @@ void ApplicationController::startOneClickTranscription()
     emit progressChanged();
 
     m_subtitleGenerator->clearSegments();
+    m_playbackController->setSubtitles(QVector<SubtitleSegment>());
     emit segmentCountChanged();
 
     m_resultText.clear();
     emit resultTextChanged();
 
+    // Done on the UI thread before any work is queued, so a cancel during
+    // model loading still stops the transcription that follows.
+    m_worker->resetCancel();
+
     setCurrentStatus("正在加载模型...");
     appendLog("开始一键转写流程");
 
     loadModelAsync();
 }
 
+void ApplicationController::startTranscriptionBenchmark()
+{
+    m_benchmarkRequested = true;
+    startOneClickTranscription();
+
+    if (!m_isProcessing) {
+        m_benchmarkRequested = false;
+    }
+    else {
+        appendLog("基准测试模式：并行转写后将重跑单次调用以对比耗时");
+    }
+}
+
+void ApplicationController::cancelTranscription()
+{
+    if (!m_isProcessing || m_worker->isCancelRequested()) {
+        return;
+    }
+
+    m_worker->requestCancel();
+    setCurrentStatus("正在取消...");
+    appendLog("请求取消转写");
+}
+
 void ApplicationController::loadModelAsync()
 {
     QString modelPath = getModelPath();
@@ -416,15 +519,24 @@ void ApplicationController::loadModelAsync()
 
 void ApplicationController::startTranscriptionAsync()
 {
-    QMetaObject::invokeMethod(m_worker, [this]() {
-        m_worker->transcribe(m_audioPath);
+    TranscriptionOptions options;
+    options.streaming = m_streamingTranscription && !m_benchmarkRequested;
+    options.skipSilence = m_silenceSkipping;
+    options.benchmark = m_benchmarkRequested;
+    // A benchmark run must infer the whole file to be comparable.
+    options.journal = !m_benchmarkRequested;
+    m_benchmarkRequested = false;
+
+    QString audioPath = m_audioPath;
+    QMetaObject::invokeMethod(m_worker, [this, audioPath, options]() {
+        m_worker->setTranscriptionOptions(options);
+        m_worker->transcribe(audioPath);
         }, Qt::QueuedConnection);
 }
 
 void ApplicationController::clearLog()
 {
-    m_logText.clear();
-    emit logTextChanged();
+    m_logModel->clear();
     appendLog("日志已清空");
 }
 
@@ -584,16 +696,14 @@ bool ApplicationController::addSegment(qint64 startTime, qint64 endTime, const Q
         return false;
     }
 
-    m_subtitleGenerator->addSegment(startTime, endTime, text.trimmed());
-
-    int newIndex = m_subtitleGenerator->segmentCount() - 1;
+    // onSubtitleSegmentAdded() announces the new count.
+    int newIndex = m_subtitleGenerator->addSegment(startTime, endTime, text.trimmed());
     appendLog(QString("新句子已创建 (#%1)").arg(newIndex + 1));
 
     if (m_playbackController) {
         m_playbackController->setSubtitles(m_subtitleGenerator->getAllSegments());
     }
 
-    emit segmentCountChanged();
     return true;
 }
 
@@ -668,7 +778,10 @@ void ApplicationController::onTranscriptionCompleted(const QString& text)
     m_isProcessing = false;
     emit isProcessingChanged();
 
-    m_playbackController->setSubtitles(m_subtitleGenerator->getAllSegments());
+    // Segments already reached playback one by one; only resync if they diverged.
+    if (m_playbackController->subtitleCount() != m_subtitleGenerator->segmentCount()) {
+        m_playbackController->setSubtitles(m_subtitleGenerator->getAllSegments());
+    }
 
     setCurrentStatus("转写完成");
     appendLog(QString("✓ 转写完成！共生成 %1 个字幕段").arg(m_subtitleGenerator->segmentCount()));
@@ -689,9 +802,21 @@ void ApplicationController::onTranscriptionFailed(const QString& error)
     emit showMessage("错误", "转写失败: " + error, true);
 }
 
-void ApplicationController::onLogMessage(const QString& message)
+void ApplicationController::onTranscriptionCancelled(const QString& partialText, int segmentCount)
 {
-    appendLog(message);
+    Q_UNUSED(partialText);
+
+    m_isProcessing = false;
+    emit isProcessingChanged();
+
+    // Keep what was transcribed before the cancel; it is already in the
+    // generator and result text through the per-segment signals.
+    if (m_playbackController->subtitleCount() != m_subtitleGenerator->segmentCount()) {
+        m_playbackController->setSubtitles(m_subtitleGenerator->getAllSegments());
+    }
+
+    setCurrentStatus("已取消");
+    appendLog(QString("转写已取消，保留已生成的 %1 个字幕段").arg(segmentCount));
 }
 
 void ApplicationController::onComputeModeDetected(const QString& mode, const QString& details)
@@ -744,10 +869,27 @@ void ApplicationController::onSegmentTranscribed(const QString& segmentText)
     }
 }
 
-void ApplicationController::appendLog(const QString& message)
+void ApplicationController::onSubtitleSegmentAdded(int index)
+{
+    // While transcribing, hand each segment to playback as it arrives so the
+    // learner can practice on the finished part.
+    if (m_isProcessing) {
+        m_playbackController->appendSubtitle(m_subtitleGenerator->getSegment(index));
+    }
+
+    emit segmentAdded(index);
+    emit segmentCountChanged();
+}
+
+void ApplicationController::onModelCacheStatsChanged(int hits, int misses, qint64 lastLoadMs)
+{
+    m_modelCacheHits = hits;
+    m_modelCacheMisses = misses;
+    m_modelLoadTimeMs = lastLoadMs;
+    emit modelCacheStatsChanged();
+}
+
+void ApplicationController::appendLog(const QString& message, const QString& source)
 {
-    QString timestamp = QDateTime::currentDateTime().toString("hh:mm:ss");
-    QString logEntry = QString("[%1] %2\n").arg(timestamp, message);
-    m_logText += logEntry;
-    emit logTextChanged();
+    m_logModel->append(message, source);
 }
\ No newline at end of file
@@ -8,6 +8,9 @@
 #include "subtitlegenerator.h"
 #include "audioplaybackcontroller.h"
 #include "waveformgenerator.h"
+#include "audiodecodeservice.h"
+#include "logmodel.h"
+#include "transcriptionjobqueue.h"
 
 class ApplicationController : public QObject
 {
@@ -16,7 +19,7 @@ class ApplicationController : public QObject
         Q_PROPERTY(QString modelType READ modelType WRITE setModelType NOTIFY modelTypeChanged)
         Q_PROPERTY(QString modelBasePath READ modelBasePath WRITE setModelBasePath NOTIFY modelBasePathChanged)
         Q_PROPERTY(QString resultText READ resultText NOTIFY resultTextChanged)
-        Q_PROPERTY(QString logText READ logText NOTIFY logTextChanged)
+        Q_PROPERTY(LogModel* logModel READ logModel CONSTANT)
         Q_PROPERTY(int progress READ progress NOTIFY progressChanged)
         Q_PROPERTY(bool isProcessing READ isProcessing NOTIFY isProcessingChanged)
         Q_PROPERTY(bool modelLoaded READ modelLoaded NOTIFY modelLoadedChanged)
@@ -26,9 +29,15 @@ class ApplicationController : public QObject
         Q_PROPERTY(bool hasSubtitles READ hasSubtitles NOTIFY subtitlesLoadedChanged)
         Q_PROPERTY(AudioPlaybackController* playbackController READ playbackController CONSTANT)
         Q_PROPERTY(WaveformGenerator* waveformGenerator READ waveformGenerator CONSTANT)
+        Q_PROPERTY(TranscriptionJobQueue* jobQueue READ jobQueue CONSTANT)
         Q_PROPERTY(QString modeType READ modeType WRITE setModeType NOTIFY modeTypeChanged)
         Q_PROPERTY(bool loopSingleSegment READ loopSingleSegment WRITE setLoopSingleSegment NOTIFY loopSingleSegmentChanged)
         Q_PROPERTY(bool autoPause READ autoPause WRITE setAutoPause NOTIFY autoPauseChanged)
+        Q_PROPERTY(int modelCacheHits READ modelCacheHits NOTIFY modelCacheStatsChanged)
+        Q_PROPERTY(int modelCacheMisses READ modelCacheMisses NOTIFY modelCacheStatsChanged)
+        Q_PROPERTY(qint64 modelLoadTimeMs READ modelLoadTimeMs NOTIFY modelCacheStatsChanged)
+        Q_PROPERTY(bool streamingTranscription READ streamingTranscription WRITE setStreamingTranscription NOTIFY streamingTranscriptionChanged)
+        Q_PROPERTY(bool silenceSkipping READ silenceSkipping WRITE setSilenceSkipping NOTIFY silenceSkippingChanged)
 
 public:
     explicit ApplicationController(QObject* parent = nullptr);
@@ -38,7 +47,7 @@ public:
     QString modelType() const { return m_modelType; }
     QString modelBasePath() const { return m_modelBasePath; }
     QString resultText() const { return m_resultText; }
-    QString logText() const { return m_logText; }
+    LogModel* logModel() const { return m_logModel; }
     int progress() const { return m_progress; }
     bool isProcessing() const { return m_isProcessing; }
     bool modelLoaded() const { return m_modelLoaded; }
@@ -49,6 +58,11 @@ public:
     QString modeType() const { return m_modeType; }
     bool loopSingleSegment() const { return m_loopSingleSegment; }
     bool autoPause() const { return m_autoPause; }
+    bool streamingTranscription() const { return m_streamingTranscription; }
+    bool silenceSkipping() const { return m_silenceSkipping; }
+    int modelCacheHits() const { return m_modelCacheHits; }
+    int modelCacheMisses() const { return m_modelCacheMisses; }
+    qint64 modelLoadTimeMs() const { return m_modelLoadTimeMs; }
 
     void setAudioPath(const QString& path);
     void setModelType(const QString& type);
@@ -56,14 +70,19 @@ public:
     void setModeType(const QString& mode);
     void setLoopSingleSegment(bool enabled);
     void setAutoPause(bool enabled);
+    void setStreamingTranscription(bool enabled);
+    void setSilenceSkipping(bool enabled);
 
     QString getModelPath() const;
 
     AudioPlaybackController* playbackController() const { return m_playbackController; }
     WaveformGenerator* waveformGenerator() const { return m_waveformGenerator; }
+    TranscriptionJobQueue* jobQueue() const { return m_jobQueue; }
 
 public slots:
     void startOneClickTranscription();
+    void startTranscriptionBenchmark();
+    void cancelTranscription();
     void clearLog();
     void clearResult();
 
@@ -92,7 +111,6 @@ signals:
     void modelTypeChanged();
     void modelBasePathChanged();
     void resultTextChanged();
-    void logTextChanged();
     void progressChanged();
     void isProcessingChanged();
     void modelLoadedChanged();
@@ -103,6 +121,9 @@ signals:
     void modeTypeChanged();
     void loopSingleSegmentChanged();
     void autoPauseChanged();
+    void streamingTranscriptionChanged();
+    void silenceSkippingChanged();
+    void modelCacheStatsChanged();
 
     void showMessage(const QString& title, const QString& message, bool isError);
     void subtitleExported(const QString& format, const QString& filePath);
@@ -117,17 +138,20 @@ private slots:
     void onTranscriptionProgress(int progress);
     void onTranscriptionCompleted(const QString& text);
     void onTranscriptionFailed(const QString& error);
-    void onLogMessage(const QString& message);
+    void onTranscriptionCancelled(const QString& partialText, int segmentCount);
     void onComputeModeDetected(const QString& mode, const QString& details);
     void onWaveformLoadingCompleted();
     void onSegmentTranscribed(const QString& segmentText);
+    void onSubtitleSegmentAdded(int index);
+    void onModelCacheStatsChanged(int hits, int misses, qint64 lastLoadMs);
 
 private:
     void initializeDefaultModelPath();
+    void syncJobQueue();
     void loadModelAsync();
     void startTranscriptionAsync();
     void setCurrentStatus(const QString& status);
-    void appendLog(const QString& message);
+    void appendLog(const QString& message, const QString& source = "app");
     void parseSegmentTiming(const QString& segmentText, int64_t& startTime, int64_t& endTime, QString& text);
 
     void checkAndLoadSubtitleFile();
@@ -136,15 +160,17 @@ private:
 
     WhisperWorker* m_worker;
     QThread* m_workerThread;
+    AudioDecodeService* m_decodeService;
     SubtitleGenerator* m_subtitleGenerator;
     AudioPlaybackController* m_playbackController;
     WaveformGenerator* m_waveformGenerator;
+    LogModel* m_logModel;
+    TranscriptionJobQueue* m_jobQueue;
 
     QString m_audioPath;
     QString m_modelType;
     QString m_modelBasePath;
     QString m_resultText;
-    QString m_logText;
     int m_progress;
     bool m_isProcessing;
     bool m_modelLoaded;
@@ -153,6 +179,12 @@ private:
     QString m_modeType;
     bool m_loopSingleSegment;
     bool m_autoPause;
+    bool m_streamingTranscription;
+    bool m_silenceSkipping;
+    bool m_benchmarkRequested;
+    int m_modelCacheHits;
+    int m_modelCacheMisses;
+    qint64 m_modelLoadTimeMs;
 
     int64_t m_lastSegmentStartTime;
     int64_t m_lastSegmentEndTime;
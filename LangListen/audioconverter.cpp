@@ -10,6 +10,9 @@ AudioConverter::AudioConverter(QObject* parent)
     , m_codecContext(nullptr)
     , m_swrContext(nullptr)
     , m_audioStreamIndex(-1)
+    , m_outputSampleRate(0)
+    , m_sourceDurationMs(0)
+    , m_cancelFlag(nullptr)
 {
 }
 
@@ -43,6 +46,14 @@ void AudioConverter::cleanup()
     m_audioStreamIndex = -1;
 }
 
+bool AudioConverter::probe(const QString& inputPath)
+{
+    cleanup();
+    const bool ok = openInputFile(inputPath);
+    cleanup();
+    return ok;
+}
+
 bool AudioConverter::openInputFile(const QString& inputPath)
 {
     QFileInfo fileInfo(inputPath);
@@ -81,6 +92,17 @@ bool AudioConverter::openInputFile(const QString& inputPath)
         return false;
     }
 
+    AVStream* audioStream = m_formatContext->streams[m_audioStreamIndex];
+    if (audioStream->duration != AV_NOPTS_VALUE) {
+        m_sourceDurationMs = av_rescale_q(audioStream->duration, audioStream->time_base, { 1, 1000 });
+    }
+    else if (m_formatContext->duration != AV_NOPTS_VALUE) {
+        m_sourceDurationMs = m_formatContext->duration / 1000;
+    }
+    else {
+        m_sourceDurationMs = 0;
+    }
+
     return true;
 }
 
@@ -128,6 +150,8 @@ bool AudioConverter::initResampler(const ConversionParams& params)
 {
     int ret;
 
+    m_outputSampleRate = params.targetSampleRate > 0 ? params.targetSampleRate : m_codecContext->sample_rate;
+
     m_swrContext = swr_alloc();
     if (!m_swrContext) {
         m_lastError = "Failed to allocate resampler";
@@ -145,7 +169,7 @@ bool AudioConverter::initResampler(const ConversionParams& params)
     av_opt_set_sample_fmt(m_swrContext, "in_sample_fmt", m_codecContext->sample_fmt, 0);
 
     av_opt_set_chlayout(m_swrContext, "out_chlayout", &outChannelLayout, 0);
-    av_opt_set_int(m_swrContext, "out_sample_rate", params.targetSampleRate, 0);
+    av_opt_set_int(m_swrContext, "out_sample_rate", m_outputSampleRate, 0);
     av_opt_set_sample_fmt(m_swrContext, "out_sample_fmt", params.targetFormat, 0);
 
     ret = swr_init(m_swrContext);
@@ -158,7 +182,7 @@ bool AudioConverter::initResampler(const ConversionParams& params)
 
     emit logMessage(QString("Resampler initialized: %1Hz → %2Hz, %3 → %4 channels")
         .arg(m_codecContext->sample_rate)
-        .arg(params.targetSampleRate)
+        .arg(m_outputSampleRate)
         .arg(m_codecContext->ch_layout.nb_channels)
         .arg(params.targetChannels));
 
@@ -167,108 +191,172 @@ bool AudioConverter::initResampler(const ConversionParams& params)
 
 void AudioConverter::emitProgress(int64_t current, int64_t total)
 {
-    if (total > 0) {
+    if (total > 0 && current != AV_NOPTS_VALUE) {
         int progress = static_cast<int>((current * 100) / total);
         emit conversionProgress(progress);
     }
 }
 
-bool AudioConverter::decodeAndResample(std::vector<float>& audioData, const ConversionParams& params)
+bool AudioConverter::deliverSamples(AVFrame* frame, const SampleSink& sink, const ConversionParams& params, std::vector<float>& scratch)
+{
+    int inSamples = frame ? frame->nb_samples : 0;
+    int outSamples = av_rescale_rnd(
+        swr_get_delay(m_swrContext, m_codecContext->sample_rate) + inSamples,
+        m_outputSampleRate,
+        m_codecContext->sample_rate,
+        AV_ROUND_UP
+    );
+
+    if (outSamples <= 0) {
+        return true;
+    }
+
+    uint8_t* outBuffer = nullptr;
+    int outLinesize;
+    if (av_samples_alloc(&outBuffer, &outLinesize, params.targetChannels,
+        outSamples, params.targetFormat, 0) < 0) {
+        m_lastError = "Failed to allocate sample buffer";
+        emit logMessage("Error: " + m_lastError);
+        return false;
+    }
+
+    int convertedSamples = swr_convert(
+        m_swrContext,
+        &outBuffer, outSamples,
+        frame ? (const uint8_t**)frame->data : nullptr, inSamples
+    );
+
+    bool keepGoing = true;
+    if (convertedSamples > 0) {
+        int count = convertedSamples * params.targetChannels;
+
+        if (params.targetFormat == AV_SAMPLE_FMT_FLT) {
+            keepGoing = sink(reinterpret_cast<const float*>(outBuffer), count);
+        }
+        else {
+            scratch.resize(count);
+            int16_t* samples = reinterpret_cast<int16_t*>(outBuffer);
+            for (int i = 0; i < count; i++) {
+                scratch[i] = samples[i] / 32768.0f;
+            }
+            keepGoing = sink(scratch.data(), count);
+        }
+    }
+
+    av_freep(&outBuffer);
+    return keepGoing;
+}
+
+bool AudioConverter::decodeAndResample(const SampleSink& sink, const ConversionParams& params)
 {
     AVPacket* packet = av_packet_alloc();
     AVFrame* frame = av_frame_alloc();
-    AVFrame* resampledFrame = av_frame_alloc();
 
-    if (!packet || !frame || !resampledFrame) {
+    if (!packet || !frame) {
         m_lastError = "Failed to allocate packet/frame";
         emit logMessage("Error: " + m_lastError);
         if (packet) av_packet_free(&packet);
         if (frame) av_frame_free(&frame);
-        if (resampledFrame) av_frame_free(&resampledFrame);
         return false;
     }
 
-    audioData.clear();
+    AVStream* stream = m_formatContext->streams[m_audioStreamIndex];
+    int64_t totalDuration = stream->duration;
+    int64_t totalDelivered = 0;
+    std::vector<float> scratch;
+    bool keepGoing = true;
+
+    const bool ranged = params.startMs > 0 || params.endMs >= 0;
+    const int64_t startFrame = av_rescale(qMax<qint64>(0, params.startMs), m_outputSampleRate, 1000);
+    const int64_t endFrame = params.endMs >= 0 ? av_rescale(params.endMs, m_outputSampleRate, 1000) : -1;
+    const int64_t streamStart = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    int64_t outputFrame = 0;
+    bool positioned = !ranged || params.startMs <= 0;
+    bool rangeComplete = false;
+
+    if (params.startMs > 0) {
+        int64_t target = streamStart + av_rescale_q(params.startMs, { 1, 1000 }, stream->time_base);
+        if (av_seek_frame(m_formatContext, m_audioStreamIndex, target, AVSEEK_FLAG_BACKWARD) >= 0) {
+            avcodec_flush_buffers(m_codecContext);
+        }
+    }
+
+    // The seek lands on an earlier keyframe; the first frame's timestamp tells
+    // where the decoded output starts, after which samples are counted.
+    SampleSink countingSink = [&](const float* samples, int count) {
+        if (!ranged) {
+            totalDelivered += count;
+            return sink(samples, count);
+        }
+
+        const int channels = params.targetChannels;
+        const int64_t frames = count / channels;
+        const int64_t first = qMax<int64_t>(0, startFrame - outputFrame);
+        const int64_t last = endFrame >= 0 ? qMin(frames, endFrame - outputFrame) : frames;
+        outputFrame += frames;
+
+        if (first < last) {
+            totalDelivered += (last - first) * channels;
+            if (!sink(samples + first * channels, static_cast<int>((last - first) * channels))) {
+                return false;
+            }
+        }
 
-    int64_t totalDuration = m_formatContext->streams[m_audioStreamIndex]->duration;
-    int64_t currentPts = 0;
+        if (endFrame >= 0 && outputFrame >= endFrame) {
+            rangeComplete = true;
+            return false;
+        }
+        return true;
+    };
 
-    while (av_read_frame(m_formatContext, packet) >= 0) {
-        if (packet->stream_index == m_audioStreamIndex) {
+    while (keepGoing && av_read_frame(m_formatContext, packet) >= 0) {
+        if (m_cancelFlag && m_cancelFlag->load()) {
+            m_lastError = "Cancelled";
+            keepGoing = false;
+        }
+        else if (packet->stream_index == m_audioStreamIndex) {
             if (avcodec_send_packet(m_codecContext, packet) >= 0) {
-                while (avcodec_receive_frame(m_codecContext, frame) >= 0) {
-                    currentPts = frame->pts;
-                    emitProgress(currentPts, totalDuration);
-
-                    int outSamples = av_rescale_rnd(
-                        swr_get_delay(m_swrContext, m_codecContext->sample_rate) + frame->nb_samples,
-                        params.targetSampleRate,
-                        m_codecContext->sample_rate,
-                        AV_ROUND_UP
-                    );
-
-                    uint8_t* outBuffer = nullptr;
-                    int outLinesize;
-                    av_samples_alloc(&outBuffer, &outLinesize, params.targetChannels,
-                        outSamples, params.targetFormat, 0);
-
-                    int convertedSamples = swr_convert(
-                        m_swrContext,
-                        &outBuffer, outSamples,
-                        (const uint8_t**)frame->data, frame->nb_samples
-                    );
-
-                    if (convertedSamples > 0) {
-                        int16_t* samples = reinterpret_cast<int16_t*>(outBuffer);
-                        for (int i = 0; i < convertedSamples * params.targetChannels; i++) {
-                            audioData.push_back(samples[i] / 32768.0f);
+                while (keepGoing && avcodec_receive_frame(m_codecContext, frame) >= 0) {
+                    if (!positioned) {
+                        int64_t pts = frame->best_effort_timestamp;
+                        if (pts != AV_NOPTS_VALUE) {
+                            outputFrame = av_rescale_q(pts - streamStart, stream->time_base, { 1, m_outputSampleRate });
                         }
+                        positioned = true;
                     }
-
-                    av_freep(&outBuffer);
+                    emitProgress(frame->pts, totalDuration);
+                    keepGoing = deliverSamples(frame, countingSink, params, scratch);
                 }
             }
         }
         av_packet_unref(packet);
     }
 
-    avcodec_send_packet(m_codecContext, nullptr);
-    while (avcodec_receive_frame(m_codecContext, frame) >= 0) {
-        int outSamples = av_rescale_rnd(
-            swr_get_delay(m_swrContext, m_codecContext->sample_rate) + frame->nb_samples,
-            params.targetSampleRate,
-            m_codecContext->sample_rate,
-            AV_ROUND_UP
-        );
-
-        uint8_t* outBuffer = nullptr;
-        int outLinesize;
-        av_samples_alloc(&outBuffer, &outLinesize, params.targetChannels,
-            outSamples, params.targetFormat, 0);
-
-        int convertedSamples = swr_convert(
-            m_swrContext,
-            &outBuffer, outSamples,
-            (const uint8_t**)frame->data, frame->nb_samples
-        );
-
-        if (convertedSamples > 0) {
-            int16_t* samples = reinterpret_cast<int16_t*>(outBuffer);
-            for (int i = 0; i < convertedSamples * params.targetChannels; i++) {
-                audioData.push_back(samples[i] / 32768.0f);
-            }
+    if (keepGoing) {
+        avcodec_send_packet(m_codecContext, nullptr);
+        while (keepGoing && avcodec_receive_frame(m_codecContext, frame) >= 0) {
+            keepGoing = deliverSamples(frame, countingSink, params, scratch);
         }
+    }
 
-        av_freep(&outBuffer);
+    if (keepGoing) {
+        keepGoing = deliverSamples(nullptr, countingSink, params, scratch);
     }
 
     av_packet_free(&packet);
     av_frame_free(&frame);
-    av_frame_free(&resampledFrame);
 
-    emit logMessage(QString("Decoded %1 samples").arg(audioData.size()));
+    emit logMessage(QString("Decoded %1 samples").arg(totalDelivered));
 
-    return true;
+    if (rangeComplete) {
+        return true;
+    }
+
+    if (!keepGoing && m_lastError.isEmpty()) {
+        m_lastError = "Decoding stopped by consumer";
+    }
+
+    return keepGoing;
 }
 
 bool AudioConverter::writeWavFile(const QString& outputPath, const std::vector<float>& audioData, const ConversionParams& params)
@@ -284,7 +372,7 @@ bool AudioConverter::writeWavFile(const QString& outputPath, const std::vector<f
     uint32_t fileSize = dataSize + 36;
     uint16_t audioFormat = 1;
     uint16_t numChannels = params.targetChannels;
-    uint32_t sampleRate = params.targetSampleRate;
+    uint32_t sampleRate = m_outputSampleRate;
     uint16_t bitsPerSample = 16;
     uint32_t byteRate = sampleRate * numChannels * bitsPerSample / 8;
     uint16_t blockAlign = numChannels * bitsPerSample / 8;
@@ -318,15 +406,16 @@ bool AudioConverter::writeWavFile(const QString& outputPath, const std::vector<f
     return true;
 }
 
-bool AudioConverter::convertToMemory(const QString& inputPath, std::vector<float>& audioData, const ConversionParams& params)
+bool AudioConverter::convertToSink(const QString& inputPath, const SampleSink& sink, const ConversionParams& params)
 {
     emit conversionStarted();
     emit logMessage(QString("Converting: %1").arg(inputPath));
-    emit logMessage(QString("Target: %1Hz, %2 channel(s)")
-        .arg(params.targetSampleRate)
+    emit logMessage(QString("Target: %1, %2 channel(s)")
+        .arg(params.targetSampleRate > 0 ? QString("%1Hz").arg(params.targetSampleRate) : QString("native rate"))
         .arg(params.targetChannels));
 
     cleanup();
+    m_lastError.clear();
 
     if (!openInputFile(inputPath)) {
         cleanup();
@@ -346,15 +435,38 @@ bool AudioConverter::convertToMemory(const QString& inputPath, std::vector<float
         return false;
     }
 
-    if (!decodeAndResample(audioData, params)) {
+    if (!decodeAndResample(sink, params)) {
         cleanup();
         emit conversionFailed(m_lastError);
         return false;
     }
 
     cleanup();
+    return true;
+}
+
+bool AudioConverter::convertToMemory(const QString& inputPath, std::vector<float>& audioData, const ConversionParams& params)
+{
+    audioData.clear();
+
+    bool reserved = false;
+    SampleSink sink = [&](const float* samples, int count) {
+        if (!reserved && m_sourceDurationMs > 0) {
+            qint64 spanMs = (params.endMs >= 0 ? qMin(params.endMs, m_sourceDurationMs) : m_sourceDurationMs)
+                - qMax<qint64>(0, params.startMs);
+            audioData.reserve(static_cast<size_t>(
+                (qMax<qint64>(0, spanMs) + 1000) * m_outputSampleRate / 1000 * params.targetChannels));
+            reserved = true;
+        }
+        audioData.insert(audioData.end(), samples, samples + count);
+        return true;
+    };
+
+    if (!convertToSink(inputPath, sink, params)) {
+        return false;
+    }
 
-    float duration = audioData.size() / (float)params.targetSampleRate / params.targetChannels;
+    float duration = audioData.size() / (float)m_outputSampleRate / params.targetChannels;
     emit logMessage(QString("Conversion completed: %1 seconds").arg(duration, 0, 'f', 2));
 
     return true;
@@ -4,6 +4,8 @@
 #include <QObject>
 #include <QString>
 #include <vector>
+#include <functional>
+#include <atomic>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -17,15 +19,24 @@ class AudioConverter : public QObject
     Q_OBJECT
 
 public:
+    using SampleSink = std::function<bool(const float* samples, int count)>;
+
+    // targetSampleRate <= 0 keeps the source sample rate. startMs/endMs limit
+    // the output to [startMs, endMs) of the source, trimmed to the sample;
+    // endMs < 0 decodes to the end of the stream.
     struct ConversionParams {
         int targetSampleRate;
         int targetChannels;
         AVSampleFormat targetFormat;
+        qint64 startMs;
+        qint64 endMs;
 
         ConversionParams()
             : targetSampleRate(16000)
             , targetChannels(1)
             , targetFormat(AV_SAMPLE_FMT_S16)
+            , startMs(0)
+            , endMs(-1)
         {
         }
     };
@@ -35,6 +46,15 @@ public:
 
     bool convert(const QString& inputPath, const QString& outputPath, const ConversionParams& params = ConversionParams());
     bool convertToMemory(const QString& inputPath, std::vector<float>& audioData, const ConversionParams& params = ConversionParams());
+    bool convertToSink(const QString& inputPath, const SampleSink& sink, const ConversionParams& params = ConversionParams());
+    // Opens the file without decoding; sourceDurationMs() is valid afterwards.
+    bool probe(const QString& inputPath);
+
+    // Polled once per packet; a raised flag stops decoding with "Cancelled".
+    void setCancelFlag(const std::atomic<bool>* flag) { m_cancelFlag = flag; }
+
+    int outputSampleRate() const { return m_outputSampleRate; }
+    qint64 sourceDurationMs() const { return m_sourceDurationMs; }
 
     QString getLastError() const { return m_lastError; }
     static bool isFFmpegAvailable();
@@ -52,11 +72,15 @@ private:
     AVCodecContext* m_codecContext;
     SwrContext* m_swrContext;
     int m_audioStreamIndex;
+    int m_outputSampleRate;
+    qint64 m_sourceDurationMs;
+    const std::atomic<bool>* m_cancelFlag;
 
     bool openInputFile(const QString& inputPath);
     bool initDecoder();
     bool initResampler(const ConversionParams& params);
-    bool decodeAndResample(std::vector<float>& audioData, const ConversionParams& params);
+    bool decodeAndResample(const SampleSink& sink, const ConversionParams& params);
+    bool deliverSamples(AVFrame* frame, const SampleSink& sink, const ConversionParams& params, std::vector<float>& scratch);
     bool writeWavFile(const QString& outputPath, const std::vector<float>& audioData, const ConversionParams& params);
     void cleanup();
     void emitProgress(int64_t current, int64_t total);
@@ -0,0 +1,393 @@
+﻿#include "audiodecodeservice.h"
+#include "audioconverter.h"
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+extern "C" {
+#include <libswresample/swresample.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+}
+
+DecodedAudio::DecodedAudio(const QString& filePath)
+    : m_filePath(filePath)
+    , m_sampleRate(0)
+    , m_expectedSamples(0)
+    , m_finished(false)
+    , m_success(false)
+    , m_consumers(0)
+    , m_cancelled(false)
+{
+}
+
+DecodedAudio::~DecodedAudio()
+{
+}
+
+int DecodedAudio::sampleRate() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sampleRate;
+}
+
+qint64 DecodedAudio::sampleCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<qint64>(m_samples.size());
+}
+
+qint64 DecodedAudio::durationMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_sampleRate <= 0) {
+        return 0;
+    }
+    return static_cast<qint64>(m_samples.size()) * 1000 / m_sampleRate;
+}
+
+qint64 DecodedAudio::expectedDurationMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_sampleRate <= 0) {
+        return 0;
+    }
+    qint64 samples = m_finished ? static_cast<qint64>(m_samples.size()) : m_expectedSamples;
+    return samples * 1000 / m_sampleRate;
+}
+
+int DecodedAudio::progress() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_finished) {
+        return 100;
+    }
+    if (m_expectedSamples <= 0) {
+        return 0;
+    }
+    return qMin(99, static_cast<int>(static_cast<qint64>(m_samples.size()) * 100 / m_expectedSamples));
+}
+
+bool DecodedAudio::isFinished() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_finished;
+}
+
+bool DecodedAudio::isValid() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_finished && m_success && !m_samples.empty();
+}
+
+QString DecodedAudio::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+bool DecodedAudio::waitForFinished(int timeoutMs) const
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_finished) {
+        if (timeoutMs < 0) {
+            m_finishedCondition.wait(&m_mutex);
+        }
+        else if (!m_finishedCondition.wait(&m_mutex, timeoutMs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DecodedAudio::waitForSamples(qint64 minCount, int timeoutMs) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_finished && static_cast<qint64>(m_samples.size()) < minCount) {
+        m_dataCondition.wait(&m_mutex, timeoutMs);
+    }
+    return static_cast<qint64>(m_samples.size()) >= minCount;
+}
+
+qint64 DecodedAudio::read(qint64 offset, float* dst, qint64 maxCount) const
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 available = static_cast<qint64>(m_samples.size()) - offset;
+    qint64 count = qMin(available, maxCount);
+    if (count <= 0) {
+        return 0;
+    }
+    std::copy(m_samples.begin() + offset, m_samples.begin() + offset + count, dst);
+    return count;
+}
+
+void DecodedAudio::begin(int sampleRate, qint64 expectedSamples)
+{
+    QMutexLocker locker(&m_mutex);
+    m_sampleRate = sampleRate;
+    m_expectedSamples = expectedSamples;
+    m_dataCondition.wakeAll();
+    if (expectedSamples > 0) {
+        // Reserve up front so an hour-long file is not copied on every growth step.
+        m_samples.reserve(static_cast<size_t>(expectedSamples + sampleRate));
+    }
+}
+
+void DecodedAudio::append(const float* data, int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_samples.insert(m_samples.end(), data, data + count);
+    m_dataCondition.wakeAll();
+}
+
+void DecodedAudio::finish(bool success, const QString& error)
+{
+    QMutexLocker locker(&m_mutex);
+    m_success = success;
+    m_error = error;
+    m_finished = true;
+    m_dataCondition.wakeAll();
+    if (m_samples.capacity() > m_samples.size() + static_cast<size_t>(m_sampleRate)) {
+        m_samples.shrink_to_fit();
+    }
+    m_finishedCondition.wakeAll();
+}
+
+bool DecodedAudio::addConsumer()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_cancelled) {
+        return false;
+    }
+    ++m_consumers;
+    return true;
+}
+
+void DecodedAudio::releaseConsumer()
+{
+    QMutexLocker locker(&m_mutex);
+    if (--m_consumers == 0 && !m_finished) {
+        m_cancelled = true;
+    }
+}
+
+void DecodedAudio::cancelIfUnused()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_consumers == 0 && !m_finished) {
+        m_cancelled = true;
+    }
+}
+
+std::shared_ptr<const std::vector<float>> DecodedAudio::resampled(int targetSampleRate) const
+{
+    if (!waitForFinished() || !isValid()) {
+        return nullptr;
+    }
+
+    if (targetSampleRate == m_sampleRate) {
+        return std::shared_ptr<const std::vector<float>>(shared_from_this(), &m_samples);
+    }
+
+    QMutexLocker locker(&m_viewMutex);
+
+    auto it = m_views.find(targetSampleRate);
+    if (it != m_views.end()) {
+        if (auto existing = it->second.lock()) {
+            return existing;
+        }
+    }
+
+    SwrContext* swr = nullptr;
+    AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+    int ret = swr_alloc_set_opts2(&swr,
+        &mono, AV_SAMPLE_FMT_FLT, targetSampleRate,
+        &mono, AV_SAMPLE_FMT_FLT, m_sampleRate,
+        0, nullptr);
+    if (ret < 0 || swr_init(swr) < 0) {
+        swr_free(&swr);
+        return nullptr;
+    }
+
+    auto view = std::make_shared<std::vector<float>>();
+    view->resize(static_cast<size_t>(
+        av_rescale_rnd(m_samples.size(), targetSampleRate, m_sampleRate, AV_ROUND_UP) + 256));
+
+    const int chunkSize = 1 << 16;
+    size_t inPos = 0;
+    size_t outPos = 0;
+
+    while (inPos < m_samples.size()) {
+        int inCount = static_cast<int>(qMin<size_t>(chunkSize, m_samples.size() - inPos));
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(m_samples.data() + inPos);
+        uint8_t* out = reinterpret_cast<uint8_t*>(view->data() + outPos);
+        int converted = swr_convert(swr, &out, static_cast<int>(view->size() - outPos), &in, inCount);
+        if (converted < 0) {
+            swr_free(&swr);
+            return nullptr;
+        }
+        inPos += inCount;
+        outPos += converted;
+    }
+
+    uint8_t* out = reinterpret_cast<uint8_t*>(view->data() + outPos);
+    int flushed = swr_convert(swr, &out, static_cast<int>(view->size() - outPos), nullptr, 0);
+    if (flushed > 0) {
+        outPos += flushed;
+    }
+
+    swr_free(&swr);
+
+    view->resize(outPos);
+    view->shrink_to_fit();
+
+    std::shared_ptr<const std::vector<float>> result = view;
+    m_views[targetSampleRate] = result;
+    return result;
+}
+
+AudioDecodeService::AudioDecodeService(QObject* parent)
+    : QObject(parent)
+    , m_currentSize(0)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+AudioDecodeService::~AudioDecodeService()
+{
+    m_pool.waitForDone();
+}
+
+std::shared_ptr<DecodedAudio> AudioDecodeService::acquire(const QString& filePath)
+{
+    QMutexLocker locker(&m_mutex);
+
+    std::shared_ptr<DecodedAudio> target = start(filePath);
+    if (!target->addConsumer()) {
+        // Its last lease was dropped between start() and here.
+        m_current.reset();
+        target = start(filePath);
+        target->addConsumer();
+    }
+
+    // The lease keeps the decode alive and releases its consumer slot when dropped.
+    return std::shared_ptr<DecodedAudio>(target.get(), [target](DecodedAudio*) {
+        target->releaseConsumer();
+        });
+}
+
+void AudioDecodeService::prefetch(const QString& filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    start(filePath);
+}
+
+std::shared_ptr<DecodedAudio> AudioDecodeService::start(const QString& filePath)
+{
+    QFileInfo fileInfo(filePath);
+
+    if (m_current && !m_current->isCancelled() &&
+        m_current->filePath() == filePath &&
+        m_currentModified == fileInfo.lastModified() &&
+        m_currentSize == fileInfo.size()) {
+        return m_current;
+    }
+
+    // A superseded decode nobody reads from would otherwise hold up the pool.
+    if (m_current) {
+        m_current->cancelIfUnused();
+    }
+
+    auto target = std::make_shared<DecodedAudio>(filePath);
+    m_current = target;
+    m_currentModified = fileInfo.lastModified();
+    m_currentSize = fileInfo.size();
+
+    QtConcurrent::run(&m_pool, [this, target]() {
+        decode(target);
+        });
+
+    return target;
+}
+
+std::shared_ptr<DecodedAudio> AudioDecodeService::current() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_current;
+}
+
+void AudioDecodeService::release()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_current) {
+        m_current->cancelIfUnused();
+    }
+    m_current.reset();
+}
+
+void AudioDecodeService::decode(std::shared_ptr<DecodedAudio> target)
+{
+    if (target->isCancelled()) {
+        target->finish(false, "Cancelled");
+        emit decodeFinished(target->filePath(), false);
+        return;
+    }
+
+    emit decodeStarted(target->filePath());
+    emit logMessage(QString("Decoding audio once for all consumers: %1").arg(target->filePath()));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    AudioConverter converter;
+    connect(&converter, &AudioConverter::logMessage, this, &AudioDecodeService::logMessage, Qt::DirectConnection);
+    converter.setCancelFlag(target->cancelFlag());
+
+    AudioConverter::ConversionParams params;
+    params.targetSampleRate = 0;
+    params.targetChannels = 1;
+    params.targetFormat = AV_SAMPLE_FMT_FLT;
+
+    bool begun = false;
+    AudioConverter::SampleSink sink = [&](const float* samples, int count) {
+        if (!begun) {
+            qint64 expected = converter.sourceDurationMs() * converter.outputSampleRate() / 1000;
+            target->begin(converter.outputSampleRate(), expected);
+            begun = true;
+        }
+        target->append(samples, count);
+        return !target->isCancelled();
+    };
+
+    bool success = converter.convertToSink(target->filePath(), sink, params) && !target->isCancelled();
+    if (success && !begun) {
+        target->begin(converter.outputSampleRate(), 0);
+    }
+
+    const QString error = target->isCancelled() ? QStringLiteral("Cancelled") : converter.getLastError();
+    target->finish(success, success ? QString() : error);
+
+    if (success) {
+        emit logMessage(QString("Decoded %1 samples at %2Hz in %3 ms")
+            .arg(target->sampleCount())
+            .arg(target->sampleRate())
+            .arg(timer.elapsed()));
+    }
+    else {
+        {
+            // Drop the failed entry so the next acquire of the same file retries.
+            QMutexLocker locker(&m_mutex);
+            if (m_current == target) {
+                m_current.reset();
+            }
+        }
+        if (target->isCancelled()) {
+            emit logMessage("Shared decode cancelled: " + target->filePath());
+        }
+        else {
+            emit logMessage("ERROR: Shared decode failed: " + error);
+        }
+    }
+
+    emit decodeFinished(target->filePath(), success);
+}
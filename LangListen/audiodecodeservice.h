@@ -0,0 +1,113 @@
+﻿#ifndef AUDIODECODESERVICE_H
+#define AUDIODECODESERVICE_H
+
+#include <QObject>
+#include <QString>
+#include <QDateTime>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Mono float PCM of one media file at its native sample rate. Filled once by
+// AudioDecodeService and shared (read-only) by transcription and waveform.
+class DecodedAudio : public std::enable_shared_from_this<DecodedAudio>
+{
+public:
+    explicit DecodedAudio(const QString& filePath);
+    ~DecodedAudio();
+
+    QString filePath() const { return m_filePath; }
+    int sampleRate() const;
+    qint64 sampleCount() const;
+    qint64 durationMs() const;
+    qint64 expectedDurationMs() const;
+    int progress() const;
+
+    bool isFinished() const;
+    bool isValid() const;
+    QString errorString() const;
+    bool waitForFinished(int timeoutMs = -1) const;
+
+    // Progressive access while decoding is still running.
+    bool waitForSamples(qint64 minCount, int timeoutMs) const;
+    qint64 read(qint64 offset, float* dst, qint64 maxCount) const;
+
+    // Only valid once finished; the buffer is immutable from then on.
+    const std::vector<float>& samples() const { return m_samples; }
+
+    // Mono view at the requested rate. The native rate aliases samples()
+    // without copying; other rates are resampled once and shared while in use.
+    std::shared_ptr<const std::vector<float>> resampled(int targetSampleRate) const;
+
+    void begin(int sampleRate, qint64 expectedSamples);
+    void append(const float* data, int count);
+    void finish(bool success, const QString& error = QString());
+
+    // Set once nobody needs the samples any more; polled by the decoder.
+    void cancel() { m_cancelled = true; }
+    bool isCancelled() const { return m_cancelled; }
+    const std::atomic<bool>* cancelFlag() const { return &m_cancelled; }
+
+    // Consumers are counted by AudioDecodeService leases. addConsumer fails
+    // once the decode was cancelled; the last release of an unfinished decode
+    // cancels it.
+    bool addConsumer();
+    void releaseConsumer();
+    void cancelIfUnused();
+
+private:
+    QString m_filePath;
+    std::vector<float> m_samples;
+    int m_sampleRate;
+    qint64 m_expectedSamples;
+    bool m_finished;
+    bool m_success;
+    QString m_error;
+    int m_consumers;
+    std::atomic<bool> m_cancelled;
+
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_finishedCondition;
+    mutable QWaitCondition m_dataCondition;
+
+    mutable QMutex m_viewMutex;
+    mutable std::map<int, std::weak_ptr<const std::vector<float>>> m_views;
+};
+
+class AudioDecodeService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AudioDecodeService(QObject* parent = nullptr);
+    ~AudioDecodeService();
+
+    // Returns a lease on the decode of filePath; dropping the last lease of
+    // an unfinished decode cancels it.
+    std::shared_ptr<DecodedAudio> acquire(const QString& filePath);
+    // Starts decoding without holding a lease, e.g. as soon as a file is picked.
+    void prefetch(const QString& filePath);
+    std::shared_ptr<DecodedAudio> current() const;
+    void release();
+
+signals:
+    void decodeStarted(const QString& filePath);
+    void decodeFinished(const QString& filePath, bool success);
+    void logMessage(const QString& message);
+
+private:
+    std::shared_ptr<DecodedAudio> start(const QString& filePath);
+    void decode(std::shared_ptr<DecodedAudio> target);
+
+    mutable QMutex m_mutex;
+    std::shared_ptr<DecodedAudio> m_current;
+    QDateTime m_currentModified;
+    qint64 m_currentSize;
+    QThreadPool m_pool;
+};
+
+#endif
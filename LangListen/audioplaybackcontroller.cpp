@@ -61,6 +61,17 @@ void AudioPlaybackController::setSubtitles(const QVector<SubtitleSegment>& segme
     emit currentSegmentTextChanged();
 }
 
+void AudioPlaybackController::appendSubtitle(const SubtitleSegment& segment)
+{
+    const int index = m_engine->appendSentenceSegment(SentenceSegment(segment.startTime, segment.endTime));
+    m_segments.insert(index, segment);
+
+    if (m_currentSegmentIndex >= 0 && index <= m_currentSegmentIndex) {
+        ++m_currentSegmentIndex;
+        emit currentSegmentIndexChanged();
+    }
+}
+
 void AudioPlaybackController::play()
 {
     if (m_currentSegmentIndex < 0 && !m_segments.isEmpty()) {
@@ -212,6 +223,31 @@ void AudioPlaybackController::setSingleSentenceLoop(bool enabled)
     m_engine->setSingleSentenceLoop(enabled);
 }
 
+QString AudioPlaybackController::runRenderBenchmark()
+{
+    return m_engine->runRenderBenchmark();
+}
+
+QString AudioPlaybackController::runTimeStretchBenchmark()
+{
+    return m_engine->runTimeStretchBenchmark();
+}
+
+QString AudioPlaybackController::runSentenceIndexBenchmark(int sentenceCount)
+{
+    return m_engine->runSentenceIndexBenchmark(sentenceCount);
+}
+
+void AudioPlaybackController::setSegmentCacheBudgetMb(int megabytes)
+{
+    m_engine->setSegmentCacheBudget(static_cast<qint64>(qMax(0, megabytes)) * 1024 * 1024);
+}
+
+void AudioPlaybackController::setSegmentCacheLookahead(int sentences)
+{
+    m_engine->setSegmentCacheLookahead(sentences);
+}
+
 bool AudioPlaybackController::isPlaying() const
 {
     return m_engine->isPlaying();
@@ -33,6 +33,9 @@ public:
 
     Q_INVOKABLE void loadAudio(const QString& filePath);
     Q_INVOKABLE void setSubtitles(const QVector<SubtitleSegment>& segments);
+    // Adds one segment after the existing ones without resetting playback.
+    void appendSubtitle(const SubtitleSegment& segment);
+    int subtitleCount() const { return m_segments.size(); }
     Q_INVOKABLE void play();
     Q_INVOKABLE void pause();
     Q_INVOKABLE void stop();
@@ -47,6 +50,11 @@ public:
 
     Q_INVOKABLE void setAutoPauseEnabled(bool enabled);
     Q_INVOKABLE void setSingleSentenceLoop(bool enabled);
+    Q_INVOKABLE QString runRenderBenchmark();
+    Q_INVOKABLE QString runTimeStretchBenchmark();
+    Q_INVOKABLE QString runSentenceIndexBenchmark(int sentenceCount = 2000);
+    Q_INVOKABLE void setSegmentCacheBudgetMb(int megabytes);
+    Q_INVOKABLE void setSegmentCacheLookahead(int sentences);
 
     void setVolume(qreal volume);
     void setPlaybackRate(qreal rate);
@@ -0,0 +1,417 @@
+﻿#include "audiorenderer.h"
+#include "audioringbuffer.h"
+#include "simd.h"
+#include <QByteArray>
+#include <QMutex>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+AudioRenderer::AudioRenderer()
+    : m_ringBuffer(nullptr)
+    , m_channels(2)
+    , m_targetGain(1.0f)
+    , m_currentGain(1.0f)
+    , m_rate(1.0)
+    , m_position(0)
+    , m_positionFraction(0.0)
+    , m_ringFrame(0)
+    , m_playingClip(false)
+    , m_wraps(0)
+    , m_stopFrame(-1)
+    , m_stopReached(false)
+    , m_resyncFrame(-1)
+    , m_loopClip(nullptr)
+    , m_clipInUse(nullptr)
+    , m_loopEnabled(false)
+    , m_activeLoopStart(-1)
+    , m_activeLoopEnd(-1)
+    , m_blocks(0)
+    , m_starvedBlocks(0)
+    , m_deviceUnderflows(0)
+    , m_lastNs(0)
+    , m_maxNs(0)
+    , m_totalNs(0)
+{
+}
+
+void AudioRenderer::configure(AudioRingBuffer* ringBuffer, int channels)
+{
+    m_ringBuffer = ringBuffer;
+    m_channels = qMax(1, channels);
+    m_currentGain = m_targetGain.load();
+}
+
+void AudioRenderer::setGain(float gain)
+{
+    m_targetGain.store(qBound(0.0f, gain, 1.0f));
+}
+
+void AudioRenderer::setPosition(qint64 frame)
+{
+    m_position.store(frame, std::memory_order_release);
+    m_positionFraction = 0.0;
+    m_ringFrame = frame;
+    m_playingClip = false;
+    m_wraps = 0;
+    m_stopReached = false;
+    m_resyncFrame = -1;
+}
+
+qint64 AudioRenderer::playedPosition(qint64 latencyFrames) const
+{
+    const qint64 position = m_position.load(std::memory_order_acquire);
+    qint64 played = position - latencyFrames;
+
+    const qint64 loopStart = m_activeLoopStart.load(std::memory_order_relaxed);
+    const qint64 loopEnd = m_activeLoopEnd.load(std::memory_order_relaxed);
+    if (m_wraps.load() > 0 && loopStart >= 0 && position >= loopStart && position < loopEnd && played < loopStart) {
+        played += loopEnd - loopStart;
+    }
+
+    return qMax<qint64>(0, played);
+}
+
+void AudioRenderer::preroll(std::shared_ptr<const PcmClip> clip, bool loop)
+{
+    installClip(clip);
+    m_loopEnabled = loop;
+
+    m_position.store(clip->startFrame, std::memory_order_release);
+    m_positionFraction = 0.0;
+    m_ringFrame = clip->endFrame();
+    m_playingClip = true;
+    m_wraps = 0;
+    m_stopReached = false;
+    m_resyncFrame = -1;
+}
+
+void AudioRenderer::setLoopClip(std::shared_ptr<const PcmClip> clip)
+{
+    if (!clip) {
+        m_loopEnabled = false;
+        return;
+    }
+
+    installClip(clip);
+    m_loopEnabled = true;
+}
+
+void AudioRenderer::installClip(std::shared_ptr<const PcmClip> clip)
+{
+    if (clip != m_clipOwner) {
+        if (m_clipOwner) {
+            m_retiredClips.push_back(m_clipOwner);
+        }
+        m_clipOwner = clip;
+        m_loopClip.store(clip.get());
+    }
+
+    releaseRetiredClips();
+}
+
+void AudioRenderer::setStopFrame(qint64 frame)
+{
+    m_stopFrame.store(frame);
+    m_stopReached = false;
+}
+
+void AudioRenderer::releaseRetiredClips()
+{
+    const PcmClip* inUse = m_clipInUse.load();
+    for (auto it = m_retiredClips.begin(); it != m_retiredClips.end();) {
+        if (it->get() != inUse) {
+            it = m_retiredClips.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+const PcmClip* AudioRenderer::acquireClip()
+{
+    // Re-check after announcing: if the owner swapped the clip in between, it
+    // may already have freed the one we loaded.
+    const PcmClip* clip;
+    do {
+        clip = m_loopClip.load();
+        m_clipInUse.store(clip);
+    } while (clip != m_loopClip.load());
+
+    return (clip && clip->channels == m_channels) ? clip : nullptr;
+}
+
+int AudioRenderer::readRing(float* out, int frames)
+{
+    const int bytesPerFrame = m_channels * static_cast<int>(sizeof(float));
+    const int bytesRead = m_ringBuffer ? m_ringBuffer->read(reinterpret_cast<char*>(out), frames * bytesPerFrame) : 0;
+    return bytesRead / bytesPerFrame;
+}
+
+int AudioRenderer::render(float* out, int frames)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const int channels = m_channels;
+    const double rate = m_rate.load(std::memory_order_relaxed);
+    const bool stretched = rate != 1.0;
+    const PcmClip* clip = stretched ? nullptr : acquireClip();
+    const bool looping = clip && m_loopEnabled.load(std::memory_order_relaxed);
+    const qint64 stopFrame = m_stopFrame.load(std::memory_order_relaxed);
+    qint64 position = m_position.load(std::memory_order_relaxed);
+    bool playingClip = m_playingClip.load(std::memory_order_relaxed);
+    bool starved = false;
+    int framesDone = 0;
+
+    m_activeLoopStart.store(clip ? clip->startFrame : -1, std::memory_order_relaxed);
+    m_activeLoopEnd.store(clip ? clip->endFrame() : -1, std::memory_order_relaxed);
+
+    while (framesDone < frames) {
+        if (stopFrame >= 0 && position >= stopFrame) {
+            // Leave a stop frame the owner re-armed meanwhile untouched.
+            qint64 expected = stopFrame;
+            m_stopFrame.compare_exchange_strong(expected, -1);
+            m_stopReached.store(true, std::memory_order_release);
+            break;
+        }
+
+        qint64 want = frames - framesDone;
+        if (stopFrame >= 0) {
+            const qint64 remaining = stretched
+                ? static_cast<qint64>(std::ceil((stopFrame - position - m_positionFraction) / rate))
+                : stopFrame - position;
+            want = qMin(want, qMax<qint64>(1, remaining));
+        }
+
+        float* dst = out + static_cast<qint64>(framesDone) * channels;
+        qint64 got = 0;
+
+        if (playingClip) {
+            if (!clip || position < clip->startFrame || position >= clip->endFrame()) {
+                playingClip = false;
+                continue;
+            }
+            got = qMin(want, clip->endFrame() - position);
+            memcpy(dst, clip->samples.data() + (position - clip->startFrame) * channels,
+                static_cast<size_t>(got * channels) * sizeof(float));
+        }
+        else if (stretched) {
+            got = readRing(dst, static_cast<int>(want));
+
+            m_positionFraction += got * rate;
+            const qint64 advance = static_cast<qint64>(m_positionFraction);
+            m_positionFraction -= advance;
+            position += advance;
+            m_ringFrame = position;
+            framesDone += static_cast<int>(got);
+
+            if (got < want) {
+                starved = true;
+                break;
+            }
+            continue;
+        }
+        else {
+            if (position != m_ringFrame) {
+                // The ring continues elsewhere; play silence until re-seeked.
+                m_resyncFrame.store(position, std::memory_order_release);
+                break;
+            }
+            if (looping && position >= clip->startFrame && position < clip->endFrame()) {
+                want = qMin(want, clip->endFrame() - position);
+            }
+            got = readRing(dst, static_cast<int>(want));
+            m_ringFrame += got;
+            if (got < want) {
+                starved = true;
+                position += got;
+                framesDone += static_cast<int>(got);
+                break;
+            }
+        }
+
+        position += got;
+        framesDone += static_cast<int>(got);
+
+        if (clip && position == clip->endFrame()) {
+            if (looping) {
+                position = clip->startFrame;
+                playingClip = true;
+                m_wraps.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                playingClip = false;
+            }
+        }
+    }
+
+    m_playingClip.store(playingClip, std::memory_order_relaxed);
+    m_position.store(position, std::memory_order_release);
+
+    if (framesDone < frames) {
+        memset(out + static_cast<qint64>(framesDone) * channels, 0,
+            static_cast<size_t>(frames - framesDone) * channels * sizeof(float));
+        if (starved) {
+            m_starvedBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const float target = m_targetGain.load(std::memory_order_relaxed);
+    if (framesDone > 0) {
+        // Ramp across the block whenever the gain moves, otherwise a volume
+        // drag produces audible steps at block boundaries.
+        if (target != m_currentGain) {
+            applyGainRamp(out, framesDone, channels, m_currentGain, target);
+        }
+        else if (target != 1.0f) {
+            applyGain(out, framesDone * channels, target);
+        }
+    }
+    m_currentGain = target;
+
+    const qint64 elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    m_lastNs.store(elapsed, std::memory_order_relaxed);
+    m_totalNs.fetch_add(elapsed, std::memory_order_relaxed);
+    m_blocks.fetch_add(1, std::memory_order_relaxed);
+    if (elapsed > m_maxNs.load(std::memory_order_relaxed)) {
+        m_maxNs.store(elapsed, std::memory_order_relaxed);
+    }
+
+    return framesDone;
+}
+
+void AudioRenderer::applyGain(float* samples, int count, float gain)
+{
+    int i = 0;
+
+#ifdef LANGLISTEN_SSE2
+    const __m128 factor = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), factor));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        samples[i] *= gain;
+    }
+}
+
+void AudioRenderer::applyGainRamp(float* samples, int frames, int channels, float from, float to)
+{
+    const float step = (to - from) / frames;
+    const int count = frames * channels;
+    int i = 0;
+
+#ifdef LANGLISTEN_SSE2
+    // Lanes hold consecutive interleaved samples, so the per-lane frame offset
+    // depends on the channel count. Mono and stereo cover every stream the
+    // decoder produces.
+    if (channels == 1 || channels == 2) {
+        __m128 gain = (channels == 1)
+            ? _mm_setr_ps(from, from + step, from + 2 * step, from + 3 * step)
+            : _mm_setr_ps(from, from, from + step, from + step);
+        const __m128 increment = _mm_set1_ps(step * (4 / channels));
+
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+            gain = _mm_add_ps(gain, increment);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        samples[i] *= from + step * (i / channels);
+    }
+}
+
+AudioRenderer::Stats AudioRenderer::stats() const
+{
+    Stats result;
+    result.blocks = m_blocks.load();
+    result.starvedBlocks = m_starvedBlocks.load();
+    result.deviceUnderflows = m_deviceUnderflows.load();
+    result.lastNs = m_lastNs.load();
+    result.maxNs = m_maxNs.load();
+    result.averageNs = result.blocks > 0 ? static_cast<double>(m_totalNs.load()) / result.blocks : 0.0;
+    return result;
+}
+
+void AudioRenderer::resetStats()
+{
+    m_blocks = 0;
+    m_starvedBlocks = 0;
+    m_deviceUnderflows = 0;
+    m_lastNs = 0;
+    m_maxNs = 0;
+    m_totalNs = 0;
+}
+
+AudioRenderer::BenchmarkResult AudioRenderer::benchmark(int channels, int framesPerBlock, int blocks)
+{
+    BenchmarkResult result;
+    result.channels = channels;
+    result.framesPerBlock = framesPerBlock;
+    result.blocks = blocks;
+
+    const int samplesPerBlock = framesPerBlock * channels;
+
+    std::vector<float> source(samplesPerBlock);
+    for (int i = 0; i < samplesPerBlock; ++i) {
+        source[i] = 0.5f * std::sin(i * 0.05f);
+    }
+    std::vector<float> output(samplesPerBlock);
+
+    AudioRingBuffer floatRing(samplesPerBlock * static_cast<int>(sizeof(float)) * 4);
+    AudioRenderer renderer;
+    renderer.configure(&floatRing, channels);
+
+    qint64 rendererNs = 0;
+    for (int b = 0; b < blocks; ++b) {
+        floatRing.write(reinterpret_cast<const char*>(source.data()), samplesPerBlock * static_cast<int>(sizeof(float)));
+        renderer.setGain((b / 100) % 2 ? 0.5f : 0.8f);
+
+        const auto start = std::chrono::steady_clock::now();
+        renderer.render(output.data(), framesPerBlock);
+        rendererNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<int16_t> source16(samplesPerBlock);
+    for (int i = 0; i < samplesPerBlock; ++i) {
+        source16[i] = static_cast<int16_t>(source[i] * 32767.0f);
+    }
+    std::vector<int16_t> output16(samplesPerBlock);
+
+    AudioRingBuffer shortRing(samplesPerBlock * static_cast<int>(sizeof(int16_t)) * 4);
+    QMutex legacyMutex;
+
+    qint64 legacyNs = 0;
+    for (int b = 0; b < blocks; ++b) {
+        shortRing.write(reinterpret_cast<const char*>(source16.data()), samplesPerBlock * static_cast<int>(sizeof(int16_t)));
+        const qreal volume = (b / 100) % 2 ? 0.5 : 0.8;
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            QMutexLocker locker(&legacyMutex);
+            const int bytes = samplesPerBlock * static_cast<int>(sizeof(int16_t));
+            QByteArray data(bytes, Qt::Uninitialized);
+            shortRing.read(data.data(), bytes);
+
+            int16_t* samples = reinterpret_cast<int16_t*>(data.data());
+            for (int i = 0; i < samplesPerBlock; ++i) {
+                samples[i] = static_cast<int16_t>(samples[i] * volume);
+            }
+            memcpy(output16.data(), data.constData(), data.size());
+        }
+        legacyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    result.rendererNsPerBlock = blocks > 0 ? static_cast<double>(rendererNs) / blocks : 0.0;
+    result.legacyNsPerBlock = blocks > 0 ? static_cast<double>(legacyNs) / blocks : 0.0;
+    return result;
+}
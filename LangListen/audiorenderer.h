@@ -0,0 +1,173 @@
+﻿#ifndef AUDIORENDERER_H
+#define AUDIORENDERER_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class AudioRingBuffer;
+
+// Interleaved float32 PCM for [startFrame, startFrame + frameCount()) of the
+// source, in the renderer's output format. Immutable once published.
+struct PcmClip {
+    qint64 startFrame;
+    int channels;
+    std::vector<float> samples;
+
+    PcmClip() : startFrame(0), channels(2) {}
+
+    qint64 frameCount() const { return channels > 0 ? static_cast<qint64>(samples.size()) / channels : 0; }
+    qint64 endFrame() const { return startFrame + frameCount(); }
+};
+
+// Real-time side of playback: pulls interleaved float32 frames from the ring
+// straight into the device buffer and applies gain. render() never locks or
+// allocates; everything else may be called from any thread.
+//
+// The renderer also tracks the source frame it is playing, so loop ranges and
+// pause points are enforced here at sample precision: a loop wraps inside a
+// resident PcmClip without touching the ring, and a stop frame ends output on
+// exactly that frame.
+class AudioRenderer
+{
+public:
+    struct Stats {
+        quint64 blocks;
+        quint64 starvedBlocks;
+        quint64 deviceUnderflows;
+        qint64 lastNs;
+        qint64 maxNs;
+        double averageNs;
+
+        Stats()
+            : blocks(0)
+            , starvedBlocks(0)
+            , deviceUnderflows(0)
+            , lastNs(0)
+            , maxNs(0)
+            , averageNs(0.0)
+        {
+        }
+    };
+
+    struct BenchmarkResult {
+        int channels;
+        int framesPerBlock;
+        int blocks;
+        double rendererNsPerBlock;
+        double legacyNsPerBlock;
+
+        BenchmarkResult()
+            : channels(0)
+            , framesPerBlock(0)
+            , blocks(0)
+            , rendererNsPerBlock(0.0)
+            , legacyNsPerBlock(0.0)
+        {
+        }
+    };
+
+    AudioRenderer();
+
+    void configure(AudioRingBuffer* ringBuffer, int channels);
+
+    void setGain(float gain);
+    float gain() const { return m_targetGain.load(); }
+
+    // Fills all frames of out (silence where the ring ran dry) and returns the
+    // number of frames taken from the ring.
+    int render(float* out, int frames);
+
+    void reportDeviceUnderflow() { m_deviceUnderflows.fetch_add(1, std::memory_order_relaxed); }
+
+    // Source frames advanced per ring frame. The ring carries time-stretched
+    // audio when this is not 1; resident clips are unstretched and are not
+    // played then.
+    void setRate(double rate) { m_rate.store(rate); }
+    double rate() const { return m_rate.load(); }
+
+    // Source frame of the first frame the ring will deliver. Only call while
+    // the output stream is stopped.
+    void setPosition(qint64 frame);
+    qint64 position() const { return m_position.load(std::memory_order_acquire); }
+
+    // Position that is audible now, given the device latency in frames;
+    // accounts for a loop that wrapped within that latency.
+    qint64 playedPosition(qint64 latencyFrames) const;
+
+    // Starts output at the clip start, playing from memory until the clip end
+    // where the ring (which must begin at clip end) takes over. Only call
+    // while the output stream is stopped.
+    void preroll(std::shared_ptr<const PcmClip> clip, bool loop);
+
+    // Loops [clip start, clip end) once playback reaches the clip's end.
+    // nullptr stops looping; the clip being played finishes first so the
+    // ring, which continues at the clip end, takes over without a gap.
+    // setLoopClip() and releaseRetiredClips() belong to the owner thread.
+    void setLoopClip(std::shared_ptr<const PcmClip> clip);
+    bool hasLoopClip() const { return m_loopEnabled.load() && m_loopClip.load() != nullptr; }
+    bool isLooping() const { return m_playingClip.load(); }
+
+    // Output stops on this frame (silence follows) and stopReached() latches.
+    // -1 disables.
+    void setStopFrame(qint64 frame);
+    qint64 stopFrame() const { return m_stopFrame.load(); }
+    bool takeStopReached() { return m_stopReached.exchange(false); }
+
+    // Set when playback must continue from a frame the ring does not hold
+    // (the loop clip changed under it); the owner should seek there.
+    qint64 takeResyncFrame() { return m_resyncFrame.exchange(-1); }
+
+    // Frees clips replaced by setLoopClip() once the callback has let go.
+    void releaseRetiredClips();
+
+    Stats stats() const;
+    void resetStats();
+
+    // Times render() against the previous int16 QByteArray + scalar volume
+    // path on synthetic data, per block of framesPerBlock frames.
+    static BenchmarkResult benchmark(int channels, int framesPerBlock = 256, int blocks = 20000);
+
+private:
+    void installClip(std::shared_ptr<const PcmClip> clip);
+    const PcmClip* acquireClip();
+    int readRing(float* out, int frames);
+    static void applyGain(float* samples, int count, float gain);
+    static void applyGainRamp(float* samples, int frames, int channels, float from, float to);
+
+    AudioRingBuffer* m_ringBuffer;
+    int m_channels;
+
+    std::atomic<float> m_targetGain;
+    float m_currentGain;
+
+    std::atomic<double> m_rate;
+    std::atomic<qint64> m_position;
+    double m_positionFraction;
+    qint64 m_ringFrame;
+    std::atomic<bool> m_playingClip;
+    std::atomic<int> m_wraps;
+    std::atomic<qint64> m_stopFrame;
+    std::atomic<bool> m_stopReached;
+    std::atomic<qint64> m_resyncFrame;
+
+    // Hazard-pointer handoff: the callback announces the clip it uses in
+    // m_clipInUse, and the owner keeps replaced clips alive until it moves on.
+    std::atomic<const PcmClip*> m_loopClip;
+    std::atomic<const PcmClip*> m_clipInUse;
+    std::atomic<bool> m_loopEnabled;
+    std::atomic<qint64> m_activeLoopStart;
+    std::atomic<qint64> m_activeLoopEnd;
+    std::shared_ptr<const PcmClip> m_clipOwner;
+    std::vector<std::shared_ptr<const PcmClip>> m_retiredClips;
+
+    std::atomic<quint64> m_blocks;
+    std::atomic<quint64> m_starvedBlocks;
+    std::atomic<quint64> m_deviceUnderflows;
+    std::atomic<qint64> m_lastNs;
+    std::atomic<qint64> m_maxNs;
+    std::atomic<qint64> m_totalNs;
+};
+
+#endif // AUDIORENDERER_H
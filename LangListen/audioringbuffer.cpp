@@ -1,14 +1,81 @@
 ﻿#include "audioringbuffer.h"
-#include <QDebug>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <cerrno>
+#include <semaphore.h>
+#endif
+
+// OS counting semaphore. post() is a single system call without a user-space
+// lock, which is what the callback thread may afford.
+class AudioRingBuffer::Semaphore
+{
+public:
+#if defined(_WIN32)
+    Semaphore() : m_handle(CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr)) {}
+    ~Semaphore() { CloseHandle(m_handle); }
+    void post() { ReleaseSemaphore(m_handle, 1, nullptr); }
+    void wait() { WaitForSingleObject(m_handle, INFINITE); }
+
+private:
+    HANDLE m_handle;
+#elif defined(__APPLE__)
+    Semaphore() : m_handle(dispatch_semaphore_create(0)) {}
+    ~Semaphore() { dispatch_release(m_handle); }
+    void post() { dispatch_semaphore_signal(m_handle); }
+    void wait() { dispatch_semaphore_wait(m_handle, DISPATCH_TIME_FOREVER); }
+
+private:
+    dispatch_semaphore_t m_handle;
+#else
+    Semaphore() { sem_init(&m_handle, 0, 0); }
+    ~Semaphore() { sem_destroy(&m_handle); }
+    void post() { sem_post(&m_handle); }
+    void wait()
+    {
+        while (sem_wait(&m_handle) != 0 && errno == EINTR) {
+        }
+    }
+
+private:
+    sem_t m_handle;
+#endif
+};
+
+namespace {
+
+int roundUpToPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// The producer resumes once a quarter of the ring has drained rather than
+// refilling a few bytes after every callback.
+const int kResumeDivisor = 4;
+
+}
 
 AudioRingBuffer::AudioRingBuffer(int capacity)
-    : m_capacity(capacity)
-    , m_readPos(0)
-    , m_writePos(0)
-    , m_dataSize(0)
+    : m_capacity(roundUpToPowerOfTwo(qMax(capacity, 1024)))
+    , m_mask(static_cast<quint64>(m_capacity) - 1)
+    , m_head(0)
+    , m_tail(0)
     , m_cancelled(false)
+    , m_producerWaiting(false)
+    , m_spaceAvailable(new Semaphore())
 {
-    m_buffer.resize(capacity);
+    m_buffer.reset(new char[m_capacity]);
 }
 
 AudioRingBuffer::~AudioRingBuffer()
@@ -16,89 +83,133 @@ AudioRingBuffer::~AudioRingBuffer()
     cancel();
 }
 
-int AudioRingBuffer::write(const QByteArray& data)
+int AudioRingBuffer::write(const char* data, int size, const std::atomic<bool>* interrupt)
 {
-    if (data.isEmpty())
+    if (size <= 0)
         return 0;
 
-    QMutexLocker locker(&m_mutex);
-
     int totalWritten = 0;
-    int remaining = data.size();
-    const char* srcData = data.constData();
 
-    while (remaining > 0) {
-        if (m_cancelled.load()) {
+    while (totalWritten < size) {
+        if (m_cancelled.load(std::memory_order_acquire)) {
             return -1;
         }
 
-        int freeSpace = m_capacity - m_dataSize;
+        if (interrupt && interrupt->load(std::memory_order_acquire)) {
+            break;
+        }
+
+        const quint64 head = m_head.load(std::memory_order_relaxed);
+        const quint64 tail = m_tail.load(std::memory_order_acquire);
+        const int freeSpace = m_capacity - static_cast<int>(head - tail);
 
         if (freeSpace == 0) {
-            m_notFull.wait(&m_mutex, 100);
+            waitForSpace(interrupt);
             continue;
         }
 
-        int toWrite = qMin(remaining, freeSpace);
-        int chunkSize1 = qMin(toWrite, m_capacity - m_writePos);
-
-        memcpy(m_buffer.data() + m_writePos, srcData + totalWritten, chunkSize1);
+        const int toWrite = qMin(size - totalWritten, freeSpace);
+        const int offset = static_cast<int>(head & m_mask);
+        const int chunkSize1 = qMin(toWrite, m_capacity - offset);
 
+        memcpy(m_buffer.get() + offset, data + totalWritten, chunkSize1);
         if (toWrite > chunkSize1) {
-            int chunkSize2 = toWrite - chunkSize1;
-            memcpy(m_buffer.data(), srcData + totalWritten + chunkSize1, chunkSize2);
+            memcpy(m_buffer.get(), data + totalWritten + chunkSize1, toWrite - chunkSize1);
         }
 
-        m_writePos = (m_writePos + toWrite) % m_capacity;
-        m_dataSize += toWrite;
+        m_head.store(head + toWrite, std::memory_order_release);
         totalWritten += toWrite;
-        remaining -= toWrite;
-
-        m_notEmpty.wakeAll();
     }
 
     return totalWritten;
 }
 
-QByteArray AudioRingBuffer::read(int maxSize)
+bool AudioRingBuffer::hasResumeSpace() const
 {
-    QMutexLocker locker(&m_mutex);
+    const quint64 used = m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_seq_cst);
+    return used <= static_cast<quint64>(m_capacity - m_capacity / kResumeDivisor);
+}
 
-    if (m_dataSize == 0)
-        return QByteArray();
+// Whoever clears the flag owes the producer exactly one post, so the
+// semaphore count never builds up across waits.
+bool AudioRingBuffer::postIfWaiting()
+{
+    if (!m_producerWaiting.exchange(false, std::memory_order_seq_cst)) {
+        return false;
+    }
+    m_spaceAvailable->post();
+    return true;
+}
 
-    int toRead = qMin(maxSize, m_dataSize);
-    QByteArray result(toRead, Qt::Uninitialized);
+void AudioRingBuffer::waitForSpace(const std::atomic<bool>* interrupt)
+{
+    // The flag is published before the conditions are re-checked and read()
+    // advances the tail before it looks at the flag (both sequentially
+    // consistent), so either this check sees the drained space or read()
+    // sees the flag and posts.
+    while (true) {
+        m_producerWaiting.store(true, std::memory_order_seq_cst);
+
+        if (m_cancelled.load() || (interrupt && interrupt->load()) || hasResumeSpace()) {
+            if (!m_producerWaiting.exchange(false, std::memory_order_seq_cst)) {
+                // A post is already on its way; consume it.
+                m_spaceAvailable->wait();
+            }
+            return;
+        }
+
+        m_spaceAvailable->wait();
+
+        if (m_cancelled.load() || (interrupt && interrupt->load()) || hasResumeSpace()) {
+            return;
+        }
+    }
+}
+
+int AudioRingBuffer::read(char* dst, int maxSize)
+{
+    quint64 tail = m_tail.load(std::memory_order_relaxed);
+    const quint64 head = m_head.load(std::memory_order_acquire);
+
+    const int toRead = static_cast<int>(qMin<quint64>(static_cast<quint64>(qMax(maxSize, 0)), head - tail));
+    if (toRead == 0)
+        return 0;
 
-    int chunkSize1 = qMin(toRead, m_capacity - m_readPos);
-    memcpy(result.data(), m_buffer.constData() + m_readPos, chunkSize1);
+    const int offset = static_cast<int>(tail & m_mask);
+    const int chunkSize1 = qMin(toRead, m_capacity - offset);
 
+    memcpy(dst, m_buffer.get() + offset, chunkSize1);
     if (toRead > chunkSize1) {
-        int chunkSize2 = toRead - chunkSize1;
-        memcpy(result.data() + chunkSize1, m_buffer.constData(), chunkSize2);
+        memcpy(dst + chunkSize1, m_buffer.get(), toRead - chunkSize1);
     }
 
-    m_readPos = (m_readPos + toRead) % m_capacity;
-    m_dataSize -= toRead;
+    // A concurrent clear() moved the tail; what was copied is stale.
+    if (!m_tail.compare_exchange_strong(tail, tail + toRead, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return 0;
+    }
 
-    m_notFull.wakeAll();
+    if (m_producerWaiting.load(std::memory_order_seq_cst) && hasResumeSpace()) {
+        postIfWaiting();
+    }
 
-    return result;
+    return toRead;
 }
 
 int AudioRingBuffer::available() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_dataSize;
+    const quint64 tail = m_tail.load(std::memory_order_acquire);
+    const quint64 head = m_head.load(std::memory_order_acquire);
+    return static_cast<int>(head - tail);
 }
 
 void AudioRingBuffer::clear()
 {
-    QMutexLocker locker(&m_mutex);
-    m_readPos = 0;
-    m_writePos = 0;
-    m_dataSize = 0;
-    m_notFull.wakeAll();
+    const quint64 head = m_head.load(std::memory_order_acquire);
+    quint64 tail = m_tail.load(std::memory_order_relaxed);
+    while (tail < head && !m_tail.compare_exchange_weak(tail, head, std::memory_order_seq_cst)) {
+    }
+
+    postIfWaiting();
 }
 
 void AudioRingBuffer::reset()
@@ -109,12 +220,15 @@ void AudioRingBuffer::reset()
 void AudioRingBuffer::cancel()
 {
     m_cancelled.store(true);
-    m_notFull.wakeAll();
-    m_notEmpty.wakeAll();
+    postIfWaiting();
+}
+
+void AudioRingBuffer::wakeProducer()
+{
+    postIfWaiting();
 }
 
 bool AudioRingBuffer::isEmpty() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_dataSize == 0;
-}
\ No newline at end of file
+    return available() == 0;
+}
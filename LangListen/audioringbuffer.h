@@ -2,42 +2,63 @@
 #define AUDIORINGBUFFER_H
 
 #include <QByteArray>
-#include <QMutex>
-#include <QWaitCondition>
 #include <atomic>
+#include <memory>
 
+// Single-producer / single-consumer byte ring. read() never locks or
+// allocates, so it is safe on the PortAudio callback thread. write() sleeps on
+// a semaphore while the ring is full; read() posts it only when the producer
+// has flagged that it is waiting and a quarter of the ring has drained, so
+// playback costs at most one post per refill.
+//
+// Head and tail are monotonic byte counters; the capacity is rounded up to a
+// power of two so positions wrap with a mask.
 class AudioRingBuffer
 {
 public:
     explicit AudioRingBuffer(int capacity);
     ~AudioRingBuffer();
 
-    int write(const QByteArray& data);
+    // Returns the bytes written, which is less than size if interrupt became
+    // true while waiting, or -1 once cancelled.
+    int write(const char* data, int size, const std::atomic<bool>* interrupt = nullptr);
+    int write(const QByteArray& data) { return write(data.constData(), data.size()); }
 
-    QByteArray read(int maxSize);
+    int read(char* dst, int maxSize);
 
     int available() const;
+    int capacity() const { return m_capacity; }
 
+    // Discards everything written so far. Callable from either side: the
+    // tail is advanced with a CAS so it can race safely with read().
     void clear();
 
     void reset();
 
     void cancel();
 
+    // Wakes a producer blocked in write() so it can re-check its interrupt flag.
+    void wakeProducer();
+
     bool isEmpty() const;
 
 private:
-    QByteArray m_buffer;
+    class Semaphore;
+
+    void waitForSpace(const std::atomic<bool>* interrupt);
+    bool hasResumeSpace() const;
+    bool postIfWaiting();
+
+    std::unique_ptr<char[]> m_buffer;
     int m_capacity;
-    int m_readPos;
-    int m_writePos;
-    int m_dataSize;
+    quint64 m_mask;
 
-    mutable QMutex m_mutex;
-    QWaitCondition m_notFull;
-    QWaitCondition m_notEmpty;
+    alignas(64) std::atomic<quint64> m_head;
+    alignas(64) std::atomic<quint64> m_tail;
+    alignas(64) std::atomic<bool> m_cancelled;
+    std::atomic<bool> m_producerWaiting;
 
-    std::atomic<bool> m_cancelled;
+    std::unique_ptr<Semaphore> m_spaceAvailable;
 };
 
-#endif // AUDIORINGBUFFER_H
\ No newline at end of file
+#endif // AUDIORINGBUFFER_H
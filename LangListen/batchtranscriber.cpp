@@ -0,0 +1,242 @@
+﻿#include "batchtranscriber.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTextStream>
+
+BatchTranscriber::BatchTranscriber(const Options& options, QObject* parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_nextFile(0)
+    , m_finishedCount(0)
+    , m_activeSlots(0)
+{
+    // One state per worker; splitting each file further would only make the
+    // workers compete for the same cores.
+    m_options.transcription.privateState = true;
+    m_options.transcription.streaming = false;
+    if (m_options.workers > 1 && m_options.transcription.parallelStates == 0) {
+        m_options.transcription.parallelStates = 1;
+    }
+}
+
+BatchTranscriber::~BatchTranscriber()
+{
+    for (Slot* slot : m_slots) {
+        slot->thread->quit();
+        slot->thread->wait();
+        delete slot->worker;
+        delete slot;
+    }
+}
+
+void BatchTranscriber::start(const QStringList& files)
+{
+    m_files = files;
+    m_results = QVector<FileResult>(files.size());
+    m_nextFile = 0;
+    m_finishedCount = 0;
+
+    if (files.isEmpty()) {
+        emit finished();
+        return;
+    }
+
+    const int workerCount = qBound(1, m_options.workers, static_cast<int>(files.size()));
+    m_activeSlots = workerCount;
+
+    // Split the cores between the workers instead of giving each all of them.
+    if (m_options.transcription.threadBudget <= 0) {
+        m_options.transcription.threadBudget = qMax(1, QThread::idealThreadCount() / workerCount);
+    }
+
+    for (int i = 0; i < workerCount; ++i) {
+        auto* slot = new Slot();
+        slot->thread = new QThread(this);
+        slot->worker = new WhisperWorker();
+        slot->worker->setTranscriptionOptions(m_options.transcription);
+        slot->worker->moveToThread(slot->thread);
+        slot->subtitles = new SubtitleGenerator(this);
+        m_slots.append(slot);
+
+        WhisperWorker* worker = slot->worker;
+        const QString prefix = QString("[worker %1] ").arg(i + 1);
+
+        connect(worker, &WhisperWorker::logMessage, this, [this, prefix](const QString& message) {
+            emit logMessage(prefix + message);
+            });
+        connect(worker, &WhisperWorker::modelLoaded, this, [this, i](bool success, const QString& message) {
+            onModelLoaded(i, success, message);
+            });
+        connect(worker, &WhisperWorker::segmentReady, this, [slot](qint64 startMs, qint64 endMs, const QString& text) {
+            slot->subtitles->addSegment(startMs, endMs, text);
+            });
+        connect(worker, &WhisperWorker::transcriptionCompleted, this, [this, i]() {
+            onTranscriptionFinished(i, true, QString());
+            });
+        connect(worker, &WhisperWorker::transcriptionFailed, this, [this, i](const QString& error) {
+            onTranscriptionFinished(i, false, error);
+            });
+
+        slot->thread->start();
+
+        // The model cache loads under its lock, so only the first worker reads
+        // the file and the others get the same context.
+        const QString modelPath = m_options.modelPath;
+        QMetaObject::invokeMethod(worker, [worker, modelPath]() {
+            worker->initModel(modelPath);
+            }, Qt::QueuedConnection);
+    }
+}
+
+void BatchTranscriber::onModelLoaded(int slotIndex, bool success, const QString& message)
+{
+    if (success) {
+        dispatch(slotIndex);
+        return;
+    }
+
+    emit logMessage(QString("ERROR: Worker %1 could not load the model: %2").arg(slotIndex + 1).arg(message));
+    --m_activeSlots;
+
+    // Without any worker left the remaining files can never run.
+    if (m_activeSlots == 0) {
+        while (m_nextFile < m_files.size()) {
+            FileResult result;
+            result.filePath = m_files[m_nextFile];
+            result.error = message;
+            m_results[m_nextFile] = result;
+            ++m_nextFile;
+            ++m_finishedCount;
+            emit fileFinished(result, m_finishedCount, m_files.size());
+        }
+    }
+
+    checkFinished();
+}
+
+void BatchTranscriber::dispatch(int slotIndex)
+{
+    Slot* slot = m_slots[slotIndex];
+
+    if (m_nextFile >= m_files.size()) {
+        slot->fileIndex = -1;
+        --m_activeSlots;
+        checkFinished();
+        return;
+    }
+
+    slot->fileIndex = m_nextFile++;
+    slot->subtitles->clearSegments();
+    slot->timer.start();
+
+    WhisperWorker* worker = slot->worker;
+    const QString filePath = m_files[slot->fileIndex];
+    QMetaObject::invokeMethod(worker, [worker, filePath]() {
+        worker->transcribe(filePath);
+        }, Qt::QueuedConnection);
+}
+
+void BatchTranscriber::onTranscriptionFinished(int slotIndex, bool success, const QString& error)
+{
+    Slot* slot = m_slots[slotIndex];
+    if (slot->fileIndex < 0) {
+        return;
+    }
+
+    FileResult result;
+    result.filePath = m_files[slot->fileIndex];
+    result.success = success;
+    result.error = error;
+    result.elapsedMs = slot->timer.elapsed();
+    // The worker is idle until the next dispatch, so its duration is stable.
+    result.audioSeconds = slot->worker->getAudioDuration();
+    result.segments = slot->subtitles->segmentCount();
+
+    if (success && !writeOutputs(slot->subtitles, result.filePath, result.error)) {
+        result.success = false;
+    }
+
+    finishFile(slotIndex, result);
+    dispatch(slotIndex);
+}
+
+void BatchTranscriber::finishFile(int slotIndex, const FileResult& result)
+{
+    Slot* slot = m_slots[slotIndex];
+    m_results[slot->fileIndex] = result;
+    ++m_finishedCount;
+    emit fileFinished(result, m_finishedCount, m_files.size());
+}
+
+bool BatchTranscriber::writeOutputs(SubtitleGenerator* subtitles, const QString& filePath, QString& error)
+{
+    QFileInfo info(filePath);
+    const QString base = info.absolutePath() + "/" + info.completeBaseName();
+
+    if (m_options.writeSrt && !subtitles->saveSRT(base + ".srt")) {
+        error = "Cannot write " + base + ".srt";
+        return false;
+    }
+    if (m_options.writeLrc && !subtitles->saveLRC(base + ".lrc")) {
+        error = "Cannot write " + base + ".lrc";
+        return false;
+    }
+    return true;
+}
+
+void BatchTranscriber::checkFinished()
+{
+    if (m_activeSlots == 0 && m_finishedCount == m_files.size()) {
+        emit finished();
+    }
+}
+
+QStringList BatchTranscriber::expandInputs(const QStringList& inputs)
+{
+    QStringList files;
+    QSet<QString> seen;
+
+    auto add = [&files, &seen](const QString& path) {
+        const QString absolute = QFileInfo(path).absoluteFilePath();
+        if (!seen.contains(absolute)) {
+            seen.insert(absolute);
+            files.append(absolute);
+        }
+    };
+
+    for (const QString& input : inputs) {
+        if (input.startsWith('@')) {
+            QFile list(input.mid(1));
+            if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                continue;
+            }
+
+            QStringList lines;
+            QTextStream stream(&list);
+            while (!stream.atEnd()) {
+                const QString line = stream.readLine().trimmed();
+                if (!line.isEmpty() && !line.startsWith('#')) {
+                    lines.append(line);
+                }
+            }
+            for (const QString& file : expandInputs(lines)) {
+                add(file);
+            }
+        }
+        else if (input.contains('*') || input.contains('?') || input.contains('[')) {
+            QFileInfo pattern(input);
+            QDir dir(pattern.path());
+            const QFileInfoList matches = dir.entryInfoList(QStringList() << pattern.fileName(), QDir::Files, QDir::Name);
+            for (const QFileInfo& match : matches) {
+                add(match.absoluteFilePath());
+            }
+        }
+        else {
+            add(input);
+        }
+    }
+
+    return files;
+}
@@ -0,0 +1,108 @@
+﻿#ifndef BATCHTRANSCRIBER_H
+#define BATCHTRANSCRIBER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QThread>
+#include "whisperworker.h"
+#include "subtitlegenerator.h"
+
+// Transcribes a list of files with a fixed number of WhisperWorkers, each on
+// its own thread and whisper_state but sharing one cached model context.
+// Subtitles are written next to every input as soon as it finishes. Needs
+// only QtCore; used by the LangListenCli target.
+class BatchTranscriber : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString modelPath;
+        int workers;
+        bool writeSrt;
+        bool writeLrc;
+        TranscriptionOptions transcription;
+
+        Options()
+            : workers(1)
+            , writeSrt(true)
+            , writeLrc(false)
+        {
+        }
+    };
+
+    struct FileResult {
+        QString filePath;
+        bool success;
+        QString error;
+        double audioSeconds;
+        qint64 elapsedMs;
+        int segments;
+
+        FileResult()
+            : success(false)
+            , audioSeconds(0.0)
+            , elapsedMs(0)
+            , segments(0)
+        {
+        }
+
+        // Processing time over audio time; below 1 is faster than realtime.
+        double realtimeFactor() const
+        {
+            return audioSeconds > 0.0 ? elapsedMs / 1000.0 / audioSeconds : 0.0;
+        }
+    };
+
+    explicit BatchTranscriber(const Options& options, QObject* parent = nullptr);
+    ~BatchTranscriber();
+
+    void start(const QStringList& files);
+    QVector<FileResult> results() const { return m_results; }
+
+    // Expands glob patterns (in the file name part) and "@list.txt" files
+    // with one input per line; duplicates are dropped, order is kept.
+    static QStringList expandInputs(const QStringList& inputs);
+
+signals:
+    void fileFinished(const BatchTranscriber::FileResult& result, int finishedCount, int totalCount);
+    void finished();
+    void logMessage(const QString& message);
+
+private:
+    struct Slot {
+        QThread* thread;
+        WhisperWorker* worker;
+        SubtitleGenerator* subtitles;
+        int fileIndex;
+        QElapsedTimer timer;
+
+        Slot()
+            : thread(nullptr)
+            , worker(nullptr)
+            , subtitles(nullptr)
+            , fileIndex(-1)
+        {
+        }
+    };
+
+    void onModelLoaded(int slotIndex, bool success, const QString& message);
+    void onTranscriptionFinished(int slotIndex, bool success, const QString& error);
+    void dispatch(int slotIndex);
+    void finishFile(int slotIndex, const FileResult& result);
+    bool writeOutputs(SubtitleGenerator* subtitles, const QString& filePath, QString& error);
+    void checkFinished();
+
+    Options m_options;
+    QStringList m_files;
+    QVector<FileResult> m_results;
+    QVector<Slot*> m_slots;
+    int m_nextFile;
+    int m_finishedCount;
+    int m_activeSlots;
+};
+
+#endif // BATCHTRANSCRIBER_H
@@ -0,0 +1,160 @@
+﻿#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QTextStream>
+#include "batchtranscriber.h"
+
+namespace {
+
+QString formatRow(const QString& file, const QString& audio, const QString& time,
+    const QString& rtf, const QString& segments, const QString& status)
+{
+    return QString("%1 %2 %3 %4 %5 %6")
+        .arg(file, -32)
+        .arg(audio, 10)
+        .arg(time, 10)
+        .arg(rtf, 7)
+        .arg(segments, 9)
+        .arg(status);
+}
+
+QString shortName(const QString& filePath)
+{
+    QString name = QFileInfo(filePath).fileName();
+    return name.size() > 32 ? name.left(29) + "..." : name;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("com.techfs");
+    app.setApplicationName("LangListen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch transcription: writes subtitles next to each input file.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Audio/video files, glob patterns or @list files.", "<inputs...>");
+
+    QCommandLineOption modelOption(QStringList() << "m" << "model", "Whisper model file (ggml .bin).", "path");
+    QCommandLineOption workersOption(QStringList() << "j" << "workers", "Files transcribed at the same time.", "count", "1");
+    QCommandLineOption formatOption(QStringList() << "f" << "format", "Output format: srt, lrc or both.", "format", "srt");
+    QCommandLineOption statesOption("parallel-states", "whisper states per file (0 = automatic).", "count", "0");
+    QCommandLineOption noVadOption("no-vad", "Transcribe silence too instead of skipping it.");
+    QCommandLineOption resumeOption("resume", "Journal segments to disk and continue interrupted files where they stopped.");
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Print worker log messages.");
+    parser.addOption(modelOption);
+    parser.addOption(workersOption);
+    parser.addOption(formatOption);
+    parser.addOption(statesOption);
+    parser.addOption(noVadOption);
+    parser.addOption(resumeOption);
+    parser.addOption(verboseOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (!parser.isSet(modelOption)) {
+        err << "ERROR: --model is required" << Qt::endl;
+        return 2;
+    }
+
+    const QString format = parser.value(formatOption).toLower();
+    if (format != "srt" && format != "lrc" && format != "both") {
+        err << "ERROR: unknown format " << format << Qt::endl;
+        return 2;
+    }
+
+    const QStringList files = BatchTranscriber::expandInputs(parser.positionalArguments());
+    if (files.isEmpty()) {
+        err << "ERROR: no input files" << Qt::endl;
+        return 2;
+    }
+
+    BatchTranscriber::Options options;
+    options.modelPath = parser.value(modelOption);
+    options.workers = qMax(1, parser.value(workersOption).toInt());
+    options.writeSrt = format != "lrc";
+    options.writeLrc = format != "srt";
+    options.transcription.parallelStates = qMax(0, parser.value(statesOption).toInt());
+    options.transcription.skipSilence = !parser.isSet(noVadOption);
+    options.transcription.journal = parser.isSet(resumeOption);
+
+    out << QString("Transcribing %1 file(s) with %2 worker(s)").arg(files.size()).arg(options.workers) << Qt::endl;
+
+    BatchTranscriber transcriber(options);
+
+    const bool verbose = parser.isSet(verboseOption);
+    QObject::connect(&transcriber, &BatchTranscriber::logMessage, [&err, verbose](const QString& message) {
+        if (verbose || message.startsWith("ERROR")) {
+            err << message << Qt::endl;
+        }
+        });
+
+    QObject::connect(&transcriber, &BatchTranscriber::fileFinished,
+        [&out](const BatchTranscriber::FileResult& result, int finishedCount, int totalCount) {
+            if (result.success) {
+                out << QString("[%1/%2] %3: %4 s audio in %5 s, RTF %6, %7 segments")
+                    .arg(finishedCount)
+                    .arg(totalCount)
+                    .arg(result.filePath)
+                    .arg(result.audioSeconds, 0, 'f', 1)
+                    .arg(result.elapsedMs / 1000.0, 0, 'f', 1)
+                    .arg(result.realtimeFactor(), 0, 'f', 3)
+                    .arg(result.segments) << Qt::endl;
+            }
+            else {
+                out << QString("[%1/%2] %3: FAILED %4")
+                    .arg(finishedCount)
+                    .arg(totalCount)
+                    .arg(result.filePath, result.error) << Qt::endl;
+            }
+        });
+
+    QElapsedTimer wallClock;
+    wallClock.start();
+
+    QObject::connect(&transcriber, &BatchTranscriber::finished, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+    transcriber.start(files);
+    app.exec();
+
+    const qint64 wallMs = wallClock.elapsed();
+    const QVector<BatchTranscriber::FileResult> results = transcriber.results();
+
+    double totalAudio = 0.0;
+    qint64 totalCompute = 0;
+    int totalSegments = 0;
+    int failures = 0;
+
+    out << Qt::endl << formatRow("File", "Audio(s)", "Time(s)", "RTF", "Segments", "Status") << Qt::endl;
+    out << QString(80, '-') << Qt::endl;
+    for (const BatchTranscriber::FileResult& result : results) {
+        out << formatRow(shortName(result.filePath),
+            QString::number(result.audioSeconds, 'f', 1),
+            QString::number(result.elapsedMs / 1000.0, 'f', 1),
+            QString::number(result.realtimeFactor(), 'f', 3),
+            QString::number(result.segments),
+            result.success ? "ok" : "FAILED") << Qt::endl;
+
+        totalAudio += result.audioSeconds;
+        totalCompute += result.elapsedMs;
+        totalSegments += result.segments;
+        if (!result.success) {
+            ++failures;
+        }
+    }
+    out << QString(80, '-') << Qt::endl;
+
+    // Wall-clock RTF is what the batch cost overall; per-file times overlap
+    // when several workers run.
+    out << formatRow(QString("Total (%1 ok, %2 failed)").arg(results.size() - failures).arg(failures),
+        QString::number(totalAudio, 'f', 1),
+        QString::number(wallMs / 1000.0, 'f', 1),
+        QString::number(totalAudio > 0.0 ? wallMs / 1000.0 / totalAudio : 0.0, 'f', 3),
+        QString::number(totalSegments),
+        QString("sum of file times %1 s").arg(totalCompute / 1000.0, 0, 'f', 1)) << Qt::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -1,8 +1,14 @@
 ﻿#include "ffmpegaudioengine.h"
 #include "audioringbuffer.h"
+#include "segmentpcmcache.h"
 #include <QDebug>
 #include <QMutexLocker>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QtConcurrent>
 #include <QtMath>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #define ENABLE_DECODER_LOG 0
@@ -17,6 +23,16 @@
 #define LOG_CLOCK qDebug() << "[CLOCK]"
 #define LOG_PA qDebug() << "[PORTAUDIO]"
 
+namespace {
+
+qint64 steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
 FFmpegDecoder::FFmpegDecoder(AudioRingBuffer* ringBuffer, QObject* parent)
     : QThread(parent)
     , m_formatCtx(nullptr)
@@ -27,11 +43,13 @@ FFmpegDecoder::FFmpegDecoder(AudioRingBuffer* ringBuffer, QObject* parent)
     , m_sampleRate(0)
     , m_channels(0)
     , m_ringBuffer(ringBuffer)
-    , m_running(true)
-    , m_decoding(false)
-    , m_pauseRequested(false)
-    , m_seekRequested(false)
-    , m_seekTargetMs(0)
+    , m_playbackRate(1.0)
+    , m_commandPending(false)
+    , m_closeRequested(0)
+    , m_closeCompleted(0)
+    , m_lastSeekLatencyUs(-1)
+    , m_totalSeekLatencyUs(0)
+    , m_seekLatencySamples(0)
 {
     start();
     LOG_DECODER << "Decoder thread created and started";
@@ -40,11 +58,7 @@ FFmpegDecoder::FFmpegDecoder(AudioRingBuffer* ringBuffer, QObject* parent)
 FFmpegDecoder::~FFmpegDecoder()
 {
     LOG_DECODER << "Decoder destructor called";
-    m_running = false;
-    m_decoding = false;
-    if (m_ringBuffer) {
-        m_ringBuffer->cancel();
-    }
+    postCommand(CommandType::Quit);
     if (isRunning()) {
         wait(2000);
         if (isRunning()) {
@@ -167,7 +181,7 @@ bool FFmpegDecoder::initResampler()
     int ret = swr_alloc_set_opts2(
         &m_swrCtx,
         &outChannelLayout,
-        AV_SAMPLE_FMT_S16,
+        AV_SAMPLE_FMT_FLT,
         m_sampleRate,
         &m_codecCtx->ch_layout,
         m_codecCtx->sample_fmt,
@@ -219,41 +233,84 @@ void FFmpegDecoder::cleanupDecoder()
 
 void FFmpegDecoder::close()
 {
+    // The contexts belong to the decoder thread while it runs; let it release
+    // them between packets instead of pulling them out from under it.
+    if (isRunning() && QThread::currentThread() != this) {
+        QMutexLocker locker(&m_commandMutex);
+        quint64 ticket = ++m_closeRequested;
+        m_commands.push_back({ CommandType::Close, 0, 0 });
+        m_commandPending = true;
+        m_commandCondition.wakeOne();
+        if (m_ringBuffer) {
+            m_ringBuffer->wakeProducer();
+        }
+
+        while (m_closeCompleted < ticket && isRunning()) {
+            m_closeCondition.wait(&m_commandMutex, 100);
+        }
+        return;
+    }
+
     cleanupResampler();
     cleanupDecoder();
 }
 
+void FFmpegDecoder::postCommand(CommandType type, qint64 frame)
+{
+    {
+        QMutexLocker locker(&m_commandMutex);
+        m_commands.push_back({ type, frame, steadyNowNs() });
+        m_commandPending = true;
+        m_commandCondition.wakeOne();
+    }
+
+    // A producer blocked on a full ring would otherwise only see the command
+    // once the callback drains it.
+    if (m_ringBuffer) {
+        m_ringBuffer->wakeProducer();
+    }
+}
+
 void FFmpegDecoder::seekTo(qint64 positionMs)
 {
-    m_seekTargetMs = positionMs;
-    m_seekRequested = true;
+    seekToFrame(av_rescale(positionMs, m_sampleRate, 1000));
+}
+
+void FFmpegDecoder::seekToFrame(qint64 frame)
+{
+    postCommand(CommandType::Seek, frame);
 }
 
 void FFmpegDecoder::startDecoding()
 {
-    m_decoding = true;
-    m_pauseRequested = false;
+    postCommand(CommandType::Start);
     LOG_DECODER << "Decoding started";
 }
 
 void FFmpegDecoder::stopDecoding()
 {
-    m_decoding = false;
+    postCommand(CommandType::Stop);
     LOG_DECODER << "Decoding stopped";
 }
 
 void FFmpegDecoder::pauseDecoding()
 {
-    m_pauseRequested = true;
+    postCommand(CommandType::Pause);
     LOG_DECODER << "Decoding paused";
 }
 
 void FFmpegDecoder::resumeDecoding()
 {
-    m_pauseRequested = false;
+    postCommand(CommandType::Resume);
     LOG_DECODER << "Decoding resumed";
 }
 
+double FFmpegDecoder::averageSeekLatencyUs() const
+{
+    int samples = m_seekLatencySamples.load();
+    return samples > 0 ? static_cast<double>(m_totalSeekLatencyUs.load()) / samples : 0.0;
+}
+
 bool FFmpegDecoder::performSeek(qint64 targetMs)
 {
     if (!m_formatCtx || m_audioStreamIndex < 0) {
@@ -275,6 +332,13 @@ bool FFmpegDecoder::performSeek(qint64 targetMs)
     return true;
 }
 
+qint64 FFmpegDecoder::ptsToFrame(int64_t pts) const
+{
+    AVStream* stream = m_formatCtx->streams[m_audioStreamIndex];
+    int64_t startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    return av_rescale_q(pts - startTime, stream->time_base, { 1, m_sampleRate });
+}
+
 bool FFmpegDecoder::resampleFrame(AVFrame* frame, QByteArray& outData)
 {
     if (!m_swrCtx) {
@@ -289,7 +353,7 @@ bool FFmpegDecoder::resampleFrame(AVFrame* frame, QByteArray& outData)
     );
 
     int outChannels = (m_channels == 1) ? 1 : 2;
-    int outBufferSize = outSamples * outChannels * sizeof(int16_t);
+    int outBufferSize = outSamples * outChannels * sizeof(float);
     outData.resize(outBufferSize);
 
     uint8_t* outBuffer = reinterpret_cast<uint8_t*>(outData.data());
@@ -306,7 +370,7 @@ bool FFmpegDecoder::resampleFrame(AVFrame* frame, QByteArray& outData)
         return false;
     }
 
-    int actualSize = convertedSamples * outChannels * sizeof(int16_t);
+    int actualSize = convertedSamples * outChannels * sizeof(float);
     outData.resize(actualSize);
 
     return true;
@@ -326,50 +390,160 @@ void FFmpegDecoder::run()
         return;
     }
 
-    while (m_running) {
-        if (!m_decoding) {
-            QThread::msleep(10);
-            continue;
+    bool decoding = false;
+    bool paused = false;
+    bool endOfFile = false;
+    bool quit = false;
+    qint64 seekIssuedNs = 0;
+
+    // av_seek_frame lands on an earlier packet; decoded audio before the
+    // requested frame is dropped so the ring starts exactly on it.
+    qint64 trimToFrame = -1;
+    qint64 nextFrame = -1;
+
+    // PCM that did not fit into the ring yet. Kept across pause so no audio
+    // is dropped; discarded by seek, stop and close.
+    QByteArray pending;
+    int pendingOffset = 0;
+    QByteArray frameData;
+
+    while (!quit) {
+        Command command;
+        bool hasCommand = false;
+
+        {
+            QMutexLocker locker(&m_commandMutex);
+            while (m_commands.empty() && (!decoding || paused || (endOfFile && pending.isEmpty()))) {
+                m_commandCondition.wait(&m_commandMutex);
+            }
+
+            if (!m_commands.empty()) {
+                command = m_commands.front();
+                m_commands.pop_front();
+                m_commandPending = !m_commands.empty();
+                hasCommand = true;
+            }
         }
 
-        if (m_pauseRequested) {
-            QThread::msleep(10);
+        if (hasCommand) {
+            switch (command.type) {
+            case CommandType::Start:
+                if (m_stretcher.rate() != m_playbackRate.load() || !decoding) {
+                    m_stretcher.configure(m_sampleRate, (m_channels == 1) ? 1 : 2);
+                    m_stretcher.setRate(m_playbackRate.load());
+                }
+                decoding = true;
+                paused = false;
+                break;
+
+            case CommandType::Stop:
+                decoding = false;
+                pending.clear();
+                pendingOffset = 0;
+                break;
+
+            case CommandType::Pause:
+                paused = true;
+                break;
+
+            case CommandType::Resume:
+                paused = false;
+                break;
+
+            case CommandType::Seek:
+                LOG_DECODER << "Processing seek request to frame" << command.frame;
+                pending.clear();
+                pendingOffset = 0;
+                m_ringBuffer->clear();
+                endOfFile = false;
+                trimToFrame = -1;
+                m_stretcher.configure(m_sampleRate, (m_channels == 1) ? 1 : 2);
+                m_stretcher.setRate(m_playbackRate.load());
+                if (m_sampleRate > 0 && performSeek(command.frame * 1000 / m_sampleRate)) {
+                    seekIssuedNs = command.issuedNs;
+                    trimToFrame = command.frame;
+                    nextFrame = -1;
+                }
+                else {
+                    LOG_DECODER << "Seek failed";
+                }
+                break;
+
+            case CommandType::Close: {
+                decoding = false;
+                endOfFile = false;
+                pending.clear();
+                pendingOffset = 0;
+                cleanupResampler();
+                cleanupDecoder();
+
+                QMutexLocker locker(&m_commandMutex);
+                ++m_closeCompleted;
+                m_closeCondition.wakeAll();
+                break;
+            }
+
+            case CommandType::Quit:
+                quit = true;
+                break;
+            }
             continue;
         }
 
-        if (m_seekRequested) {
-            qint64 targetMs = m_seekTargetMs.load();
-            m_seekRequested = false;
+        if (!m_formatCtx || !m_codecCtx) {
+            decoding = false;
+            continue;
+        }
 
-            LOG_DECODER << "Processing seek request to" << targetMs << "ms";
+        if (!pending.isEmpty()) {
+            int written = m_ringBuffer->write(pending.constData() + pendingOffset,
+                pending.size() - pendingOffset, &m_commandPending);
 
-            m_ringBuffer->clear();
+            if (written < 0) {
+                // Ring cancelled: park until the engine restarts decoding.
+                pending.clear();
+                pendingOffset = 0;
+                decoding = false;
+                continue;
+            }
 
-            if (performSeek(targetMs)) {
-                LOG_DECODER << "Seek completed, resuming decoding";
+            if (written > 0 && seekIssuedNs > 0) {
+                qint64 latencyUs = (steadyNowNs() - seekIssuedNs) / 1000;
+                seekIssuedNs = 0;
+                m_lastSeekLatencyUs = latencyUs;
+                m_totalSeekLatencyUs += latencyUs;
+                m_seekLatencySamples++;
+                emit seekLatencyMeasured(latencyUs);
             }
-            else {
-                LOG_DECODER << "Seek failed";
+
+            pendingOffset += written;
+            if (pendingOffset >= pending.size()) {
+                pending.resize(0);
+                pendingOffset = 0;
             }
             continue;
         }
 
+        if (endOfFile) {
+            continue;
+        }
+
         int ret = av_read_frame(m_formatCtx, packet);
 
         if (ret == AVERROR_EOF) {
             LOG_DECODER << "End of file reached";
-            emit decodingFinished();
             av_packet_unref(packet);
-
-            while (m_decoding && !m_seekRequested && m_running) {
-                QThread::msleep(100);
-            }
+            m_stretcher.flush(pending);
+            endOfFile = true;
+            emit decodingFinished();
             continue;
         }
 
         if (ret < 0) {
             LOG_DECODER << "Read frame error:" << getErrorString(ret);
-            QThread::msleep(10);
+            av_packet_unref(packet);
+            endOfFile = true;
+            emit decodingFinished();
             continue;
         }
 
@@ -386,7 +560,7 @@ void FFmpegDecoder::run()
             continue;
         }
 
-        while (ret >= 0 && m_running && m_decoding) {
+        while (ret >= 0) {
             ret = avcodec_receive_frame(m_codecCtx, frame);
 
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
@@ -398,10 +572,31 @@ void FFmpegDecoder::run()
                 break;
             }
 
-            QByteArray pcmData;
-            if (resampleFrame(frame, pcmData)) {
-                m_ringBuffer->write(pcmData);
-                LOG_DECODER << "RingBuffer write buffer:" << pcmData.size();
+            if (resampleFrame(frame, frameData)) {
+                int skipBytes = 0;
+
+                if (trimToFrame >= 0) {
+                    if (nextFrame < 0) {
+                        nextFrame = frame->best_effort_timestamp != AV_NOPTS_VALUE
+                            ? ptsToFrame(frame->best_effort_timestamp)
+                            : trimToFrame;
+                    }
+
+                    const int bytesPerFrame = ((m_channels == 1) ? 1 : 2) * static_cast<int>(sizeof(float));
+                    const qint64 frames = frameData.size() / bytesPerFrame;
+                    const qint64 drop = qBound<qint64>(0, trimToFrame - nextFrame, frames);
+                    nextFrame += frames;
+                    if (nextFrame >= trimToFrame) {
+                        trimToFrame = -1;
+                    }
+                    skipBytes = static_cast<int>(drop) * bytesPerFrame;
+                }
+
+                if (skipBytes < frameData.size()) {
+                    const int bytesPerFrame = ((m_channels == 1) ? 1 : 2) * static_cast<int>(sizeof(float));
+                    m_stretcher.process(reinterpret_cast<const float*>(frameData.constData() + skipBytes),
+                        (frameData.size() - skipBytes) / bytesPerFrame, pending);
+                }
             }
 
             av_frame_unref(frame);
@@ -431,8 +626,8 @@ FFmpegAudioEngine::FFmpegAudioEngine(QObject* parent)
     , m_state(PlaybackState::Stopped)
     , m_duration(0)
     , m_volume(1.0)
-    , m_volumeAtomic(1.0)
-    , m_totalFramesPlayed(0)
+    , m_playbackRate(1.0)
+    , m_segmentCache(nullptr)
     , m_seekPositionMs(0)
     , m_currentSentenceIndex(-1)
     , m_singleSentenceLoop(false)
@@ -440,6 +635,7 @@ FFmpegAudioEngine::FFmpegAudioEngine(QObject* parent)
     , m_loopRangeEnabled(false)
     , m_loopStartMs(0)
     , m_loopEndMs(0)
+    , m_loopClipGeneration(0)
     , m_decoderEOF(false)
 {
     PaError err = Pa_Initialize();
@@ -452,11 +648,17 @@ FFmpegAudioEngine::FFmpegAudioEngine(QObject* parent)
 
     m_ringBuffer = new AudioRingBuffer(512 * 1024);
     m_decoder = new FFmpegDecoder(m_ringBuffer, this);
+    m_segmentCache = new SegmentPcmCache(this);
 
     connect(m_decoder, &FFmpegDecoder::errorOccurred,
         this, &FFmpegAudioEngine::onDecoderError);
     connect(m_decoder, &FFmpegDecoder::decodingFinished,
         this, &FFmpegAudioEngine::onDecoderFinished);
+    connect(m_decoder, &FFmpegDecoder::seekLatencyMeasured,
+        this, [this](qint64 latencyUs) {
+            LOG_ENGINE << "Seek to first audio:" << latencyUs / 1000.0 << "ms (avg"
+                << m_decoder->averageSeekLatencyUs() / 1000.0 << "ms)";
+        });
     connect(m_decoder, &FFmpegDecoder::durationChanged,
         this, [this](qint64 duration) {
             m_duration = duration;
@@ -492,17 +694,27 @@ bool FFmpegAudioEngine::loadAudio(const QString& filePath)
     }
 
     m_sampleRate = m_decoder->getSampleRate();
-    m_channels = m_decoder->getChannels();
+    m_channels = (m_decoder->getChannels() == 1) ? 1 : 2;
+    m_renderer.configure(m_ringBuffer, m_channels);
 
     if (!initPortAudio()) {
         emit audioLoaded(false, "Failed to initialize audio output");
         return false;
     }
 
+    m_filePath = filePath;
     m_decoderEOF = false;
     m_currentSentenceIndex = -1;
     m_state = PlaybackState::Stopped;
 
+    m_segmentCache->setSource(filePath, m_sampleRate, m_channels);
+
+    ++m_loopClipGeneration;
+    m_renderer.setLoopClip(nullptr);
+    if (m_loopRangeEnabled) {
+        requestLoopClip(m_loopStartMs, m_loopEndMs);
+    }
+
     emit audioLoaded(true, "Audio loaded successfully");
     LOG_ENGINE << "Audio loaded successfully, duration:" << m_duration << "ms";
 
@@ -514,7 +726,9 @@ void FFmpegAudioEngine::closeAudio()
     stop();
     cleanupPortAudio();
     m_decoder->close();
+    m_segmentCache->setSource(QString(), 0, 0);
     m_sentences.clear();
+    m_sentenceIndex.clear();
     m_currentSentenceIndex = -1;
 }
 
@@ -531,7 +745,7 @@ bool FFmpegAudioEngine::initPortAudio()
     }
 
     outputParams.channelCount = m_channels;
-    outputParams.sampleFormat = paInt16;
+    outputParams.sampleFormat = paFloat32;
     outputParams.suggestedLatency = Pa_GetDeviceInfo(outputParams.device)->defaultLowOutputLatency;
     outputParams.hostApiSpecificStreamInfo = nullptr;
 
@@ -635,7 +849,7 @@ void FFmpegAudioEngine::stop()
     m_state = PlaybackState::Stopped;
 
     m_seekPositionMs = 0;
-    m_totalFramesPlayed = 0;
+    m_renderer.setPosition(0);
 
     emit positionChanged();
     emit isPlayingChanged();
@@ -673,14 +887,38 @@ void FFmpegAudioEngine::performSeek(qint64 targetMs)
     m_ringBuffer->clear();
     m_ringBuffer->reset();
 
+    // A jump to a cached sentence plays its head from memory while the decoder
+    // seeks to where the clip ends. A different active loop owns the
+    // renderer's clip slot, so it falls back to a plain seek.
+    std::shared_ptr<const PcmClip> clip = m_segmentCache->clipStartingAt(targetMs);
+    if (clip && m_playbackRate != 1.0) {
+        clip.reset();
+    }
+    if (clip && m_loopRangeEnabled &&
+        (clip->startFrame != msToFrames(m_loopStartMs) || clip->endFrame() != msToFrames(m_loopEndMs))) {
+        clip.reset();
+    }
+
     {
         QMutexLocker locker(&m_seekMutex);
         m_seekPositionMs = targetMs;
-        m_totalFramesPlayed = 0;
+        if (clip) {
+            m_renderer.preroll(clip, m_loopRangeEnabled);
+        }
+        else {
+            m_renderer.setPosition(msToFrames(targetMs));
+        }
     }
 
-    m_decoder->seekTo(targetMs);
+    if (clip) {
+        LOG_ENGINE << "Sentence preroll from cache:" << clip->frameCount() << "frames";
+        m_decoder->seekToFrame(clip->endFrame());
+    }
+    else {
+        m_decoder->seekToFrame(msToFrames(targetMs));
+    }
     m_decoderEOF = false;
+    updateStopFrame();
 
     emit positionChanged();
 }
@@ -697,6 +935,7 @@ void FFmpegAudioEngine::startPlayback()
 
     m_decoderEOF = false;
     m_ringBuffer->reset();
+    updateStopFrame();
 
     if (m_state == PlaybackState::Paused) {
         m_decoder->resumeDecoding();
@@ -736,7 +975,12 @@ void FFmpegAudioEngine::stopPlayback()
     m_ringBuffer->clear();
     m_ringBuffer->reset();
 
-    LOG_ENGINE << "Playback stopped";
+    AudioRenderer::Stats stats = m_renderer.stats();
+    LOG_ENGINE << "Playback stopped, render blocks:" << stats.blocks
+        << "avg:" << stats.averageNs / 1000.0 << "us"
+        << "max:" << stats.maxNs / 1000.0 << "us"
+        << "starved:" << stats.starvedBlocks
+        << "device underflows:" << stats.deviceUnderflows;
 }
 
 qint64 FFmpegAudioEngine::getAudioClockMs() const
@@ -745,20 +989,18 @@ qint64 FFmpegAudioEngine::getAudioClockMs() const
         return m_seekPositionMs;
     }
 
-    QMutexLocker locker(const_cast<QMutex*>(&m_seekMutex));
-
-    qint64 framesPlayed = m_totalFramesPlayed.load();
-
+    qint64 latencyFrames = 0;
     if (m_paStream) {
         const PaStreamInfo* streamInfo = Pa_GetStreamInfo(m_paStream);
         if (streamInfo) {
-            qint64 outputLatencyFrames = static_cast<qint64>(streamInfo->outputLatency * m_sampleRate);
-            framesPlayed = qMax(0LL, framesPlayed - outputLatencyFrames);
+            latencyFrames = static_cast<qint64>(streamInfo->outputLatency * m_sampleRate);
         }
     }
 
-    qint64 elapsedMs = (framesPlayed * 1000) / m_sampleRate;
-    qint64 currentMs = m_seekPositionMs + elapsedMs;
+    // Device latency is counted in output frames; at a stretched rate each of
+    // them covers `rate` source frames.
+    latencyFrames = static_cast<qint64>(latencyFrames * m_playbackRate);
+    qint64 currentMs = m_renderer.playedPosition(latencyFrames) * 1000 / m_sampleRate;
 
     return qBound(0LL, currentMs, m_duration);
 }
@@ -767,11 +1009,16 @@ void FFmpegAudioEngine::resetAudioClock(qint64 positionMs)
 {
     QMutexLocker locker(&m_seekMutex);
     m_seekPositionMs = positionMs;
-    m_totalFramesPlayed = 0;
+    m_renderer.setPosition(msToFrames(positionMs));
 
     LOG_CLOCK << "Audio clock reset: position=" << positionMs << "ms";
 }
 
+qint64 FFmpegAudioEngine::msToFrames(qint64 ms) const
+{
+    return av_rescale(ms, m_sampleRate, 1000);
+}
+
 qint64 FFmpegAudioEngine::position() const
 {
     return getAudioClockMs();
@@ -785,7 +1032,7 @@ void FFmpegAudioEngine::setVolume(qreal volume)
     }
 
     m_volume = volume;
-    m_volumeAtomic.store(volume);
+    m_renderer.setGain(static_cast<float>(volume));
 
     emit volumeChanged();
     LOG_ENGINE << "Volume set to:" << volume;
@@ -793,17 +1040,65 @@ void FFmpegAudioEngine::setVolume(qreal volume)
 
 void FFmpegAudioEngine::setPlaybackRate(qreal rate)
 {
-    Q_UNUSED(rate);
-    LOG_ENGINE << "PlaybackRate not supported in this version";
+    rate = qBound(TimeStretcher::kMinRate, rate, TimeStretcher::kMaxRate);
+    if (qAbs(m_playbackRate - rate) < 0.005) {
+        return;
+    }
+
+    m_playbackRate = rate;
+    m_decoder->setPlaybackRate(rate);
+    m_renderer.setRate(rate);
+
+    // The ring still holds audio stretched for the old rate; re-seek so the
+    // clock, which scales ring frames by the rate, stays in source time.
+    if (m_state != PlaybackState::Stopped) {
+        seekTo(position());
+    }
+
+    emit playbackRateChanged();
+    LOG_ENGINE << "Playback rate set to:" << rate;
 }
 
 void FFmpegAudioEngine::setSentenceSegments(const QVector<SentenceSegment>& segments)
 {
     m_sentences = segments;
+    m_sentenceIndex.rebuild(m_sentences);
     m_currentSentenceIndex = -1;
+    m_segmentCache->setSentences(segments);
+    m_segmentCache->prefetchAround(0);
+    updateStopFrame();
     LOG_ENGINE << "Sentence segments set, count:" << m_sentences.size();
 }
 
+int FFmpegAudioEngine::appendSentenceSegment(const SentenceSegment& segment)
+{
+    // The list need not be sorted (edits can reorder it), so ask the index.
+    const int index = m_sentenceIndex.insertionIndex(segment.startTimeMs);
+    if (index < m_sentences.size()) {
+        LOG_ENGINE << "Out-of-order sentence inserted at" << index << "(" << segment.startTimeMs << "ms)";
+
+        m_sentences.insert(index, segment);
+        m_sentenceIndex.insert(index, segment);
+        if (m_currentSentenceIndex >= index) {
+            ++m_currentSentenceIndex;
+        }
+
+        // Cached clips are keyed by index, so everything after the insert shifts.
+        m_segmentCache->setSentences(m_sentences);
+        m_segmentCache->prefetchAround(qMax(0, m_currentSentenceIndex));
+        updateStopFrame();
+        return index;
+    }
+
+    m_sentences.append(segment);
+    m_sentenceIndex.append(segment);
+    m_segmentCache->appendSentence(segment);
+
+    // Auto-pause may have had no sentence left to stop at.
+    updateStopFrame();
+    return m_sentences.size() - 1;
+}
+
 void FFmpegAudioEngine::setCurrentSentenceIndex(int index)
 {
     if (index < 0 || index >= m_sentences.size()) {
@@ -811,6 +1106,7 @@ void FFmpegAudioEngine::setCurrentSentenceIndex(int index)
     }
 
     m_currentSentenceIndex = index;
+    m_segmentCache->prefetchAround(index);
 
     if (m_singleSentenceLoop && m_currentSentenceIndex >= 0 && m_currentSentenceIndex < m_sentences.size()) {
         const SentenceSegment& seg = m_sentences[m_currentSentenceIndex];
@@ -839,29 +1135,166 @@ void FFmpegAudioEngine::setSingleSentenceLoop(bool enable)
         clearLoopRange();
     }
 
+    updateStopFrame();
     LOG_ENGINE << "Single sentence loop:" << (enable ? "enabled" : "disabled");
 }
 
 void FFmpegAudioEngine::setAutoPauseAtSentenceEnd(bool enable)
 {
     m_autoPauseEnabled = enable;
+    updateStopFrame();
     LOG_ENGINE << "Auto pause:" << (enable ? "enabled" : "disabled");
 }
 
 void FFmpegAudioEngine::setLoopRange(qint64 startMs, qint64 endMs)
 {
+    if (m_loopRangeEnabled && m_loopStartMs == startMs && m_loopEndMs == endMs) {
+        return;
+    }
+
     m_loopRangeEnabled = true;
     m_loopStartMs = startMs;
     m_loopEndMs = endMs;
+
+    std::shared_ptr<const PcmClip> cached = m_segmentCache->clipForRange(startMs, endMs);
+    if (cached) {
+        ++m_loopClipGeneration;
+        m_renderer.setLoopClip(cached);
+    }
+    else {
+        // Until the new clip is resident the position timer loops by seeking.
+        m_renderer.setLoopClip(nullptr);
+        requestLoopClip(startMs, endMs);
+    }
+
     LOG_ENGINE << "Loop range set:" << startMs << "-" << endMs << "ms";
 }
 
 void FFmpegAudioEngine::clearLoopRange()
 {
     m_loopRangeEnabled = false;
+    ++m_loopClipGeneration;
+    m_renderer.setLoopClip(nullptr);
     LOG_ENGINE << "Loop range cleared";
 }
 
+void FFmpegAudioEngine::requestLoopClip(qint64 startMs, qint64 endMs)
+{
+    quint64 generation = ++m_loopClipGeneration;
+
+    if (m_filePath.isEmpty() || m_sampleRate <= 0 || endMs <= startMs) {
+        return;
+    }
+
+    const QString filePath = m_filePath;
+    const int sampleRate = m_sampleRate;
+    const int channels = m_channels;
+
+    auto* watcher = new QFutureWatcher<std::shared_ptr<const PcmClip>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        std::shared_ptr<const PcmClip> clip = watcher->result();
+        watcher->deleteLater();
+
+        if (generation != m_loopClipGeneration || !m_loopRangeEnabled || !clip) {
+            return;
+        }
+
+        m_renderer.setLoopClip(clip);
+        LOG_ENGINE << "Loop clip resident:" << clip->frameCount() << "frames,"
+            << clip->samples.size() * sizeof(float) / 1024 << "KB";
+        });
+
+    watcher->setFuture(QtConcurrent::run([filePath, startMs, endMs, sampleRate, channels]() {
+        return SegmentPcmCache::decodeClip(filePath, startMs, endMs, sampleRate, channels);
+        }));
+}
+
+void FFmpegAudioEngine::setSegmentCacheBudget(qint64 bytes)
+{
+    m_segmentCache->setBudgetBytes(bytes);
+    LOG_ENGINE << "Segment cache budget:" << bytes / (1024 * 1024) << "MB";
+}
+
+void FFmpegAudioEngine::setSegmentCacheLookahead(int sentences)
+{
+    m_segmentCache->setLookahead(sentences);
+    LOG_ENGINE << "Segment cache lookahead:" << sentences << "sentences";
+}
+
+void FFmpegAudioEngine::updateStopFrame()
+{
+    qint64 stopFrame = -1;
+
+    if (m_autoPauseEnabled && !m_singleSentenceLoop && m_sampleRate > 0) {
+        const qint64 position = m_renderer.position();
+        // Start a little early to absorb ms/frame rounding, then check exactly.
+        int first = m_sentenceIndex.firstEndingAfter(av_rescale(position, 1000, m_sampleRate) - 2);
+        for (int p = first; p < m_sentenceIndex.size(); ++p) {
+            qint64 endFrame = msToFrames(m_sentences[m_sentenceIndex.indexAt(p)].endTimeMs);
+            if (endFrame > position) {
+                stopFrame = endFrame;
+                break;
+            }
+        }
+    }
+
+    m_renderer.setStopFrame(stopFrame);
+}
+
+QString FFmpegAudioEngine::runRenderBenchmark()
+{
+    int channels = (m_channels > 0) ? m_channels : 2;
+    AudioRenderer::BenchmarkResult result = AudioRenderer::benchmark(channels);
+
+    QString summary = QString("Render benchmark (%1 ch, %2 frames/block, %3 blocks): "
+        "float32 renderer %4 us/block, legacy int16 path %5 us/block")
+        .arg(result.channels)
+        .arg(result.framesPerBlock)
+        .arg(result.blocks)
+        .arg(result.rendererNsPerBlock / 1000.0, 0, 'f', 3)
+        .arg(result.legacyNsPerBlock / 1000.0, 0, 'f', 3);
+
+    LOG_ENGINE << summary;
+    return summary;
+}
+
+QString FFmpegAudioEngine::runTimeStretchBenchmark()
+{
+    int sampleRate = (m_sampleRate > 0) ? m_sampleRate : 44100;
+    int channels = (m_channels > 0) ? m_channels : 2;
+    QVector<TimeStretcher::BenchmarkResult> results = TimeStretcher::benchmark(sampleRate, channels);
+
+    QStringList parts;
+    for (const TimeStretcher::BenchmarkResult& result : results) {
+        parts << QString("%1x %2 ms").arg(result.rate, 0, 'f', 2).arg(result.msPerSecond, 0, 'f', 2);
+    }
+
+    QString summary = QString("Time-stretch benchmark (%1 Hz, %2 ch), CPU per second of audio: %3")
+        .arg(sampleRate)
+        .arg(channels)
+        .arg(parts.join(", "));
+
+    LOG_ENGINE << summary;
+    return summary;
+}
+
+QString FFmpegAudioEngine::runSentenceIndexBenchmark(int sentenceCount)
+{
+    SentenceIndex::BenchmarkResult result = SentenceIndex::benchmark(qMax(1, sentenceCount));
+
+    QString summary = QString("Sentence index benchmark (%1 sentences, %2 queries), ns per lookup: "
+        "linear scan %3, binary search %4, hinted %5, visible range %6")
+        .arg(result.sentences)
+        .arg(result.queries)
+        .arg(result.linearNs, 0, 'f', 1)
+        .arg(result.searchNs, 0, 'f', 1)
+        .arg(result.hintedNs, 0, 'f', 1)
+        .arg(result.rangeNs, 0, 'f', 1);
+
+    LOG_ENGINE << summary;
+    return summary;
+}
+
 int FFmpegAudioEngine::paCallback(
     const void* inputBuffer,
     void* outputBuffer,
@@ -874,39 +1307,16 @@ int FFmpegAudioEngine::paCallback(
     Q_UNUSED(timeInfo);
 
     FFmpegAudioEngine* engine = static_cast<FFmpegAudioEngine*>(userData);
-    int16_t* out = static_cast<int16_t*>(outputBuffer);
-
-    int bytesToRead = framesPerBuffer * engine->m_channels * sizeof(int16_t);
-    QByteArray data = engine->m_ringBuffer->read(bytesToRead);
-
-    if (data.size() > 0) {
-        qreal volume = engine->m_volumeAtomic.load();
-        int16_t* samples = reinterpret_cast<int16_t*>(data.data());
-        int sampleCount = data.size() / sizeof(int16_t);
-
-        for (int i = 0; i < sampleCount; ++i) {
-            samples[i] = static_cast<int16_t>(samples[i] * volume);
-        }
-
-        memcpy(out, data.constData(), data.size());
+    float* out = static_cast<float*>(outputBuffer);
 
-        if (data.size() < bytesToRead) {
-            memset(reinterpret_cast<char*>(out) + data.size(), 0, bytesToRead - data.size());
-        }
+    int framesRead = engine->m_renderer.render(out, static_cast<int>(framesPerBuffer));
 
-        int actualFrames = data.size() / (engine->m_channels * sizeof(int16_t));
-        engine->m_totalFramesPlayed.fetch_add(actualFrames);
-    }
-    else {
-        memset(out, 0, bytesToRead);
-
-        if (engine->m_decoderEOF.load()) {
-            return paComplete;
-        }
+    if (framesRead == 0 && engine->m_decoderEOF.load()) {
+        return paComplete;
     }
 
     if (statusFlags & paOutputUnderflow) {
-        LOG_PA << "Output underflow detected";
+        engine->m_renderer.reportDeviceUnderflow();
     }
 
     return paContinue;
@@ -922,27 +1332,32 @@ void FFmpegAudioEngine::onPositionUpdateTimer()
 
     emit positionChanged();
 
-    if (m_loopRangeEnabled && currentMs >= m_loopEndMs) {
-        LOG_ENGINE << "Loop range end reached, seeking to" << m_loopStartMs;
-        seekTo(m_loopStartMs);
+    // Loop wraps and sentence-end pauses happen in the render callback; the
+    // timer only reflects them in the engine state.
+    if (m_renderer.takeStopReached()) {
+        LOG_ENGINE << "Auto pause at sentence end";
+        pause();
+        emit positionChanged();
         return;
     }
 
-    updateCurrentSentence();
-
-    if ((m_autoPauseEnabled && !m_singleSentenceLoop) &&
-        m_currentSentenceIndex >= 0 &&
-        m_currentSentenceIndex < m_sentences.size()) {
+    qint64 resyncFrame = m_renderer.takeResyncFrame();
+    if (resyncFrame >= 0) {
+        LOG_ENGINE << "Render position left the buffered stream, re-seeking";
+        seekTo(resyncFrame * 1000 / m_sampleRate);
+        return;
+    }
 
-        const SentenceSegment& seg = m_sentences[m_currentSentenceIndex];
+    m_renderer.releaseRetiredClips();
 
-        if (currentMs >= seg.endTimeMs - 10) {
-            LOG_ENGINE << "Auto pause at sentence end";
-            pause();
-            return;
-        }
+    if (m_loopRangeEnabled && !m_renderer.isLooping() && currentMs >= m_loopEndMs) {
+        LOG_ENGINE << "Loop range end reached, seeking to" << m_loopStartMs;
+        seekTo(m_loopStartMs);
+        return;
     }
 
+    updateCurrentSentence();
+
     if (m_decoderEOF) {
         bool bufferEmpty = m_ringBuffer->isEmpty();
         bool audioFinished = false;
@@ -968,7 +1383,7 @@ void FFmpegAudioEngine::onPositionUpdateTimer()
             {
                 QMutexLocker locker(&m_seekMutex);
                 m_seekPositionMs = m_duration;
-                m_totalFramesPlayed = 0;
+                m_renderer.setPosition(msToFrames(m_duration));
             }
 
             emit positionChanged();
@@ -988,22 +1403,21 @@ void FFmpegAudioEngine::updateCurrentSentence()
 
     qint64 currentMs = getAudioClockMs();
 
-    for (int i = 0; i < m_sentences.size(); ++i) {
-        if (m_sentences[i].contains(currentMs)) {
-            if (m_currentSentenceIndex != i) {
-                m_currentSentenceIndex = i;
+    int i = m_sentenceIndex.find(currentMs, m_currentSentenceIndex);
+    if (i < 0 || i == m_currentSentenceIndex) {
+        return;
+    }
 
-                if (m_singleSentenceLoop) {
-                    const SentenceSegment& seg = m_sentences[i];
-                    setLoopRange(seg.startTimeMs, seg.endTimeMs);
-                }
+    m_currentSentenceIndex = i;
+    m_segmentCache->prefetchAround(i);
 
-                emit sentenceChanged(i);
-                LOG_ENGINE << "Sentence changed to:" << i;
-            }
-            return;
-        }
+    if (m_singleSentenceLoop) {
+        const SentenceSegment& seg = m_sentences[i];
+        setLoopRange(seg.startTimeMs, seg.endTimeMs);
     }
+
+    emit sentenceChanged(i);
+    LOG_ENGINE << "Sentence changed to:" << i;
 }
 
 void FFmpegAudioEngine::onDecoderError(const QString& error)
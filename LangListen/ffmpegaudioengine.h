@@ -4,10 +4,15 @@
 #include <QObject>
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QTimer>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <portaudio.h>
+#include "audiorenderer.h"
+#include "timestretcher.h"
+#include "sentenceindex.h"
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -16,6 +21,7 @@ extern "C" {
 }
 
 class AudioRingBuffer;
+class SegmentPcmCache;
 
 class FFmpegDecoder : public QThread
 {
@@ -29,20 +35,30 @@ public:
     void close();
 
     void seekTo(qint64 positionMs);
+    // Output after the seek starts exactly on this frame (at the output rate).
+    void seekToFrame(qint64 frame);
 
     void startDecoding();
     void stopDecoding();
     void pauseDecoding();
     void resumeDecoding();
 
+    // Applied from the next seek on; the engine re-seeks after a change.
+    void setPlaybackRate(double rate) { m_playbackRate.store(rate); }
+
     qint64 getDuration() const { return m_duration; }
     int getSampleRate() const { return m_sampleRate; }
     int getChannels() const { return m_channels; }
 
+    // Time from seekTo() until the first decoded audio reached the ring.
+    qint64 lastSeekLatencyUs() const { return m_lastSeekLatencyUs.load(); }
+    double averageSeekLatencyUs() const;
+
 signals:
     void errorOccurred(const QString& error);
     void durationChanged(qint64 duration);
     void decodingFinished();
+    void seekLatencyMeasured(qint64 latencyUs);
 
 protected:
     void run() override;
@@ -58,38 +74,48 @@ private:
     int m_channels;
 
     AudioRingBuffer* m_ringBuffer;
-
-    std::atomic<bool> m_running;
-    std::atomic<bool> m_decoding;
-    std::atomic<bool> m_pauseRequested;
-    std::atomic<bool> m_seekRequested;
-    std::atomic<qint64> m_seekTargetMs;
-
+    TimeStretcher m_stretcher;
+    std::atomic<double> m_playbackRate;
+
+    enum class CommandType {
+        Start,
+        Stop,
+        Pause,
+        Resume,
+        Seek,
+        Close,
+        Quit
+    };
+
+    struct Command {
+        CommandType type;
+        qint64 frame;
+        qint64 issuedNs;
+    };
+
+    QMutex m_commandMutex;
+    QWaitCondition m_commandCondition;
+    QWaitCondition m_closeCondition;
+    std::deque<Command> m_commands;
+    std::atomic<bool> m_commandPending;
+    quint64 m_closeRequested;
+    quint64 m_closeCompleted;
+
+    std::atomic<qint64> m_lastSeekLatencyUs;
+    std::atomic<qint64> m_totalSeekLatencyUs;
+    std::atomic<int> m_seekLatencySamples;
+
+    void postCommand(CommandType type, qint64 frame = 0);
     bool initDecoder();
     void cleanupDecoder();
     bool initResampler();
     void cleanupResampler();
     bool performSeek(qint64 targetMs);
     bool resampleFrame(AVFrame* frame, QByteArray& outData);
+    qint64 ptsToFrame(int64_t pts) const;
     QString getErrorString(int errnum) const;
 };
 
-
-struct SentenceSegment {
-    qint64 startTimeMs;
-    qint64 endTimeMs;
-    QString text;
-
-    SentenceSegment() : startTimeMs(0), endTimeMs(0) {}
-    SentenceSegment(qint64 start, qint64 end, const QString& txt = QString())
-        : startTimeMs(start), endTimeMs(end), text(txt) {
-    }
-
-    bool contains(qint64 timeMs) const {
-        return timeMs >= startTimeMs && timeMs < endTimeMs;
-    }
-};
-
 enum class PlaybackState {
     Stopped,
     Playing,
@@ -118,6 +144,7 @@ public:
     Q_INVOKABLE void seekTo(qint64 positionMs);
 
     void setSentenceSegments(const QVector<SentenceSegment>& segments);
+    int appendSentenceSegment(const SentenceSegment& segment);
     void setCurrentSentenceIndex(int index);
     int getCurrentSentenceIndex() const { return m_currentSentenceIndex; }
 
@@ -129,11 +156,20 @@ public:
     Q_INVOKABLE void setLoopRange(qint64 startMs, qint64 endMs);
     Q_INVOKABLE void clearLoopRange();
 
+    Q_INVOKABLE QString runRenderBenchmark();
+    Q_INVOKABLE QString runTimeStretchBenchmark();
+    Q_INVOKABLE QString runSentenceIndexBenchmark(int sentenceCount = 2000);
+    AudioRenderer::Stats renderStats() const { return m_renderer.stats(); }
+
+    void setSegmentCacheBudget(qint64 bytes);
+    void setSegmentCacheLookahead(int sentences);
+    SegmentPcmCache* segmentCache() const { return m_segmentCache; }
+
     bool isPlaying() const { return m_state == PlaybackState::Playing; }
     qint64 position() const;
     qint64 duration() const { return m_duration; }
     qreal volume() const { return m_volume; }
-    qreal playbackRate() const { return 1.0; }
+    qreal playbackRate() const { return m_playbackRate; }
 
     void setVolume(qreal volume);
     void setPlaybackRate(qreal rate);
@@ -165,13 +201,16 @@ private:
     PlaybackState m_state;
     qint64 m_duration;
     qreal m_volume;
-    std::atomic<qreal> m_volumeAtomic;
+    qreal m_playbackRate;
+    AudioRenderer m_renderer;
+    SegmentPcmCache* m_segmentCache;
 
-    std::atomic<qint64> m_totalFramesPlayed;
     qint64 m_seekPositionMs;
     QMutex m_seekMutex;
+    QString m_filePath;
 
     QVector<SentenceSegment> m_sentences;
+    SentenceIndex m_sentenceIndex;
     int m_currentSentenceIndex;
     bool m_singleSentenceLoop;
     bool m_autoPauseEnabled;
@@ -179,6 +218,7 @@ private:
     bool m_loopRangeEnabled;
     qint64 m_loopStartMs;
     qint64 m_loopEndMs;
+    quint64 m_loopClipGeneration;
 
     QTimer* m_positionTimer;
 
@@ -193,6 +233,10 @@ private:
 
     qint64 getAudioClockMs() const;
     void resetAudioClock(qint64 positionMs);
+    qint64 msToFrames(qint64 ms) const;
+
+    void requestLoopClip(qint64 startMs, qint64 endMs);
+    void updateStopFrame();
 
     void updateCurrentSentence();
     void handleSentenceEnd();
@@ -0,0 +1,272 @@
+﻿#include "logmodel.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+namespace {
+
+const int kDefaultCapacity = 2000;
+const int kFlushIntervalMs = 1000;
+const int kMaxPendingLines = 256;
+
+QString levelName(LogLevel level)
+{
+    switch (level) {
+    case LogLevel::Warning: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    default: return "INFO";
+    }
+}
+
+LogLevel classify(const QString& message)
+{
+    if (message.startsWith("ERROR") || message.startsWith(QString("✗"))) {
+        return LogLevel::Error;
+    }
+    if (message.startsWith("WARNING") || message.startsWith(QString("⚠"))) {
+        return LogLevel::Warning;
+    }
+    return LogLevel::Info;
+}
+
+}
+
+LogModel::LogModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , m_head(0)
+    , m_count(0)
+    , m_startTime(QDateTime::currentDateTime())
+    , m_fileLogging(false)
+    , m_maxFileBytes(5 * 1024 * 1024)
+    , m_maxFiles(5)
+{
+    m_records.resize(kDefaultCapacity);
+    m_clock.start();
+
+    m_filePath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/logs/langlisten.log";
+    m_filePool.setMaxThreadCount(1);
+
+    m_flushTimer.setInterval(kFlushIntervalMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &LogModel::flushToFile);
+}
+
+LogModel::~LogModel()
+{
+    flushToFile();
+    m_filePool.waitForDone();
+}
+
+int LogModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_count) {
+        return QVariant();
+    }
+
+    const LogRecord& record = recordAt(index.row());
+    switch (role) {
+    case LevelRole:
+        return levelName(record.level);
+    case SourceRole:
+        return record.source;
+    case TimestampRole:
+        return record.elapsedMs;
+    case MessageRole:
+        return record.message;
+    case Qt::DisplayRole:
+    case TextRole:
+        return formatRecord(record);
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> LogModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[LevelRole] = "level";
+    roles[SourceRole] = "source";
+    roles[TimestampRole] = "timestamp";
+    roles[MessageRole] = "message";
+    roles[TextRole] = "text";
+    return roles;
+}
+
+void LogModel::setCapacity(int capacity)
+{
+    capacity = qMax(1, capacity);
+    if (capacity == m_records.size()) {
+        return;
+    }
+
+    // Keep the newest records that still fit.
+    const int kept = qMin(m_count, capacity);
+    QVector<LogRecord> records(capacity);
+    for (int i = 0; i < kept; ++i) {
+        records[i] = recordAt(m_count - kept + i);
+    }
+
+    beginResetModel();
+    m_records = records;
+    m_head = 0;
+    const bool countChanging = kept != m_count;
+    m_count = kept;
+    endResetModel();
+
+    emit capacityChanged();
+    if (countChanging) {
+        emit countChanged();
+    }
+}
+
+void LogModel::setFileLogging(bool enabled)
+{
+    if (m_fileLogging == enabled) {
+        return;
+    }
+
+    if (!enabled) {
+        flushToFile();
+        m_flushTimer.stop();
+    }
+    else {
+        m_flushTimer.start();
+    }
+
+    m_fileLogging = enabled;
+    emit fileLoggingChanged();
+}
+
+void LogModel::setRotation(qint64 maxFileBytes, int maxFiles)
+{
+    m_maxFileBytes = qMax<qint64>(1024, maxFileBytes);
+    m_maxFiles = qMax(1, maxFiles);
+}
+
+void LogModel::append(const QString& message, const QString& source)
+{
+    LogRecord record;
+    record.level = classify(message);
+    record.source = source;
+    record.elapsedMs = m_clock.elapsed();
+    record.message = message;
+
+    if (m_count == m_records.size()) {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_head = (m_head + 1) % m_records.size();
+        --m_count;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_count, m_count);
+    m_records[(m_head + m_count) % m_records.size()] = record;
+    ++m_count;
+    endInsertRows();
+
+    if (m_fileLogging) {
+        m_pendingLines.append(formatRecord(record));
+        if (m_pendingLines.size() >= kMaxPendingLines) {
+            flushToFile();
+        }
+    }
+
+    emit countChanged();
+}
+
+void LogModel::clear()
+{
+    if (m_count == 0) {
+        return;
+    }
+
+    beginResetModel();
+    for (LogRecord& record : m_records) {
+        record = LogRecord();
+    }
+    m_head = 0;
+    m_count = 0;
+    endResetModel();
+
+    emit countChanged();
+}
+
+QString LogModel::text() const
+{
+    QString result;
+    for (int row = 0; row < m_count; ++row) {
+        result += formatRecord(recordAt(row)) + "\n";
+    }
+    return result;
+}
+
+const LogRecord& LogModel::recordAt(int row) const
+{
+    return m_records[(m_head + row) % m_records.size()];
+}
+
+QString LogModel::formatRecord(const LogRecord& record) const
+{
+    const QString timestamp = m_startTime.addMSecs(record.elapsedMs).toString("hh:mm:ss.zzz");
+    return QString("[%1] %2 %3: %4").arg(timestamp, levelName(record.level), record.source, record.message);
+}
+
+void LogModel::flushToFile()
+{
+    if (m_pendingLines.isEmpty()) {
+        return;
+    }
+
+    const QStringList lines = m_pendingLines;
+    m_pendingLines.clear();
+
+    const QString filePath = m_filePath;
+    const qint64 maxFileBytes = m_maxFileBytes;
+    const int maxFiles = m_maxFiles;
+
+    // One thread, so batches reach the file in order.
+    QtConcurrent::run(&m_filePool, [filePath, lines, maxFileBytes, maxFiles]() {
+        writeLines(filePath, lines, maxFileBytes, maxFiles);
+        });
+}
+
+void LogModel::writeLines(const QString& filePath, const QStringList& lines, qint64 maxFileBytes, int maxFiles)
+{
+    QFileInfo info(filePath);
+    QDir().mkpath(info.absolutePath());
+
+    // langlisten.log -> langlisten.1.log -> ... -> langlisten.<maxFiles - 1>.log
+    if (info.exists() && info.size() >= maxFileBytes) {
+        const QString base = info.absolutePath() + "/" + info.completeBaseName();
+        const QString suffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+
+        QFile::remove(QString("%1.%2%3").arg(base).arg(maxFiles - 1).arg(suffix));
+        for (int i = maxFiles - 2; i >= 1; --i) {
+            QFile::rename(QString("%1.%2%3").arg(base).arg(i).arg(suffix),
+                QString("%1.%2%3").arg(base).arg(i + 1).arg(suffix));
+        }
+        if (maxFiles > 1) {
+            QFile::rename(filePath, QString("%1.1%2").arg(base, suffix));
+        }
+        else {
+            QFile::remove(filePath);
+        }
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        return;
+    }
+
+    QByteArray data;
+    for (const QString& line : lines) {
+        data += line.toUtf8();
+        data += '\n';
+    }
+    file.write(data);
+}
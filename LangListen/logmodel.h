@@ -0,0 +1,104 @@
+﻿#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+enum class LogLevel {
+    Info,
+    Warning,
+    Error
+};
+
+struct LogRecord {
+    LogLevel level;
+    QString source;
+    qint64 elapsedMs;
+    QString message;
+
+    LogRecord()
+        : level(LogLevel::Info)
+        , elapsedMs(0)
+    {
+    }
+};
+
+// Fixed-capacity ring of log records for QML. Once full, every append evicts
+// the oldest row, so views only ever see a one-row insert and remove instead
+// of a re-sent text blob. Records can additionally be written to a rotating
+// file; the writes happen in batches on a background thread.
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+        Q_PROPERTY(int count READ count NOTIFY countChanged)
+        Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+        Q_PROPERTY(bool fileLogging READ fileLogging WRITE setFileLogging NOTIFY fileLoggingChanged)
+        Q_PROPERTY(QString filePath READ filePath CONSTANT)
+
+public:
+    enum Roles {
+        LevelRole = Qt::UserRole + 1,
+        SourceRole,
+        TimestampRole,
+        MessageRole,
+        TextRole
+    };
+
+    explicit LogModel(QObject* parent = nullptr);
+    ~LogModel();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_count; }
+    int capacity() const { return m_records.size(); }
+    void setCapacity(int capacity);
+
+    bool fileLogging() const { return m_fileLogging; }
+    void setFileLogging(bool enabled);
+    QString filePath() const { return m_filePath; }
+    void setRotation(qint64 maxFileBytes, int maxFiles);
+
+    // The level is taken from an "ERROR:"/"WARNING:" prefix or a leading
+    // cross mark, which is how the workers tag their messages.
+    void append(const QString& message, const QString& source);
+    Q_INVOKABLE void clear();
+
+    // Everything currently held, one formatted line per record.
+    Q_INVOKABLE QString text() const;
+
+signals:
+    void countChanged();
+    void capacityChanged();
+    void fileLoggingChanged();
+
+private:
+    const LogRecord& recordAt(int row) const;
+    QString formatRecord(const LogRecord& record) const;
+    void flushToFile();
+    static void writeLines(const QString& filePath, const QStringList& lines, qint64 maxFileBytes, int maxFiles);
+
+    QVector<LogRecord> m_records;
+    int m_head;
+    int m_count;
+
+    QElapsedTimer m_clock;
+    QDateTime m_startTime;
+
+    bool m_fileLogging;
+    QString m_filePath;
+    qint64 m_maxFileBytes;
+    int m_maxFiles;
+    QStringList m_pendingLines;
+    QTimer m_flushTimer;
+    QThreadPool m_filePool;
+};
+
+#endif // LOGMODEL_H
@@ -315,6 +315,61 @@ Item {
                 }
             }
             
+            Button {
+                text: "取消"
+                font.pixelSize: 12
+                Layout.preferredHeight: 32
+                visible: appController.isProcessing
+                
+                background: Rectangle {
+                    color: parent.down ? "#c62828" : (parent.hovered ? "#d32f2f" : "#f44336")
+                    radius: 4
+                }
+                
+                contentItem: Text {
+                    text: parent.text
+                    font: parent.font
+                    color: "#ffffff"
+                    horizontalAlignment: Text.AlignHCenter
+                    verticalAlignment: Text.AlignVCenter
+                }
+                
+                onClicked: {
+                    appController.cancelTranscription()
+                }
+            }
+            
+            CheckBox {
+                text: "流式转写"
+                checked: appController.streamingTranscription
+                font.pixelSize: 11
+                enabled: !appController.isProcessing
+                
+                onCheckedChanged: appController.streamingTranscription = checked
+                
+                indicator: Rectangle {
+                    implicitWidth: 18
+                    implicitHeight: 18
+                    radius: 3
+                    border.color: parent.checked ? "#2196f3" : "#bdbdbd"
+                    border.width: 2
+                    color: "transparent"
+                    
+                    Rectangle {
+                        anchors.centerIn: parent
+                        width: 10
+                        height: 10
+                        radius: 2
+                        color: "#2196f3"
+                        visible: parent.parent.checked
+                    }
+                }
+                
+                ToolTip.visible: hovered
+                ToolTip.text: "边解码边转写，按 30 秒窗口逐段输出字幕"
+                ToolTip.delay: 500
+            }
+            
             Item { Layout.fillWidth: true }
             
             Label {
@@ -0,0 +1,218 @@
+﻿import QtQuick
+import QtQuick.Controls.Basic
+import QtQuick.Layouts
+
+// 后台批量转写队列：每个任务可调整优先级、暂停/继续、取消
+Popup {
+    id: queuePanel
+
+    property var jobQueue: appController.jobQueue
+
+    width: 640
+    height: 480
+    modal: true
+    padding: 16
+
+    background: Rectangle {
+        color: "#ffffff"
+        radius: 8
+        border.color: "#e3f2fd"
+        border.width: 1
+    }
+
+    function stateText(state) {
+        switch (state) {
+        case "queued": return "排队中"
+        case "running": return "转写中"
+        case "paused": return "已暂停"
+        case "done": return "已完成"
+        case "failed": return "失败"
+        case "cancelled": return "已取消"
+        case "skipped": return "已跳过"
+        }
+        return state
+    }
+
+    function stateColor(state) {
+        switch (state) {
+        case "running": return "#2196f3"
+        case "done":
+        case "skipped": return "#4caf50"
+        case "failed": return "#f44336"
+        case "paused":
+        case "cancelled": return "#9e9e9e"
+        }
+        return "#ff9800"
+    }
+
+    component QueueButton: Button {
+        property color baseColor: "#2196f3"
+
+        font.pixelSize: 11
+        padding: 6
+        Layout.preferredHeight: 28
+
+        background: Rectangle {
+            color: parent.enabled ? (parent.down ? Qt.darker(parent.baseColor, 1.3) :
+                                     (parent.hovered ? Qt.darker(parent.baseColor, 1.1) : parent.baseColor)) :
+                                    "#bdbdbd"
+            radius: 4
+        }
+
+        contentItem: Text {
+            text: parent.text
+            font: parent.font
+            color: "#ffffff"
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+        }
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        spacing: 10
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 12
+
+            Label {
+                text: "📋 转写队列"
+                font.pixelSize: 16
+                font.bold: true
+                color: "#424242"
+            }
+
+            Label {
+                text: "(" + jobQueue.runningCount + " 进行中，" + jobQueue.pendingCount + " 等待)"
+                font.pixelSize: 13
+                color: "#757575"
+            }
+
+            Item { Layout.fillWidth: true }
+
+            Label {
+                text: "并行"
+                font.pixelSize: 12
+                color: "#616161"
+            }
+
+            SpinBox {
+                from: 1
+                to: 16
+                value: jobQueue.maxConcurrentJobs
+                Layout.preferredWidth: 96
+                onValueModified: jobQueue.maxConcurrentJobs = value
+            }
+
+            QueueButton {
+                text: jobQueue.paused ? "继续队列" : "暂停队列"
+                baseColor: jobQueue.paused ? "#4caf50" : "#ff9800"
+                onClicked: jobQueue.paused = !jobQueue.paused
+            }
+
+            QueueButton {
+                text: "清除已结束"
+                baseColor: "#757575"
+                onClicked: jobQueue.clearFinished()
+            }
+        }
+
+        Label {
+            text: "将文件或文件夹拖入窗口即可加入队列"
+            font.pixelSize: 12
+            color: "#9e9e9e"
+            visible: jobListView.count === 0
+        }
+
+        ListView {
+            id: jobListView
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            clip: true
+            spacing: 6
+            model: jobQueue
+
+            delegate: Rectangle {
+                width: jobListView.width
+                height: 56
+                radius: 6
+                color: "#fafafa"
+                border.color: "#eeeeee"
+                border.width: 1
+
+                RowLayout {
+                    anchors.fill: parent
+                    anchors.margins: 8
+                    spacing: 8
+
+                    ColumnLayout {
+                        Layout.fillWidth: true
+                        spacing: 4
+
+                        Label {
+                            text: model.fileName
+                            font.pixelSize: 13
+                            color: "#424242"
+                            elide: Text.ElideMiddle
+                            Layout.fillWidth: true
+                            ToolTip.visible: fileNameArea.containsMouse
+                            ToolTip.text: model.error ? model.filePath + "\n" + model.error : model.filePath
+
+                            MouseArea {
+                                id: fileNameArea
+                                anchors.fill: parent
+                                hoverEnabled: true
+                            }
+                        }
+
+                        ProgressBar {
+                            Layout.fillWidth: true
+                            from: 0
+                            to: 100
+                            value: model.progress
+                            visible: model.state === "running"
+                        }
+                    }
+
+                    Label {
+                        text: queuePanel.stateText(model.state)
+                        font.pixelSize: 12
+                        color: queuePanel.stateColor(model.state)
+                        Layout.preferredWidth: 48
+                    }
+
+                    Label {
+                        text: "优先级"
+                        font.pixelSize: 11
+                        color: "#757575"
+                    }
+
+                    SpinBox {
+                        from: -99
+                        to: 99
+                        value: model.priority
+                        Layout.preferredWidth: 96
+                        onValueModified: jobQueue.setJobPriority(model.jobId, value)
+                    }
+
+                    QueueButton {
+                        readonly property bool canPause: model.state === "queued" || model.state === "running"
+                        text: canPause ? "暂停" : "继续"
+                        baseColor: canPause ? "#ff9800" : "#4caf50"
+                        enabled: canPause || model.state === "paused" || model.state === "failed" ||
+                                 model.state === "cancelled"
+                        onClicked: canPause ? jobQueue.pauseJob(model.jobId) : jobQueue.resumeJob(model.jobId)
+                    }
+
+                    QueueButton {
+                        text: "取消"
+                        baseColor: "#f44336"
+                        enabled: model.state === "queued" || model.state === "running" || model.state === "paused"
+                        onClicked: jobQueue.cancelJob(model.jobId)
+                    }
+                }
+            }
+        }
+    }
+}
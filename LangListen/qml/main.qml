@@ -57,12 +57,59 @@ ApplicationWindow {
         }
     }
     
+    JobQueuePanel {
+        id: jobQueuePanel
+        anchors.centerIn: Overlay.overlay
+    }
+    
+    // 拖入文件或文件夹：加入后台批量转写队列
+    DropArea {
+        anchors.fill: parent
+        keys: ["text/uri-list"]
+        onDropped: function(drop) {
+            if (!drop.hasUrls) {
+                return
+            }
+            var added = 0
+            for (var i = 0; i < drop.urls.length; i++) {
+                var path = drop.urls[i].toString()
+                path = path.replace(/^file:\/\/\//, "")
+                added += appController.jobQueue.enqueuePath(path)
+            }
+            if (added > 0) {
+                drop.acceptProposedAction()
+                jobQueuePanel.open()
+            }
+        }
+    }
+    
     Connections {
         target: appController
+        function onSegmentAdded(index) {
+            // The waveform inserts at the same sorted position as the list.
+            if (waveformView.getSentenceCount() === appController.segmentCount - 1) {
+                waveformView.addSentence(appController.getSegmentStartTime(index),
+                                         appController.getSegmentEndTime(index),
+                                         appController.getSegmentText(index))
+            }
+            // An insert before the end shifts the rows below it.
+            if (index !== appController.segmentCount - 1) {
+                subtitleListView.model = 0
+            }
+        }
         function onSegmentCountChanged() {
-            subtitleListView.model = 0
+            var currentIndex = subtitleListView.currentIndex
+            // Growing by one is a streamed segment; anything else reloads the list.
+            if (appController.segmentCount !== subtitleListView.count + 1) {
+                subtitleListView.model = 0
+            }
             subtitleListView.model = appController.segmentCount
-            loadSegmentsToWaveform()
+            if (currentIndex >= 0 && currentIndex < appController.segmentCount) {
+                subtitleListView.currentIndex = currentIndex
+            }
+            if (waveformView.getSentenceCount() !== appController.segmentCount) {
+                loadSegmentsToWaveform()
+            }
         }
         function onSegmentUpdated(index) {
             subtitleListView.model = 0
@@ -190,6 +237,30 @@ ApplicationWindow {
                     }
                 }
                 
+                Button {
+                    text: "转写队列" + (appController.jobQueue.runningCount + appController.jobQueue.pendingCount > 0 ?
+                                     " (" + (appController.jobQueue.runningCount + appController.jobQueue.pendingCount) + ")" : "")
+                    font.pixelSize: 13
+                    Layout.preferredHeight: 36
+                    
+                    background: Rectangle {
+                        color: parent.down ? "#455a64" : (parent.hovered ? "#546e7a" : "#607d8b")
+                        radius: 6
+                    }
+                    
+                    contentItem: Text {
+                        text: parent.text
+                        font: parent.font
+                        color: "#ffffff"
+                        horizontalAlignment: Text.AlignHCenter
+                        verticalAlignment: Text.AlignVCenter
+                    }
+                    
+                    onClicked: {
+                        jobQueuePanel.open()
+                    }
+                }
+                
                 Rectangle {
                     width: 100
                     height: 36
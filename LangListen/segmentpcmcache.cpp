@@ -0,0 +1,294 @@
+﻿#include "segmentpcmcache.h"
+#include "audioconverter.h"
+#include <QDebug>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <algorithm>
+
+SegmentPcmCache::SegmentPcmCache(QObject* parent)
+    : QObject(parent)
+    , m_sampleRate(0)
+    , m_channels(0)
+    , m_residentBytes(0)
+    , m_budgetBytes(32 * 1024 * 1024)
+    , m_lookahead(3)
+    , m_center(-1)
+    , m_generation(0)
+    , m_pendingIndex(-1)
+    , m_hits(0)
+    , m_misses(0)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+SegmentPcmCache::~SegmentPcmCache()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void SegmentPcmCache::setSource(const QString& filePath, int sampleRate, int channels)
+{
+    m_filePath = filePath;
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    clear();
+}
+
+void SegmentPcmCache::setSentences(const QVector<SentenceSegment>& sentences)
+{
+    m_sentences = sentences;
+    m_index.rebuild(m_sentences);
+    clear();
+}
+
+void SegmentPcmCache::appendSentence(const SentenceSegment& sentence)
+{
+    m_sentences.append(sentence);
+    m_index.append(sentence);
+
+    // The lookahead window may have been cut short by the end of the list.
+    if (m_center >= 0) {
+        fillNext();
+    }
+}
+
+void SegmentPcmCache::clear()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_clips.clear();
+    m_residentBytes = 0;
+    m_center = -1;
+    m_pendingIndex = -1;
+}
+
+void SegmentPcmCache::setBudgetBytes(qint64 bytes)
+{
+    m_budgetBytes = qMax<qint64>(0, bytes);
+
+    // Shed the entries farthest from the current sentence first.
+    while (m_residentBytes > m_budgetBytes && !m_clips.empty()) {
+        auto farthest = std::max_element(m_clips.begin(), m_clips.end(),
+            [this](const auto& a, const auto& b) {
+                return qAbs(a.first - m_center) < qAbs(b.first - m_center);
+            });
+        m_residentBytes -= clipBytes(*farthest->second);
+        m_clips.erase(farthest);
+    }
+
+    fillNext();
+}
+
+void SegmentPcmCache::setLookahead(int sentences)
+{
+    m_lookahead = qMax(0, sentences);
+    evictOutsideWindow();
+    fillNext();
+}
+
+void SegmentPcmCache::prefetchAround(int index)
+{
+    if (index < 0 || index >= m_sentences.size() || index == m_center) {
+        return;
+    }
+
+    m_center = index;
+    evictOutsideWindow();
+    fillNext();
+}
+
+std::shared_ptr<const PcmClip> SegmentPcmCache::clipStartingAt(qint64 startMs)
+{
+    const int index = m_index.startingAt(startMs);
+    if (index < 0) {
+        return nullptr;
+    }
+
+    auto found = m_clips.find(index);
+    if (found == m_clips.end()) {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    return found->second;
+}
+
+std::shared_ptr<const PcmClip> SegmentPcmCache::clipForRange(qint64 startMs, qint64 endMs) const
+{
+    for (const auto& entry : m_clips) {
+        const SentenceSegment& seg = m_sentences[entry.first];
+        if (seg.startTimeMs == startMs && seg.endTimeMs == endMs) {
+            return entry.second;
+        }
+    }
+    return nullptr;
+}
+
+SegmentPcmCache::Stats SegmentPcmCache::stats() const
+{
+    Stats result;
+    result.hits = m_hits;
+    result.misses = m_misses;
+    result.residentClips = static_cast<int>(m_clips.size());
+    result.residentBytes = m_residentBytes;
+    result.budgetBytes = m_budgetBytes;
+    return result;
+}
+
+QVector<int> SegmentPcmCache::windowOrder() const
+{
+    // Current sentence, then the next one, then the previous one, then the
+    // rest of the lookahead: the order navigation is most likely to need them.
+    QVector<int> order;
+    if (m_center < 0) {
+        return order;
+    }
+
+    order.append(m_center);
+    for (int ahead = 1; ahead <= m_lookahead; ++ahead) {
+        if (m_center + ahead < m_sentences.size()) {
+            order.append(m_center + ahead);
+        }
+        if (ahead == 1 && m_center > 0) {
+            order.append(m_center - 1);
+        }
+    }
+    if (m_lookahead == 0 && m_center > 0) {
+        order.append(m_center - 1);
+    }
+    return order;
+}
+
+bool SegmentPcmCache::inWindow(int index) const
+{
+    return m_center >= 0 && index >= m_center - 1 && index <= m_center + m_lookahead;
+}
+
+void SegmentPcmCache::evictOutsideWindow()
+{
+    for (auto it = m_clips.begin(); it != m_clips.end();) {
+        if (!inWindow(it->first)) {
+            m_residentBytes -= clipBytes(*it->second);
+            it = m_clips.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+bool SegmentPcmCache::makeRoom(int index, qint64 bytes)
+{
+    if (bytes > m_budgetBytes) {
+        return false;
+    }
+
+    const QVector<int> order = windowOrder();
+    const int rank = order.indexOf(index);
+
+    // Only entries the window ranks below the newcomer may be displaced.
+    for (int i = order.size() - 1; i > rank && m_residentBytes + bytes > m_budgetBytes; --i) {
+        auto it = m_clips.find(order[i]);
+        if (it != m_clips.end()) {
+            m_residentBytes -= clipBytes(*it->second);
+            m_clips.erase(it);
+        }
+    }
+
+    return m_residentBytes + bytes <= m_budgetBytes;
+}
+
+void SegmentPcmCache::fillNext()
+{
+    if (m_pendingIndex >= 0 || m_filePath.isEmpty() || m_sampleRate <= 0) {
+        return;
+    }
+
+    const QVector<int> order = windowOrder();
+    for (int index : order) {
+        if (m_clips.count(index)) {
+            continue;
+        }
+
+        const SentenceSegment& seg = m_sentences[index];
+        if (seg.endTimeMs <= seg.startTimeMs) {
+            continue;
+        }
+
+        const qint64 estimatedBytes = (seg.endTimeMs - seg.startTimeMs) * m_sampleRate / 1000
+            * m_channels * static_cast<qint64>(sizeof(float));
+        if (m_residentBytes + estimatedBytes > m_budgetBytes && !makeRoom(index, estimatedBytes)) {
+            return;
+        }
+
+        m_pendingIndex = index;
+
+        const quint64 generation = m_generation;
+        const QString filePath = m_filePath;
+        const qint64 startMs = seg.startTimeMs;
+        const qint64 endMs = seg.endTimeMs;
+        const int sampleRate = m_sampleRate;
+        const int channels = m_channels;
+
+        auto* watcher = new QFutureWatcher<std::shared_ptr<const PcmClip>>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation, index]() {
+            std::shared_ptr<const PcmClip> clip = watcher->result();
+            watcher->deleteLater();
+
+            if (generation != m_generation) {
+                return;
+            }
+
+            m_pendingIndex = -1;
+            if (clip && inWindow(index)) {
+                insert(index, clip);
+            }
+            fillNext();
+            });
+
+        watcher->setFuture(QtConcurrent::run(&m_pool, [filePath, startMs, endMs, sampleRate, channels]() {
+            return decodeClip(filePath, startMs, endMs, sampleRate, channels);
+            }));
+        return;
+    }
+}
+
+void SegmentPcmCache::insert(int index, std::shared_ptr<const PcmClip> clip)
+{
+    const qint64 bytes = clipBytes(*clip);
+    if (m_residentBytes + bytes > m_budgetBytes && !makeRoom(index, bytes)) {
+        return;
+    }
+
+    m_clips[index] = clip;
+    m_residentBytes += bytes;
+}
+
+qint64 SegmentPcmCache::clipBytes(const PcmClip& clip)
+{
+    return static_cast<qint64>(clip.samples.size() * sizeof(float));
+}
+
+std::shared_ptr<const PcmClip> SegmentPcmCache::decodeClip(const QString& filePath,
+    qint64 startMs, qint64 endMs, int sampleRate, int channels)
+{
+    AudioConverter converter;
+    AudioConverter::ConversionParams params;
+    params.targetSampleRate = sampleRate;
+    params.targetChannels = channels;
+    params.targetFormat = AV_SAMPLE_FMT_FLT;
+    params.startMs = startMs;
+    params.endMs = endMs;
+
+    auto clip = std::make_shared<PcmClip>();
+    clip->startFrame = av_rescale(startMs, sampleRate, 1000);
+    clip->channels = channels;
+
+    if (!converter.convertToMemory(filePath, clip->samples, params) || clip->frameCount() == 0) {
+        return nullptr;
+    }
+    return clip;
+}
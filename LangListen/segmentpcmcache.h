@@ -0,0 +1,97 @@
+﻿#ifndef SEGMENTPCMCACHE_H
+#define SEGMENTPCMCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QThreadPool>
+#include <map>
+#include <memory>
+#include "audiorenderer.h"
+#include "ffmpegaudioengine.h"
+
+// Decoded PCM for the sentences around the current one (one behind, the
+// current one and lookahead() ahead), filled one clip at a time in the
+// background and bounded by a byte budget. Sentence navigation plays the head
+// of the target sentence straight from memory while the decoder seeks.
+// Owned and used by a single thread.
+class SegmentPcmCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        int hits;
+        int misses;
+        int residentClips;
+        qint64 residentBytes;
+        qint64 budgetBytes;
+
+        Stats()
+            : hits(0)
+            , misses(0)
+            , residentClips(0)
+            , residentBytes(0)
+            , budgetBytes(0)
+        {
+        }
+    };
+
+    explicit SegmentPcmCache(QObject* parent = nullptr);
+    ~SegmentPcmCache();
+
+    void setSource(const QString& filePath, int sampleRate, int channels);
+    void setSentences(const QVector<SentenceSegment>& sentences);
+    // Keeps resident clips; indices of existing sentences are unchanged.
+    void appendSentence(const SentenceSegment& sentence);
+    void clear();
+
+    void setBudgetBytes(qint64 bytes);
+    qint64 budgetBytes() const { return m_budgetBytes; }
+    void setLookahead(int sentences);
+    int lookahead() const { return m_lookahead; }
+
+    void prefetchAround(int index);
+
+    // Clip of the sentence that starts exactly at startMs, counting a hit or
+    // a miss; nullptr if none is resident.
+    std::shared_ptr<const PcmClip> clipStartingAt(qint64 startMs);
+
+    // Resident clip covering exactly [startMs, endMs), without touching stats.
+    std::shared_ptr<const PcmClip> clipForRange(qint64 startMs, qint64 endMs) const;
+
+    Stats stats() const;
+
+    static std::shared_ptr<const PcmClip> decodeClip(const QString& filePath,
+        qint64 startMs, qint64 endMs, int sampleRate, int channels);
+
+private:
+    QVector<int> windowOrder() const;
+    bool inWindow(int index) const;
+    void evictOutsideWindow();
+    bool makeRoom(int index, qint64 bytes);
+    void fillNext();
+    void insert(int index, std::shared_ptr<const PcmClip> clip);
+    static qint64 clipBytes(const PcmClip& clip);
+
+    QString m_filePath;
+    int m_sampleRate;
+    int m_channels;
+    QVector<SentenceSegment> m_sentences;
+    SentenceIndex m_index;
+
+    std::map<int, std::shared_ptr<const PcmClip>> m_clips;
+    qint64 m_residentBytes;
+    qint64 m_budgetBytes;
+    int m_lookahead;
+    int m_center;
+
+    quint64 m_generation;
+    int m_pendingIndex;
+    QThreadPool m_pool;
+
+    int m_hits;
+    int m_misses;
+};
+
+#endif
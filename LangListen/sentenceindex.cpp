@@ -0,0 +1,237 @@
+﻿#include "sentenceindex.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <random>
+
+SentenceIndex::SentenceIndex()
+{
+}
+
+void SentenceIndex::rebuild(const QVector<SentenceSegment>& sentences)
+{
+    const int count = sentences.size();
+
+    // Stable, so sentences with equal starts keep their list order.
+    m_order.resize(count);
+    std::iota(m_order.begin(), m_order.end(), 0);
+    std::stable_sort(m_order.begin(), m_order.end(), [&sentences](int a, int b) {
+        return sentences[a].startTimeMs < sentences[b].startTimeMs;
+        });
+
+    m_starts.resize(count);
+    m_ends.resize(count);
+    m_maxEnds.resize(count);
+    m_positions.resize(count);
+
+    for (int p = 0; p < count; ++p) {
+        const SentenceSegment& sentence = sentences[m_order[p]];
+        m_starts[p] = sentence.startTimeMs;
+        m_ends[p] = sentence.endTimeMs;
+        m_positions[m_order[p]] = p;
+    }
+    updateFrom(0);
+}
+
+void SentenceIndex::insert(int index, const SentenceSegment& sentence)
+{
+    index = qBound(0, index, size());
+
+    if (index < size()) {
+        for (int& i : m_order) {
+            if (i >= index) {
+                ++i;
+            }
+        }
+    }
+
+    // After every equal start, matching the stable sort in rebuild().
+    const int p = static_cast<int>(std::upper_bound(m_starts.begin(), m_starts.end(), sentence.startTimeMs) - m_starts.begin());
+    m_starts.insert(p, sentence.startTimeMs);
+    m_ends.insert(p, sentence.endTimeMs);
+    m_maxEnds.insert(p, 0);
+    m_order.insert(p, index);
+
+    if (p == size() - 1 && index == size() - 1) {
+        m_maxEnds[p] = p > 0 ? qMax(m_maxEnds[p - 1], sentence.endTimeMs) : sentence.endTimeMs;
+        m_positions.append(p);
+        return;
+    }
+
+    m_positions.resize(size());
+    for (int q = 0; q < size(); ++q) {
+        m_positions[m_order[q]] = q;
+    }
+    updateFrom(p);
+}
+
+void SentenceIndex::updateFrom(int position)
+{
+    qint64 maxEnd = position > 0 ? m_maxEnds[position - 1] : std::numeric_limits<qint64>::min();
+    for (int p = position; p < size(); ++p) {
+        maxEnd = qMax(maxEnd, m_ends[p]);
+        m_maxEnds[p] = maxEnd;
+    }
+}
+
+void SentenceIndex::clear()
+{
+    m_starts.clear();
+    m_ends.clear();
+    m_maxEnds.clear();
+    m_order.clear();
+    m_positions.clear();
+}
+
+int SentenceIndex::find(qint64 timeMs) const
+{
+    // Last sentence starting at or before timeMs, then back over the ones that
+    // could still reach it; for disjoint sentences that is a single step.
+    int p = static_cast<int>(std::upper_bound(m_starts.begin(), m_starts.end(), timeMs) - m_starts.begin()) - 1;
+
+    int found = -1;
+    for (; p >= 0 && m_maxEnds[p] > timeMs; --p) {
+        if (m_ends[p] > timeMs && (found < 0 || m_order[p] < found)) {
+            found = m_order[p];
+        }
+    }
+    return found;
+}
+
+int SentenceIndex::find(qint64 timeMs, int hint) const
+{
+    if (hint < 0 || hint >= size()) {
+        return find(timeMs);
+    }
+
+    const int hintPosition = m_positions[hint];
+    for (int p = hintPosition; p <= hintPosition + 1 && p < size(); ++p) {
+        // Only a hit when it is the one sentence containing timeMs: nothing
+        // earlier reaches it and nothing later has started yet.
+        if (m_starts[p] <= timeMs && timeMs < m_ends[p] &&
+            (p == 0 || m_maxEnds[p - 1] <= timeMs) &&
+            (p + 1 == size() || m_starts[p + 1] > timeMs)) {
+            return m_order[p];
+        }
+    }
+    return find(timeMs);
+}
+
+void SentenceIndex::range(qint64 startMs, qint64 endMs, int& first, int& last) const
+{
+    first = firstEndingAfter(startMs);
+    last = static_cast<int>(std::lower_bound(m_starts.begin(), m_starts.end(), endMs) - m_starts.begin());
+    last = qMax(first, last);
+}
+
+int SentenceIndex::firstEndingAfter(qint64 timeMs) const
+{
+    // The running maximum first exceeds timeMs exactly at that sentence.
+    return static_cast<int>(std::upper_bound(m_maxEnds.begin(), m_maxEnds.end(), timeMs) - m_maxEnds.begin());
+}
+
+int SentenceIndex::startingAt(qint64 timeMs) const
+{
+    // Equal starts sit in list order, so the first match is the lowest index.
+    const auto it = std::lower_bound(m_starts.begin(), m_starts.end(), timeMs);
+    if (it == m_starts.end() || *it != timeMs) {
+        return -1;
+    }
+    return m_order[static_cast<int>(it - m_starts.begin())];
+}
+
+int SentenceIndex::insertionIndex(qint64 timeMs) const
+{
+    if (isEmpty()) {
+        return 0;
+    }
+
+    const int p = static_cast<int>(std::upper_bound(m_starts.begin(), m_starts.end(), timeMs) - m_starts.begin());
+    return p > 0 ? m_order[p - 1] + 1 : m_order[0];
+}
+
+SentenceIndex::BenchmarkResult SentenceIndex::benchmark(int sentenceCount, int queries)
+{
+    // Two to six second sentences with short pauses, like a transcript.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> lengthMs(2000, 6000);
+    std::uniform_int_distribution<int> gapMs(0, 800);
+
+    QVector<SentenceSegment> sentences;
+    sentences.reserve(sentenceCount);
+    qint64 pos = 0;
+    for (int i = 0; i < sentenceCount; ++i) {
+        pos += gapMs(rng);
+        const qint64 end = pos + lengthMs(rng);
+        sentences.append(SentenceSegment(pos, end));
+        pos = end;
+    }
+    const qint64 durationMs = pos;
+
+    std::uniform_int_distribution<qint64> timeMs(0, qMax<qint64>(0, durationMs - 1));
+    QVector<qint64> randomTimes(queries);
+    for (qint64& t : randomTimes) {
+        t = timeMs(rng);
+    }
+
+    SentenceIndex index;
+    index.rebuild(sentences);
+
+    BenchmarkResult result;
+    result.sentences = sentenceCount;
+    result.queries = queries;
+
+    using Clock = std::chrono::steady_clock;
+    auto nsPerQuery = [queries](Clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / qMax(1, queries);
+    };
+
+    // Accumulated so the loops are not optimized away.
+    volatile qint64 sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (qint64 t : randomTimes) {
+        int found = -1;
+        for (int i = 0; i < sentences.size(); ++i) {
+            if (sentences[i].contains(t)) {
+                found = i;
+                break;
+            }
+        }
+        sink = sink + found;
+    }
+    result.linearNs = nsPerQuery(start);
+
+    start = Clock::now();
+    for (qint64 t : randomTimes) {
+        sink = sink + index.find(t);
+    }
+    result.searchNs = nsPerQuery(start);
+
+    // Playback order: evenly spaced ticks through the whole transcript.
+    const qint64 stepMs = qMax<qint64>(1, durationMs / qMax(1, queries));
+    int hint = -1;
+    start = Clock::now();
+    for (int q = 0; q < queries; ++q) {
+        const int found = index.find(q * stepMs, hint);
+        if (found >= 0) {
+            hint = found;
+        }
+        sink = sink + found;
+    }
+    result.hintedNs = nsPerQuery(start);
+
+    // A 10 s viewport at random positions.
+    start = Clock::now();
+    for (qint64 t : randomTimes) {
+        int first = 0;
+        int last = 0;
+        index.range(t, t + 10000, first, last);
+        sink = sink + last - first;
+    }
+    result.rangeNs = nsPerQuery(start);
+
+    Q_UNUSED(sink);
+    return result;
+}
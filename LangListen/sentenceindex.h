@@ -0,0 +1,104 @@
+﻿#ifndef SENTENCEINDEX_H
+#define SENTENCEINDEX_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+struct SentenceSegment {
+    qint64 startTimeMs;
+    qint64 endTimeMs;
+    QString text;
+
+    SentenceSegment() : startTimeMs(0), endTimeMs(0) {}
+    SentenceSegment(qint64 start, qint64 end, const QString& txt = QString())
+        : startTimeMs(start), endTimeMs(end), text(txt) {
+    }
+
+    bool contains(qint64 timeMs) const {
+        return timeMs >= startTimeMs && timeMs < endTimeMs;
+    }
+};
+
+// Time lookups over a list of sentences in any order. Keeps the start times
+// sorted, with a running maximum of the end times, so overlapping sentences
+// are handled and every query is a binary search. The sort order is a
+// permutation of the list: find() and indexAt() return indices into the list
+// it was built from, while range() and firstEndingAfter() return sorted
+// positions. Rebuild, or insert(), whenever the list changes.
+class SentenceIndex
+{
+public:
+    struct BenchmarkResult {
+        int sentences;
+        int queries;
+        double linearNs;
+        double searchNs;
+        double hintedNs;
+        double rangeNs;
+
+        BenchmarkResult()
+            : sentences(0)
+            , queries(0)
+            , linearNs(0.0)
+            , searchNs(0.0)
+            , hintedNs(0.0)
+            , rangeNs(0.0)
+        {
+        }
+    };
+
+    SentenceIndex();
+
+    void rebuild(const QVector<SentenceSegment>& sentences);
+    // Mirrors QVector::insert(index, sentence) on the indexed list. Constant
+    // time when appending a sentence that starts no earlier than the others.
+    void insert(int index, const SentenceSegment& sentence);
+    void append(const SentenceSegment& sentence) { insert(size(), sentence); }
+    void clear();
+
+    int size() const { return static_cast<int>(m_starts.size()); }
+    bool isEmpty() const { return m_starts.isEmpty(); }
+
+    // Lowest index whose sentence contains timeMs, or -1. Same result as a
+    // front-to-back scan with SentenceSegment::contains().
+    int find(qint64 timeMs) const;
+
+    // As find(), but first checks hint and the sentence that starts after it,
+    // which is where sequential playback lands almost every time.
+    int find(qint64 timeMs, int hint) const;
+
+    // Sorted positions [first, last) holding every sentence that overlaps
+    // [startMs, endMs). A few inside it may not overlap when sentences do.
+    void range(qint64 startMs, qint64 endMs, int& first, int& last) const;
+
+    // First sorted position whose sentence ends after timeMs, or size().
+    int firstEndingAfter(qint64 timeMs) const;
+
+    // Lowest index whose sentence starts exactly at timeMs, or -1.
+    int startingAt(qint64 timeMs) const;
+
+    // Where insert() should put a sentence starting at timeMs: right after the
+    // last one starting at or before it, or before the earliest. size() for a
+    // new latest start, so a sorted list stays sorted.
+    int insertionIndex(qint64 timeMs) const;
+
+    // List index of the sentence at a sorted position.
+    int indexAt(int position) const { return m_order[position]; }
+
+    // Average cost per query over a synthetic transcript, against the old
+    // linear scan.
+    static BenchmarkResult benchmark(int sentenceCount, int queries = 100000);
+
+private:
+    QVector<qint64> m_starts;
+    QVector<qint64> m_ends;
+    QVector<qint64> m_maxEnds;
+    // Sorted position -> list index, and back.
+    QVector<int> m_order;
+    QVector<int> m_positions;
+
+    void updateFrom(int position);
+};
+
+#endif // SENTENCEINDEX_H
@@ -0,0 +1,11 @@
+﻿#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is part of every x86-64 target; 32-bit MSVC builds opt in with /arch:SSE2.
+// Code guarded by LANGLISTEN_SSE2 keeps a scalar fallback for other targets.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LANGLISTEN_SSE2 1
+#endif
+
+#endif // SIMD_H
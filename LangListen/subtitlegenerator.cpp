@@ -1,6 +1,7 @@
 ﻿#include "subtitlegenerator.h"
 #include <QFile>
 #include <QTextStream>
+#include <algorithm>
 
 SubtitleGenerator::SubtitleGenerator(QObject* parent)
     : QObject(parent)
@@ -11,10 +12,15 @@ SubtitleGenerator::~SubtitleGenerator()
 {
 }
 
-void SubtitleGenerator::addSegment(int64_t startTime, int64_t endTime, const QString& text)
+int SubtitleGenerator::addSegment(int64_t startTime, int64_t endTime, const QString& text)
 {
-    m_segments.append(SubtitleSegment(startTime, endTime, text.trimmed()));
-    emit segmentAdded(m_segments.size() - 1);
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), startTime,
+        [](int64_t ms, const SubtitleSegment& s) { return ms < s.startTime; });
+    const int index = static_cast<int>(it - m_segments.begin());
+
+    m_segments.insert(index, SubtitleSegment(startTime, endTime, text.trimmed()));
+    emit segmentAdded(index);
+    return index;
 }
 
 void SubtitleGenerator::clearSegments()
@@ -38,7 +38,9 @@ public:
     explicit SubtitleGenerator(QObject* parent = nullptr);
     ~SubtitleGenerator();
 
-    void addSegment(int64_t startTime, int64_t endTime, const QString& text);
+    // Inserts after every segment starting at or before startTime, the same
+    // position the playback engine and waveform use, and returns that index.
+    int addSegment(int64_t startTime, int64_t endTime, const QString& text);
     void clearSegments();
     SubtitleSegment getSegment(int index) const;
     QVector<SubtitleSegment> getAllSegments() const;
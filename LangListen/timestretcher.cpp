@@ -0,0 +1,292 @@
+﻿#include "timestretcher.h"
+#include "simd.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+float dotProduct(const float* a, const float* b, int count)
+{
+    int i = 0;
+    float sum = 0.0f;
+
+#ifdef LANGLISTEN_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+}
+
+TimeStretcher::TimeStretcher()
+    : m_sampleRate(0)
+    , m_channels(0)
+    , m_rate(1.0)
+    , m_windowFrames(0)
+    , m_hopFrames(0)
+    , m_searchFrames(0)
+    , m_inputStart(0)
+    , m_analysisPos(0.0)
+    , m_previousPos(-1)
+{
+}
+
+void TimeStretcher::configure(int sampleRate, int channels)
+{
+    if (sampleRate == m_sampleRate && channels == m_channels) {
+        reset();
+        return;
+    }
+
+    m_sampleRate = sampleRate;
+    m_channels = qMax(1, channels);
+
+    // ~25 ms windows with 50% overlap and a +-6 ms similarity search suit
+    // speech: long enough to hold a pitch period, short enough not to smear
+    // consonants.
+    m_windowFrames = qMax(64, (sampleRate / 40) & ~1);
+    m_hopFrames = m_windowFrames / 2;
+    m_searchFrames = m_windowFrames / 4;
+
+    m_window.resize(m_windowFrames);
+    for (int i = 0; i < m_windowFrames; ++i) {
+        m_window[i] = 0.5f - 0.5f * std::cos(2.0 * kPi * i / m_windowFrames);
+    }
+
+    m_overlap.assign(static_cast<size_t>(m_hopFrames) * m_channels, 0.0f);
+    reset();
+}
+
+void TimeStretcher::setRate(double rate)
+{
+    m_rate = qBound(kMinRate, rate, kMaxRate);
+    if (std::abs(m_rate - 1.0) < 0.005) {
+        m_rate = 1.0;
+    }
+    reset();
+}
+
+void TimeStretcher::reset()
+{
+    m_input.clear();
+    m_inputStart = 0;
+    m_analysisPos = 0.0;
+    m_previousPos = -1;
+    std::fill(m_overlap.begin(), m_overlap.end(), 0.0f);
+}
+
+void TimeStretcher::process(const float* input, int frames, QByteArray& out)
+{
+    if (!isActive() || m_windowFrames == 0) {
+        out.append(reinterpret_cast<const char*>(input), frames * m_channels * static_cast<int>(sizeof(float)));
+        return;
+    }
+
+    m_input.insert(m_input.end(), input, input + static_cast<size_t>(frames) * m_channels);
+
+    while (step(out)) {
+    }
+
+    discardConsumedInput();
+}
+
+void TimeStretcher::flush(QByteArray& out)
+{
+    if (!isActive() || m_previousPos < 0) {
+        reset();
+        return;
+    }
+
+    out.append(reinterpret_cast<const char*>(m_overlap.data()),
+        static_cast<int>(m_overlap.size() * sizeof(float)));
+    reset();
+}
+
+bool TimeStretcher::step(QByteArray& out)
+{
+    const qint64 available = m_inputStart + static_cast<qint64>(m_input.size()) / m_channels;
+    const qint64 nominal = static_cast<qint64>(std::llround(m_analysisPos));
+    const int channels = m_channels;
+
+    qint64 chosen = nominal;
+
+    if (m_previousPos < 0) {
+        // First segment: pass its head through unwindowed so output starts
+        // exactly on the first source frame instead of fading in.
+        if (available < nominal + m_windowFrames) {
+            return false;
+        }
+
+        const float* src = m_input.data() + (nominal - m_inputStart) * channels;
+        out.append(reinterpret_cast<const char*>(src), m_hopFrames * channels * static_cast<int>(sizeof(float)));
+        for (int i = 0; i < m_hopFrames; ++i) {
+            const float w = m_window[m_hopFrames + i];
+            for (int c = 0; c < channels; ++c) {
+                m_overlap[i * channels + c] = w * src[(m_hopFrames + i) * channels + c];
+            }
+        }
+    }
+    else {
+        const qint64 natural = m_previousPos + m_hopFrames;
+        if (available < nominal + m_searchFrames + m_windowFrames || available < natural + m_hopFrames) {
+            return false;
+        }
+
+        chosen = nominal + bestOffset(nominal, natural);
+
+        const float* src = m_input.data() + (chosen - m_inputStart) * channels;
+        const int startBytes = out.size();
+        out.resize(startBytes + m_hopFrames * channels * static_cast<int>(sizeof(float)));
+        float* dst = reinterpret_cast<float*>(out.data() + startBytes);
+
+        for (int i = 0; i < m_hopFrames; ++i) {
+            const float rising = m_window[i];
+            const float falling = m_window[m_hopFrames + i];
+            for (int c = 0; c < channels; ++c) {
+                const int k = i * channels + c;
+                dst[k] = m_overlap[k] + rising * src[k];
+                m_overlap[k] = falling * src[(m_hopFrames + i) * channels + c];
+            }
+        }
+    }
+
+    m_previousPos = chosen;
+    m_analysisPos += m_hopFrames * m_rate;
+    return true;
+}
+
+qint64 TimeStretcher::bestOffset(qint64 nominal, qint64 natural)
+{
+    // Pick the candidate around the nominal analysis position whose head best
+    // continues the previous segment (normalised cross-correlation on a mono
+    // mix), so the overlap-add stays phase-coherent.
+    const int overlapFrames = m_hopFrames;
+    const qint64 lowest = qMax(m_inputStart, nominal - m_searchFrames);
+    const int lowOffset = static_cast<int>(lowest - nominal);
+    const int candidateCount = m_searchFrames - lowOffset + 1;
+
+    buildMono(natural, overlapFrames, m_monoReference);
+    buildMono(lowest, candidateCount + overlapFrames, m_monoCandidates);
+
+    m_energyPrefix.resize(m_monoCandidates.size() + 1);
+    m_energyPrefix[0] = 0.0;
+    for (size_t i = 0; i < m_monoCandidates.size(); ++i) {
+        m_energyPrefix[i + 1] = m_energyPrefix[i] + static_cast<double>(m_monoCandidates[i]) * m_monoCandidates[i];
+    }
+
+    int best = 0;
+    double bestScore = -1e30;
+
+    for (int i = 0; i < candidateCount; ++i) {
+        const double energy = m_energyPrefix[i + overlapFrames] - m_energyPrefix[i];
+        const double corr = dotProduct(m_monoCandidates.data() + i, m_monoReference.data(), overlapFrames);
+        const double score = corr / std::sqrt(energy + 1e-9);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+
+    return lowOffset + best;
+}
+
+void TimeStretcher::buildMono(qint64 start, int frames, std::vector<float>& mono) const
+{
+    mono.resize(frames);
+    const float* src = m_input.data() + (start - m_inputStart) * m_channels;
+
+    if (m_channels == 1) {
+        memcpy(mono.data(), src, frames * sizeof(float));
+        return;
+    }
+
+    const float scale = 1.0f / m_channels;
+    for (int i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < m_channels; ++c) {
+            sum += src[i * m_channels + c];
+        }
+        mono[i] = sum * scale;
+    }
+}
+
+void TimeStretcher::discardConsumedInput()
+{
+    // Keep what the next step can still reach: the natural continuation of the
+    // last segment and the lower end of the next search range.
+    const qint64 nextNominal = static_cast<qint64>(std::llround(m_analysisPos));
+    qint64 keepFrom = nextNominal - m_searchFrames;
+    if (m_previousPos >= 0) {
+        keepFrom = qMin(keepFrom, m_previousPos + m_hopFrames);
+    }
+
+    const qint64 drop = qBound<qint64>(0, keepFrom - m_inputStart, static_cast<qint64>(m_input.size()) / m_channels);
+    if (drop > 0) {
+        m_input.erase(m_input.begin(), m_input.begin() + drop * m_channels);
+        m_inputStart += drop;
+    }
+}
+
+QVector<TimeStretcher::BenchmarkResult> TimeStretcher::benchmark(int sampleRate, int channels, int seconds)
+{
+    const int frames = sampleRate * seconds;
+    std::vector<float> source(static_cast<size_t>(frames) * channels);
+
+    // Voiced-speech stand-in: a gliding 120-220 Hz fundamental with harmonics
+    // under a 4 Hz syllable envelope.
+    double phase = 0.0;
+    for (int i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / sampleRate;
+        const double f0 = 170.0 + 50.0 * std::sin(2.0 * kPi * 0.5 * t);
+        phase += 2.0 * kPi * f0 / sampleRate;
+        const double envelope = 0.5 + 0.5 * std::sin(2.0 * kPi * 4.0 * t);
+        const float value = static_cast<float>(envelope * (0.5 * std::sin(phase) + 0.25 * std::sin(2 * phase) + 0.12 * std::sin(3 * phase)));
+        for (int c = 0; c < channels; ++c) {
+            source[static_cast<size_t>(i) * channels + c] = value;
+        }
+    }
+
+    const double rates[] = { 0.5, 0.75, 1.25, 1.5, 2.0 };
+    const int chunkFrames = 1152;
+
+    QVector<BenchmarkResult> results;
+    TimeStretcher stretcher;
+    stretcher.configure(sampleRate, channels);
+    QByteArray out;
+
+    for (double rate : rates) {
+        stretcher.setRate(rate);
+        out.reserve(static_cast<int>(source.size() * sizeof(float) / rate) + 65536);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int pos = 0; pos < frames; pos += chunkFrames) {
+            const int count = qMin(chunkFrames, frames - pos);
+            stretcher.process(source.data() + static_cast<size_t>(pos) * channels, count, out);
+        }
+        stretcher.flush(out);
+        const qint64 elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        BenchmarkResult result;
+        result.rate = rate;
+        result.msPerSecond = elapsedNs / 1e6 / seconds;
+        results.append(result);
+
+        out.resize(0);
+    }
+
+    return results;
+}
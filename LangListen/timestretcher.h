@@ -0,0 +1,74 @@
+﻿#ifndef TIMESTRETCHER_H
+#define TIMESTRETCHER_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+#include <vector>
+
+// Pitch-preserving time stretch (WSOLA) for interleaved float32 PCM. Input is
+// consumed in arbitrary chunks and output frame n corresponds to source frame
+// n * rate, so a clock that counts output frames maps back to source time by
+// multiplying with the rate. Not thread-safe; runs on the decoder thread.
+class TimeStretcher
+{
+public:
+    static constexpr double kMinRate = 0.5;
+    static constexpr double kMaxRate = 2.0;
+
+    struct BenchmarkResult {
+        double rate;
+        double msPerSecond;
+
+        BenchmarkResult()
+            : rate(1.0)
+            , msPerSecond(0.0)
+        {
+        }
+    };
+
+    TimeStretcher();
+
+    void configure(int sampleRate, int channels);
+    void setRate(double rate);
+    double rate() const { return m_rate; }
+    bool isActive() const { return m_rate != 1.0; }
+
+    void reset();
+
+    // Appends the stretched output for the given input frames to out.
+    void process(const float* input, int frames, QByteArray& out);
+    // Emits everything still buffered; call at end of stream.
+    void flush(QByteArray& out);
+
+    // Processing cost per second of source audio at each rate, on synthetic
+    // speech-like input.
+    static QVector<BenchmarkResult> benchmark(int sampleRate, int channels, int seconds = 10);
+
+private:
+    bool step(QByteArray& out);
+    qint64 bestOffset(qint64 nominal, qint64 natural);
+    void buildMono(qint64 start, int frames, std::vector<float>& mono) const;
+    void discardConsumedInput();
+
+    int m_sampleRate;
+    int m_channels;
+    double m_rate;
+
+    int m_windowFrames;
+    int m_hopFrames;
+    int m_searchFrames;
+    std::vector<float> m_window;
+
+    std::vector<float> m_input;
+    qint64 m_inputStart;
+    double m_analysisPos;
+    qint64 m_previousPos;
+    std::vector<float> m_overlap;
+
+    std::vector<float> m_monoCandidates;
+    std::vector<float> m_monoReference;
+    std::vector<double> m_energyPrefix;
+};
+
+#endif // TIMESTRETCHER_H
@@ -0,0 +1,698 @@
+﻿#include "transcriptionjobqueue.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+namespace {
+
+const int kStoreVersion = 1;
+const qint64 kHashSpanBytes = 1024 * 1024;
+
+const QStringList& mediaPatterns()
+{
+    static const QStringList patterns = {
+        "*.wav", "*.mp3", "*.m4a", "*.flac", "*.ogg", "*.opus", "*.aac", "*.wma",
+        "*.mp4", "*.mkv", "*.mov", "*.webm"
+    };
+    return patterns;
+}
+
+QString stateName(JobState state)
+{
+    switch (state) {
+    case JobState::Queued: return "queued";
+    case JobState::Running: return "running";
+    case JobState::Paused: return "paused";
+    case JobState::Done: return "done";
+    case JobState::Failed: return "failed";
+    case JobState::Cancelled: return "cancelled";
+    case JobState::Skipped: return "skipped";
+    }
+    return "queued";
+}
+
+JobState stateFromName(const QString& name)
+{
+    for (JobState state : { JobState::Queued, JobState::Running, JobState::Paused, JobState::Done,
+        JobState::Failed, JobState::Cancelled, JobState::Skipped }) {
+        if (stateName(state) == name) {
+            return state;
+        }
+    }
+    return JobState::Queued;
+}
+
+bool isActive(JobState state)
+{
+    return state == JobState::Queued || state == JobState::Running || state == JobState::Paused;
+}
+
+}
+
+TranscriptionJobQueue::TranscriptionJobQueue(const QString& storePath, QObject* parent)
+    : QAbstractListModel(parent)
+    , m_storePath(storePath)
+    , m_nextId(1)
+    , m_paused(false)
+    , m_maxConcurrentJobs(qMax(1, QThread::idealThreadCount() / 4))
+{
+    if (m_storePath.isEmpty()) {
+        m_storePath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/jobqueue.json";
+    }
+
+    // Each worker infers on one state with a handful of threads; parallelism
+    // comes from running several files.
+    m_options.privateState = true;
+    m_options.streaming = false;
+    m_options.parallelStates = 1;
+    m_options.journal = true;
+
+    load();
+}
+
+TranscriptionJobQueue::~TranscriptionJobQueue()
+{
+    save();
+
+    for (Slot* slot : m_slots) {
+        slot->worker->requestCancel();
+    }
+
+    for (Slot* slot : m_slots) {
+        slot->thread->quit();
+        slot->thread->wait();
+        delete slot->worker;
+        delete slot;
+    }
+}
+
+int TranscriptionJobQueue::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_jobs.size();
+}
+
+QVariant TranscriptionJobQueue::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_jobs.size()) {
+        return QVariant();
+    }
+
+    const TranscriptionJob& job = m_jobs[index.row()];
+    switch (role) {
+    case IdRole:
+        return job.id;
+    case FilePathRole:
+        return job.filePath;
+    case Qt::DisplayRole:
+    case FileNameRole:
+        return QFileInfo(job.filePath).fileName();
+    case PriorityRole:
+        return job.priority;
+    case StateRole:
+        return stateName(job.state);
+    case ErrorRole:
+        return job.error;
+    case ProgressRole:
+        return job.progress;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> TranscriptionJobQueue::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[IdRole] = "jobId";
+    roles[FilePathRole] = "filePath";
+    roles[FileNameRole] = "fileName";
+    roles[PriorityRole] = "priority";
+    roles[StateRole] = "state";
+    roles[ErrorRole] = "error";
+    roles[ProgressRole] = "progress";
+    return roles;
+}
+
+void TranscriptionJobQueue::setModelPath(const QString& modelPath)
+{
+    m_modelPath = modelPath;
+    schedule();
+}
+
+void TranscriptionJobQueue::setTranscriptionOptions(const TranscriptionOptions& options)
+{
+    m_options = options;
+    m_options.privateState = true;
+    m_options.streaming = false;
+    m_options.parallelStates = 1;
+    m_options.journal = true;
+}
+
+void TranscriptionJobQueue::setPaused(bool paused)
+{
+    if (m_paused == paused) {
+        return;
+    }
+
+    m_paused = paused;
+    emit pausedChanged();
+    save();
+    schedule();
+}
+
+void TranscriptionJobQueue::setMaxConcurrentJobs(int count)
+{
+    count = qBound(1, count, qMax(1, QThread::idealThreadCount()));
+    if (m_maxConcurrentJobs == count) {
+        return;
+    }
+
+    m_maxConcurrentJobs = count;
+    emit maxConcurrentJobsChanged();
+    schedule();
+}
+
+int TranscriptionJobQueue::pendingCount() const
+{
+    int count = 0;
+    for (const TranscriptionJob& job : m_jobs) {
+        if (job.state == JobState::Queued) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int TranscriptionJobQueue::runningCount() const
+{
+    int count = 0;
+    for (const TranscriptionJob& job : m_jobs) {
+        if (job.state == JobState::Running) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int TranscriptionJobQueue::enqueuePath(const QString& path, int priority)
+{
+    QFileInfo info(path);
+    int added = 0;
+
+    if (info.isDir()) {
+        QStringList files;
+        QDirIterator it(info.absoluteFilePath(), mediaPatterns(), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files.append(it.next());
+        }
+        files.sort();
+
+        for (const QString& file : files) {
+            if (enqueueFile(file, priority)) {
+                ++added;
+            }
+        }
+    }
+    else if (info.isFile() && enqueueFile(info.absoluteFilePath(), priority)) {
+        ++added;
+    }
+
+    if (added > 0) {
+        emit logMessage(QString("Job queue: added %1 file(s) from %2").arg(added).arg(path));
+        emit countsChanged();
+        save();
+        schedule();
+    }
+    return added;
+}
+
+bool TranscriptionJobQueue::enqueueFile(const QString& filePath, int priority)
+{
+    for (const TranscriptionJob& job : m_jobs) {
+        if (job.filePath == filePath && isActive(job.state)) {
+            return false;
+        }
+    }
+
+    TranscriptionJob job;
+    job.id = m_nextId++;
+    job.filePath = filePath;
+    job.priority = priority;
+
+    beginInsertRows(QModelIndex(), m_jobs.size(), m_jobs.size());
+    m_jobs.append(job);
+    endInsertRows();
+    return true;
+}
+
+void TranscriptionJobQueue::pauseJob(int id)
+{
+    int row = rowOf(id);
+    if (row < 0) {
+        return;
+    }
+
+    TranscriptionJob& job = m_jobs[row];
+    if (job.state == JobState::Queued || job.state == JobState::Running) {
+        job.stopping = cancelRunning(id);
+        setJobState(job, JobState::Paused);
+        schedule();
+    }
+}
+
+void TranscriptionJobQueue::resumeJob(int id)
+{
+    int row = rowOf(id);
+    if (row < 0) {
+        return;
+    }
+
+    TranscriptionJob& job = m_jobs[row];
+    if (job.state == JobState::Paused || job.state == JobState::Failed || job.state == JobState::Cancelled) {
+        job.progress = 0;
+        setJobState(job, JobState::Queued);
+        schedule();
+    }
+}
+
+void TranscriptionJobQueue::cancelJob(int id)
+{
+    int row = rowOf(id);
+    if (row < 0) {
+        return;
+    }
+
+    TranscriptionJob& job = m_jobs[row];
+    if (isActive(job.state)) {
+        job.stopping = cancelRunning(id);
+        setJobState(job, JobState::Cancelled);
+        schedule();
+    }
+}
+
+void TranscriptionJobQueue::setJobPriority(int id, int priority)
+{
+    int row = rowOf(id);
+    if (row < 0 || m_jobs[row].priority == priority) {
+        return;
+    }
+
+    m_jobs[row].priority = priority;
+    notifyRow(row);
+    save();
+}
+
+void TranscriptionJobQueue::clearFinished()
+{
+    for (int row = m_jobs.size() - 1; row >= 0; --row) {
+        if (!isActive(m_jobs[row].state) && !m_jobs[row].stopping) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_jobs.removeAt(row);
+            endRemoveRows();
+        }
+    }
+    save();
+}
+
+QString TranscriptionJobQueue::partialHash(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    // Size plus head and tail: cheap on multi-gigabyte files and still changes
+    // when a file is re-encoded, truncated or replaced.
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const qint64 size = file.size();
+    hash.addData(QByteArray::number(size));
+    hash.addData(file.read(kHashSpanBytes));
+    if (size > kHashSpanBytes) {
+        file.seek(qMax(kHashSpanBytes, size - kHashSpanBytes));
+        hash.addData(file.read(kHashSpanBytes));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString TranscriptionJobQueue::subtitlePath(const QString& filePath)
+{
+    QFileInfo info(filePath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".srt";
+}
+
+void TranscriptionJobQueue::schedule()
+{
+    if (m_paused || m_modelPath.isEmpty()) {
+        return;
+    }
+
+    // Busy slots include paused or cancelled runs still winding down, so a
+    // pause never starts a job beyond the limit.
+    while (busySlotCount() < m_maxConcurrentJobs) {
+        int best = -1;
+        for (int row = 0; row < m_jobs.size(); ++row) {
+            if (m_jobs[row].state == JobState::Queued && !isStopping(m_jobs[row].filePath) &&
+                (best < 0 || m_jobs[row].priority > m_jobs[best].priority)) {
+                best = row;
+            }
+        }
+        if (best < 0) {
+            return;
+        }
+
+        Slot* slot = idleSlot();
+        if (!slot) {
+            return;
+        }
+        startJob(slot, m_jobs[best]);
+    }
+}
+
+int TranscriptionJobQueue::busySlotCount() const
+{
+    int count = 0;
+    for (const Slot* slot : m_slots) {
+        if (slot->jobId >= 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+TranscriptionJobQueue::Slot* TranscriptionJobQueue::idleSlot()
+{
+    for (Slot* slot : m_slots) {
+        if (slot->jobId < 0) {
+            return slot;
+        }
+    }
+
+    // Slots of paused/cancelled jobs stay busy until their worker has stopped.
+    if (m_slots.size() >= m_maxConcurrentJobs) {
+        return nullptr;
+    }
+
+    auto* slot = new Slot();
+    slot->thread = new QThread(this);
+    slot->worker = new WhisperWorker();
+    slot->worker->moveToThread(slot->thread);
+    slot->subtitles = new SubtitleGenerator(this);
+    m_slots.append(slot);
+
+    connect(slot->worker, &WhisperWorker::logMessage, this, [this](const QString& message) {
+        if (message.startsWith("ERROR")) {
+            emit logMessage("Job queue: " + message);
+        }
+        });
+    connect(slot->worker, &WhisperWorker::segmentReady, this, [slot](qint64 startMs, qint64 endMs, const QString& text) {
+        slot->subtitles->addSegment(startMs, endMs, text);
+        });
+    connect(slot->worker, &WhisperWorker::transcriptionProgress, this, [this, slot](int progress) {
+        int row = rowOf(slot->jobId);
+        if (row >= 0 && m_jobs[row].run == slot->run && m_jobs[row].state == JobState::Running) {
+            m_jobs[row].progress = progress;
+            notifyRow(row);
+        }
+        });
+    connect(slot->worker, &WhisperWorker::transcriptionCompleted, this, [this, slot]() {
+        onJobFinished(slot, true, QString());
+        });
+    connect(slot->worker, &WhisperWorker::transcriptionFailed, this, [this, slot](const QString& error) {
+        onJobFinished(slot, false, error);
+        });
+    connect(slot->worker, &WhisperWorker::transcriptionCancelled, this, [this, slot]() {
+        onJobFinished(slot, false, "Cancelled");
+        });
+
+    slot->thread->start(QThread::LowPriority);
+    return slot;
+}
+
+void TranscriptionJobQueue::startJob(Slot* slot, TranscriptionJob& job)
+{
+    ++job.run;
+    job.progress = 0;
+    setJobState(job, JobState::Running);
+
+    slot->jobId = job.id;
+    slot->run = job.run;
+    slot->timer.start();
+
+    const int jobId = job.id;
+    const int run = job.run;
+    const QString filePath = job.filePath;
+
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, slot, jobId, run]() {
+        QString hash = watcher->result();
+        watcher->deleteLater();
+        onHashReady(slot, jobId, run, hash);
+        });
+    watcher->setFuture(QtConcurrent::run([filePath]() {
+        return partialHash(filePath);
+        }));
+}
+
+void TranscriptionJobQueue::onHashReady(Slot* slot, int jobId, int run, const QString& hash)
+{
+    int row = rowOf(jobId);
+    if (row < 0 || m_jobs[row].run != run || m_jobs[row].state != JobState::Running) {
+        releaseSlot(slot);
+        schedule();
+        return;
+    }
+
+    TranscriptionJob& job = m_jobs[row];
+
+    if (hash.isEmpty()) {
+        setJobState(job, JobState::Failed, "Cannot read " + job.filePath);
+        releaseSlot(slot);
+        schedule();
+        return;
+    }
+
+    job.inputHash = hash;
+
+    if (QFileInfo::exists(subtitlePath(job.filePath)) && m_completedHashes.value(job.filePath) == hash) {
+        job.progress = 100;
+        setJobState(job, JobState::Skipped);
+        emit jobFinished(job.id, job.filePath, true);
+        releaseSlot(slot);
+        schedule();
+        return;
+    }
+
+    slot->subtitles->clearSegments();
+
+    WhisperWorker* worker = slot->worker;
+    worker->resetCancel();
+
+    const QString modelPath = m_modelPath;
+    const QString filePath = job.filePath;
+    TranscriptionOptions options = m_options;
+    // Concurrent jobs share the cores rather than each claiming all of them.
+    options.threadBudget = qMax(1, QThread::idealThreadCount() / m_maxConcurrentJobs);
+    QMetaObject::invokeMethod(worker, [worker, modelPath, filePath, options]() {
+        worker->setTranscriptionOptions(options);
+        // Cached after the first job; a failure makes transcribe() report it.
+        worker->initModel(modelPath);
+        worker->transcribe(filePath);
+        }, Qt::QueuedConnection);
+}
+
+void TranscriptionJobQueue::onJobFinished(Slot* slot, bool success, const QString& error)
+{
+    const int row = rowOf(slot->jobId);
+    const bool current = row >= 0 && m_jobs[row].run == slot->run && m_jobs[row].state == JobState::Running;
+
+    if (current) {
+        TranscriptionJob& job = m_jobs[row];
+        job.elapsedMs = slot->timer.elapsed();
+        job.audioSeconds = slot->worker->getAudioDuration();
+
+        if (success && !slot->subtitles->saveSRT(subtitlePath(job.filePath))) {
+            success = false;
+            job.error = "Cannot write " + subtitlePath(job.filePath);
+        }
+
+        if (success) {
+            m_completedHashes.insert(job.filePath, job.inputHash);
+            job.progress = 100;
+            setJobState(job, JobState::Done);
+            emit logMessage(QString("Job queue: %1 done, %2 s audio in %3 s")
+                .arg(QFileInfo(job.filePath).fileName())
+                .arg(job.audioSeconds, 0, 'f', 1)
+                .arg(job.elapsedMs / 1000.0, 0, 'f', 1));
+        }
+        else {
+            setJobState(job, JobState::Failed, job.error.isEmpty() ? error : job.error);
+            emit logMessage(QString("ERROR: Job queue: %1 failed: %2")
+                .arg(QFileInfo(job.filePath).fileName(), m_jobs[row].error));
+        }
+        emit jobFinished(job.id, job.filePath, success);
+    }
+
+    releaseSlot(slot);
+    schedule();
+}
+
+void TranscriptionJobQueue::releaseSlot(Slot* slot)
+{
+    const int row = rowOf(slot->jobId);
+    if (row >= 0) {
+        m_jobs[row].stopping = false;
+    }
+
+    slot->jobId = -1;
+    slot->subtitles->clearSegments();
+}
+
+bool TranscriptionJobQueue::cancelRunning(int jobId)
+{
+    // Stops decode or inference promptly; the slot is released once the
+    // worker reports back, and its partial output is dropped with the run.
+    bool found = false;
+    for (Slot* slot : m_slots) {
+        if (slot->jobId == jobId) {
+            slot->worker->requestCancel();
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Also covers a new job for the same file queued after the old one was cancelled.
+bool TranscriptionJobQueue::isStopping(const QString& filePath) const
+{
+    for (const TranscriptionJob& job : m_jobs) {
+        if (job.stopping && job.filePath == filePath) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranscriptionJobQueue::setJobState(TranscriptionJob& job, JobState state, const QString& error)
+{
+    job.state = state;
+    job.error = error;
+    notifyRow(rowOf(job.id));
+    emit countsChanged();
+    save();
+}
+
+int TranscriptionJobQueue::rowOf(int id) const
+{
+    for (int row = 0; row < m_jobs.size(); ++row) {
+        if (m_jobs[row].id == id) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+void TranscriptionJobQueue::notifyRow(int row)
+{
+    if (row >= 0) {
+        emit dataChanged(index(row), index(row));
+    }
+}
+
+bool TranscriptionJobQueue::load()
+{
+    QFile file(m_storePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    QJsonObject root = document.object();
+    if (root.value("version").toInt() != kStoreVersion) {
+        return false;
+    }
+
+    m_paused = root.value("paused").toBool();
+
+    const QJsonObject completed = root.value("completed").toObject();
+    for (auto it = completed.begin(); it != completed.end(); ++it) {
+        m_completedHashes.insert(it.key(), it.value().toString());
+    }
+
+    int resumed = 0;
+    for (const QJsonValue& value : root.value("jobs").toArray()) {
+        const QJsonObject object = value.toObject();
+
+        TranscriptionJob job;
+        job.id = object.value("id").toInt();
+        job.filePath = object.value("path").toString();
+        job.priority = object.value("priority").toInt();
+        job.state = stateFromName(object.value("state").toString());
+        job.inputHash = object.value("hash").toString();
+        job.error = object.value("error").toString();
+        job.audioSeconds = object.value("audioSeconds").toDouble();
+        job.elapsedMs = static_cast<qint64>(object.value("elapsedMs").toDouble());
+
+        // Interrupted by a crash or exit: queue it again. Its journal lets the
+        // worker continue after the last segment written.
+        if (job.state == JobState::Running) {
+            job.state = JobState::Queued;
+            ++resumed;
+        }
+        if (job.state == JobState::Done || job.state == JobState::Skipped) {
+            job.progress = 100;
+        }
+
+        m_nextId = qMax(m_nextId, job.id + 1);
+        m_jobs.append(job);
+    }
+
+    if (resumed > 0) {
+        emit logMessage(QString("Job queue: resuming %1 interrupted job(s)").arg(resumed));
+    }
+    return true;
+}
+
+void TranscriptionJobQueue::save() const
+{
+    QJsonArray jobs;
+    for (const TranscriptionJob& job : m_jobs) {
+        QJsonObject object;
+        object["id"] = job.id;
+        object["path"] = job.filePath;
+        object["priority"] = job.priority;
+        object["state"] = stateName(job.state);
+        object["hash"] = job.inputHash;
+        object["error"] = job.error;
+        object["audioSeconds"] = job.audioSeconds;
+        object["elapsedMs"] = static_cast<double>(job.elapsedMs);
+        jobs.append(object);
+    }
+
+    QJsonObject completed;
+    for (auto it = m_completedHashes.begin(); it != m_completedHashes.end(); ++it) {
+        completed[it.key()] = it.value();
+    }
+
+    QJsonObject root;
+    root["version"] = kStoreVersion;
+    root["paused"] = m_paused;
+    root["jobs"] = jobs;
+    root["completed"] = completed;
+
+    QDir().mkpath(QFileInfo(m_storePath).absolutePath());
+
+    QSaveFile file(m_storePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
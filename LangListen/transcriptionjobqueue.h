@@ -0,0 +1,165 @@
+﻿#ifndef TRANSCRIPTIONJOBQUEUE_H
+#define TRANSCRIPTIONJOBQUEUE_H
+
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include "whisperworker.h"
+#include "subtitlegenerator.h"
+
+enum class JobState {
+    Queued,
+    Running,
+    Paused,
+    Done,
+    Failed,
+    Cancelled,
+    Skipped
+};
+
+struct TranscriptionJob {
+    int id;
+    QString filePath;
+    int priority;
+    JobState state;
+    QString inputHash;
+    QString error;
+    int progress;
+    double audioSeconds;
+    qint64 elapsedMs;
+    // Bumped on every start so a result from an abandoned run is recognized.
+    int run;
+    // A paused or cancelled run whose worker has not reported back yet. The
+    // file is not started again until that slot is released, so two workers
+    // never write the same journal.
+    bool stopping;
+
+    TranscriptionJob()
+        : id(0)
+        , priority(0)
+        , state(JobState::Queued)
+        , progress(0)
+        , audioSeconds(0.0)
+        , elapsedMs(0)
+        , run(0)
+        , stopping(false)
+    {
+    }
+};
+
+// Folder-scale transcription in the background. Jobs are kept in a JSON file
+// and reloaded on start; jobs that were running when the app stopped are
+// queued again, and their transcription journals let them continue after the
+// last segment written. The highest-priority queued job runs next on one of up to
+// maxConcurrentJobs WhisperWorkers, which share the cached model context and
+// each use a private whisper_state. A file is skipped when its SRT exists and
+// its input hash (size plus the first and last megabyte) matches the one
+// recorded when that SRT was written.
+class TranscriptionJobQueue : public QAbstractListModel
+{
+    Q_OBJECT
+        Q_PROPERTY(bool paused READ paused WRITE setPaused NOTIFY pausedChanged)
+        Q_PROPERTY(int maxConcurrentJobs READ maxConcurrentJobs WRITE setMaxConcurrentJobs NOTIFY maxConcurrentJobsChanged)
+        Q_PROPERTY(int pendingCount READ pendingCount NOTIFY countsChanged)
+        Q_PROPERTY(int runningCount READ runningCount NOTIFY countsChanged)
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        FilePathRole,
+        FileNameRole,
+        PriorityRole,
+        StateRole,
+        ErrorRole,
+        ProgressRole
+    };
+
+    explicit TranscriptionJobQueue(const QString& storePath = QString(), QObject* parent = nullptr);
+    ~TranscriptionJobQueue();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void setModelPath(const QString& modelPath);
+    void setTranscriptionOptions(const TranscriptionOptions& options);
+
+    bool paused() const { return m_paused; }
+    void setPaused(bool paused);
+    int maxConcurrentJobs() const { return m_maxConcurrentJobs; }
+    void setMaxConcurrentJobs(int count);
+    int pendingCount() const;
+    int runningCount() const;
+
+    // Files and folders (searched recursively for media files). Returns the
+    // number of jobs added; paths already queued or running are ignored.
+    Q_INVOKABLE int enqueuePath(const QString& path, int priority = 0);
+    Q_INVOKABLE void pauseJob(int id);
+    Q_INVOKABLE void resumeJob(int id);
+    Q_INVOKABLE void cancelJob(int id);
+    Q_INVOKABLE void setJobPriority(int id, int priority);
+    Q_INVOKABLE void clearFinished();
+
+    static QString partialHash(const QString& filePath);
+    static QString subtitlePath(const QString& filePath);
+
+signals:
+    void jobFinished(int id, const QString& filePath, bool success);
+    void pausedChanged();
+    void maxConcurrentJobsChanged();
+    void countsChanged();
+    void logMessage(const QString& message);
+
+private:
+    struct Slot {
+        QThread* thread;
+        WhisperWorker* worker;
+        SubtitleGenerator* subtitles;
+        int jobId;
+        int run;
+        QElapsedTimer timer;
+
+        Slot()
+            : thread(nullptr)
+            , worker(nullptr)
+            , subtitles(nullptr)
+            , jobId(-1)
+            , run(0)
+        {
+        }
+    };
+
+    bool enqueueFile(const QString& filePath, int priority);
+    void schedule();
+    Slot* idleSlot();
+    int busySlotCount() const;
+    void startJob(Slot* slot, TranscriptionJob& job);
+    void onHashReady(Slot* slot, int jobId, int run, const QString& hash);
+    void onJobFinished(Slot* slot, bool success, const QString& error);
+    void releaseSlot(Slot* slot);
+    bool cancelRunning(int jobId);
+    bool isStopping(const QString& filePath) const;
+    void setJobState(TranscriptionJob& job, JobState state, const QString& error = QString());
+    int rowOf(int id) const;
+    void notifyRow(int row);
+
+    bool load();
+    void save() const;
+
+    QString m_storePath;
+    QString m_modelPath;
+    TranscriptionOptions m_options;
+    QVector<TranscriptionJob> m_jobs;
+    // Input hash per file whose SRT this queue wrote; outlives clearFinished().
+    QHash<QString, QString> m_completedHashes;
+    QVector<Slot*> m_slots;
+    int m_nextId;
+    bool m_paused;
+    int m_maxConcurrentJobs;
+};
+
+#endif // TRANSCRIPTIONJOBQUEUE_H
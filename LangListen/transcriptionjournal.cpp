@@ -0,0 +1,214 @@
+﻿#include "transcriptionjournal.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int kJournalVersion = 1;
+// Bounds what a crash can lose without paying an fsync per segment.
+const int kSyncBatch = 32;
+const int kSyncIntervalMs = 2000;
+
+bool syncToDisk(int fd)
+{
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+
+}
+
+TranscriptionJournal::TranscriptionJournal()
+    : m_pending(0)
+{
+}
+
+TranscriptionJournal::~TranscriptionJournal()
+{
+    close();
+}
+
+QString TranscriptionJournal::journalPath(const QString& audioPath)
+{
+    QByteArray key = QCryptographicHash::hash(QFileInfo(audioPath).absoluteFilePath().toUtf8(),
+        QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+        + "/journals/" + QString::fromLatin1(key) + ".jsonl";
+}
+
+bool TranscriptionJournal::open(const QString& audioPath, const QString& settings, std::vector<Segment>& recovered)
+{
+    close();
+    recovered.clear();
+    m_stats = Stats();
+    m_lastError.clear();
+
+    QFileInfo info(audioPath);
+    QJsonObject header;
+    header["version"] = kJournalVersion;
+    header["path"] = info.absoluteFilePath();
+    header["size"] = info.size();
+    header["modified"] = info.lastModified().toMSecsSinceEpoch();
+    header["settings"] = settings;
+
+    const QString path = journalPath(audioPath);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Stale only when the owner died; a long transcription must keep its lock.
+    m_lock.reset(new QLockFile(path + ".lock"));
+    m_lock->setStaleLockTime(0);
+    if (!m_lock->tryLock(0)) {
+        m_lastError = m_lock->error() == QLockFile::LockFailedError
+            ? QString("journal is in use by another transcription")
+            : QString("cannot create journal lock");
+        m_lock.reset();
+        return false;
+    }
+
+    qint64 validBytes = 0;
+    QFile existing(path);
+    if (existing.open(QIODevice::ReadOnly)) {
+        QByteArray line = existing.readLine();
+        if (line.endsWith('\n') && QJsonDocument::fromJson(line).object() == header) {
+            validBytes = line.size();
+
+            while (!existing.atEnd()) {
+                line = existing.readLine();
+                if (!line.endsWith('\n')) {
+                    break;
+                }
+
+                QJsonParseError error;
+                QJsonObject object = QJsonDocument::fromJson(line, &error).object();
+                if (error.error != QJsonParseError::NoError) {
+                    break;
+                }
+
+                Segment segment;
+                segment.t0 = object.value("t0").toInteger();
+                segment.t1 = object.value("t1").toInteger();
+                segment.text = object.value("text").toString();
+                recovered.push_back(segment);
+                validBytes += line.size();
+            }
+        }
+        existing.close();
+    }
+
+    m_file.setFileName(path);
+
+    if (validBytes > 0) {
+        if (!m_file.open(QIODevice::ReadWrite) || !m_file.resize(validBytes) || !m_file.seek(validBytes)) {
+            m_lastError = m_file.errorString();
+            m_file.close();
+            recovered.clear();
+            unlock();
+            return false;
+        }
+    }
+    else {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_lastError = m_file.errorString();
+            unlock();
+            return false;
+        }
+        m_file.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+        m_pending = 1;
+        sync();
+    }
+
+    m_sinceSync.start();
+    return true;
+}
+
+void TranscriptionJournal::append(int64_t t0, int64_t t1, const QString& text)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QJsonObject object;
+    object["t0"] = static_cast<qint64>(t0);
+    object["t1"] = static_cast<qint64>(t1);
+    object["text"] = text;
+    m_file.write(QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n');
+
+    ++m_pending;
+    ++m_stats.segments;
+    m_stats.writeNs += timer.nsecsElapsed();
+
+    if (m_pending >= kSyncBatch || m_sinceSync.elapsed() >= kSyncIntervalMs) {
+        sync();
+    }
+}
+
+void TranscriptionJournal::sync()
+{
+    if (!m_file.isOpen() || m_pending == 0) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_file.flush();
+    if (!syncToDisk(m_file.handle())) {
+        m_lastError = "fsync failed";
+    }
+
+    m_stats.syncNs += timer.nsecsElapsed();
+    ++m_stats.syncs;
+    m_pending = 0;
+    m_sinceSync.restart();
+}
+
+void TranscriptionJournal::close()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    sync();
+    m_file.close();
+    unlock();
+}
+
+void TranscriptionJournal::discard()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    const QString path = m_file.fileName();
+    m_pending = 0;
+    m_file.close();
+
+    if (!path.isEmpty()) {
+        QFile::remove(path);
+    }
+    unlock();
+}
+
+void TranscriptionJournal::unlock()
+{
+    if (m_lock) {
+        m_lock->unlock();
+        m_lock.reset();
+    }
+}
@@ -0,0 +1,73 @@
+﻿#ifndef TRANSCRIPTIONJOURNAL_H
+#define TRANSCRIPTIONJOURNAL_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLockFile>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Append-only on-disk record of one transcription, so a crash or cancel
+// mid-file loses at most the last sync interval. One JSON object per line: a
+// header naming the input and settings, then one line per segment in source
+// centiseconds. Writes are flushed and fsynced in batches; a torn last line
+// is dropped on load. A lock file next to the journal keeps two runs on the
+// same input (GUI queue, CLI) from writing it at once; the second one gets
+// no journal.
+class TranscriptionJournal
+{
+public:
+    struct Segment {
+        int64_t t0;
+        int64_t t1;
+        QString text;
+    };
+
+    struct Stats {
+        int segments;
+        int syncs;
+        qint64 writeNs;
+        qint64 syncNs;
+
+        Stats()
+            : segments(0)
+            , syncs(0)
+            , writeNs(0)
+            , syncNs(0)
+        {
+        }
+    };
+
+    TranscriptionJournal();
+    ~TranscriptionJournal();
+
+    // Segments of an earlier run on the same, unchanged input with the same
+    // settings are returned in recovered and appended to; any other journal
+    // for the file is started over.
+    bool open(const QString& audioPath, const QString& settings, std::vector<Segment>& recovered);
+    void append(int64_t t0, int64_t t1, const QString& text);
+    void sync();
+    void close();
+    // The transcription finished; nothing is left to resume.
+    void discard();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    const Stats& stats() const { return m_stats; }
+    QString lastError() const { return m_lastError; }
+
+    static QString journalPath(const QString& audioPath);
+
+private:
+    QFile m_file;
+    std::unique_ptr<QLockFile> m_lock;
+    Stats m_stats;
+    int m_pending;
+    QElapsedTimer m_sinceSync;
+    QString m_lastError;
+
+    void unlock();
+};
+
+#endif // TRANSCRIPTIONJOURNAL_H
@@ -0,0 +1,207 @@
+﻿#include "voiceactivitydetector.h"
+#include "simd.h"
+#include <algorithm>
+
+VoiceActivityDetector::VoiceActivityDetector(const Params& params)
+    : m_params(params)
+{
+}
+
+void VoiceActivityDetector::analyzeFrame(const float* frame, int length, float& energy, float& zcr)
+{
+    int i = 0;
+    float sum = 0.0f;
+    int crossings = 0;
+
+#ifdef LANGLISTEN_SSE2
+    __m128 acc = _mm_setzero_ps();
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 < length; i += 4) {
+        __m128 current = _mm_loadu_ps(frame + i);
+        __m128 next = _mm_loadu_ps(frame + i + 1);
+        acc = _mm_add_ps(acc, _mm_mul_ps(current, current));
+
+        __m128 signChange = _mm_xor_ps(_mm_cmplt_ps(current, zero), _mm_cmplt_ps(next, zero));
+        int mask = _mm_movemask_ps(signChange);
+        crossings += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < length; ++i) {
+        sum += frame[i] * frame[i];
+        if (i + 1 < length && ((frame[i] < 0.0f) != (frame[i + 1] < 0.0f))) {
+            ++crossings;
+        }
+    }
+
+    energy = length > 0 ? sum / length : 0.0f;
+    zcr = length > 1 ? static_cast<float>(crossings) / (length - 1) : 0.0f;
+}
+
+std::vector<VoiceActivityDetector::Region> VoiceActivityDetector::detect(const float* samples, qint64 count) const
+{
+    std::vector<Region> regions;
+
+    const int frameLength = qMax(1, m_params.sampleRate * m_params.frameMs / 1000);
+    const qint64 frameCount = count / frameLength;
+    if (frameCount == 0) {
+        if (count > 0) {
+            regions.push_back({ 0, count });
+        }
+        return regions;
+    }
+
+    std::vector<float> energies(static_cast<size_t>(frameCount));
+    std::vector<float> zcrs(static_cast<size_t>(frameCount));
+    for (qint64 f = 0; f < frameCount; ++f) {
+        analyzeFrame(samples + f * frameLength, frameLength, energies[f], zcrs[f]);
+    }
+
+    // The 10th percentile of frame energy approximates the noise floor of
+    // this recording, which keeps the detector usable across gain levels.
+    std::vector<float> sorted(energies);
+    size_t floorIndex = sorted.size() / 10;
+    std::nth_element(sorted.begin(), sorted.begin() + floorIndex, sorted.end());
+    const float noiseFloor = sorted[floorIndex];
+    const float threshold = qMax(m_params.minEnergy, noiseFloor * m_params.energyRatio);
+
+    std::vector<bool> speech(static_cast<size_t>(frameCount));
+    for (qint64 f = 0; f < frameCount; ++f) {
+        // Unvoiced consonants are quiet but noisy; accept them at half the
+        // energy threshold when the zero-crossing rate is high.
+        speech[f] = energies[f] > threshold ||
+            (energies[f] > threshold * 0.5f && zcrs[f] > m_params.zcrThreshold);
+    }
+
+    const qint64 minSpeechFrames = qMax<qint64>(1, m_params.minSpeechMs / m_params.frameMs);
+    const qint64 minSilenceFrames = qMax<qint64>(1, m_params.minSilenceMs / m_params.frameMs);
+    const qint64 padding = static_cast<qint64>(m_params.paddingMs) * m_params.sampleRate / 1000;
+
+    qint64 f = 0;
+    while (f < frameCount) {
+        if (!speech[f]) {
+            ++f;
+            continue;
+        }
+
+        qint64 start = f;
+        qint64 end = f + 1;
+        qint64 silence = 0;
+        for (qint64 g = f + 1; g < frameCount && silence < minSilenceFrames; ++g) {
+            if (speech[g]) {
+                end = g + 1;
+                silence = 0;
+            }
+            else {
+                ++silence;
+            }
+        }
+        f = end + silence;
+
+        if (end - start < minSpeechFrames) {
+            continue;
+        }
+
+        Region region;
+        region.start = qMax<qint64>(0, start * frameLength - padding);
+        region.end = qMin(count, end * frameLength + padding);
+        if (end == frameCount) {
+            region.end = count;
+        }
+
+        if (!regions.empty() && region.start <= regions.back().end) {
+            regions.back().end = qMax(regions.back().end, region.end);
+        }
+        else {
+            regions.push_back(region);
+        }
+    }
+
+    return regions;
+}
+
+qint64 VoiceActivityDetector::totalLength(const std::vector<Region>& regions)
+{
+    qint64 total = 0;
+    for (const Region& region : regions) {
+        total += region.end - region.start;
+    }
+    return total;
+}
+
+std::vector<float> VoiceActivityDetector::compact(const float* samples, const std::vector<Region>& regions,
+    qint64 gapSamples, std::vector<Span>& spans)
+{
+    std::vector<float> result;
+    result.reserve(static_cast<size_t>(totalLength(regions) + gapSamples * static_cast<qint64>(regions.size())));
+    spans.clear();
+
+    for (size_t i = 0; i < regions.size(); ++i) {
+        if (i > 0) {
+            result.insert(result.end(), static_cast<size_t>(gapSamples), 0.0f);
+        }
+
+        Span span;
+        span.compactStart = static_cast<qint64>(result.size());
+        span.sourceStart = regions[i].start;
+        span.length = regions[i].end - regions[i].start;
+        spans.push_back(span);
+
+        result.insert(result.end(), samples + regions[i].start, samples + regions[i].end);
+    }
+
+    return result;
+}
+
+qint64 VoiceActivityDetector::mapToSource(const std::vector<Span>& spans, qint64 compactSample, bool preferNext)
+{
+    if (spans.empty()) {
+        return compactSample;
+    }
+
+    auto it = std::upper_bound(spans.begin(), spans.end(), compactSample,
+        [](qint64 value, const Span& span) { return value < span.compactStart; });
+    if (it == spans.begin()) {
+        return spans.front().sourceStart;
+    }
+
+    const Span& span = *(it - 1);
+    qint64 offset = compactSample - span.compactStart;
+    if (offset <= span.length) {
+        return span.sourceStart + offset;
+    }
+
+    if (preferNext && it != spans.end()) {
+        return it->sourceStart;
+    }
+    return span.sourceStart + span.length;
+}
+
+qint64 VoiceActivityDetector::mapFromSource(const std::vector<Span>& spans, qint64 sourceSample)
+{
+    if (spans.empty()) {
+        return sourceSample;
+    }
+
+    auto it = std::upper_bound(spans.begin(), spans.end(), sourceSample,
+        [](qint64 value, const Span& span) { return value < span.sourceStart; });
+    if (it == spans.begin()) {
+        return spans.front().compactStart;
+    }
+
+    const Span& span = *(it - 1);
+    qint64 offset = sourceSample - span.sourceStart;
+    if (offset < span.length) {
+        return span.compactStart + offset;
+    }
+
+    if (it != spans.end()) {
+        return it->compactStart;
+    }
+    return span.compactStart + span.length;
+}
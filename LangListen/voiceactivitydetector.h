@@ -0,0 +1,72 @@
+﻿#ifndef VOICEACTIVITYDETECTOR_H
+#define VOICEACTIVITYDETECTOR_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Frame-based energy / zero-crossing speech detector for mono float PCM.
+// Thresholds adapt to the recording's own noise floor.
+class VoiceActivityDetector
+{
+public:
+    struct Params {
+        int sampleRate;
+        int frameMs;
+        float energyRatio;
+        float minEnergy;
+        float zcrThreshold;
+        int minSpeechMs;
+        int minSilenceMs;
+        int paddingMs;
+
+        Params()
+            : sampleRate(16000)
+            , frameMs(20)
+            , energyRatio(4.0f)
+            , minEnergy(1e-6f)
+            , zcrThreshold(0.25f)
+            , minSpeechMs(250)
+            , minSilenceMs(600)
+            , paddingMs(200)
+        {
+        }
+    };
+
+    // Sample ranges [start, end).
+    struct Region {
+        qint64 start;
+        qint64 end;
+    };
+
+    // Maps a range of the compacted buffer back to the source timeline.
+    struct Span {
+        qint64 compactStart;
+        qint64 sourceStart;
+        qint64 length;
+    };
+
+    explicit VoiceActivityDetector(const Params& params = Params());
+
+    std::vector<Region> detect(const float* samples, qint64 count) const;
+
+    static qint64 totalLength(const std::vector<Region>& regions);
+
+    // Concatenates the regions with gapSamples of silence between them.
+    static std::vector<float> compact(const float* samples, const std::vector<Region>& regions,
+        qint64 gapSamples, std::vector<Span>& spans);
+
+    // Positions inside an inserted gap resolve to the end of the preceding
+    // span, or to the start of the next one when preferNext is set.
+    static qint64 mapToSource(const std::vector<Span>& spans, qint64 compactSample, bool preferNext);
+
+    // Inverse of mapToSource: the first compacted sample at or after the
+    // source position. Positions in dropped silence resolve to the next span.
+    static qint64 mapFromSource(const std::vector<Span>& spans, qint64 sourceSample);
+
+private:
+    static void analyzeFrame(const float* frame, int length, float& energy, float& zcr);
+
+    Params m_params;
+};
+
+#endif
@@ -1,22 +1,48 @@
 ﻿#include "waveformgenerator.h"
+#include "waveformpeakcache.h"
+#include "simd.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QtConcurrent>
 #include <QtMath>
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <limits>
 #include <QThreadPool>
-#include <QRunnable>
 #include <QMutex>
-#include <QWaitCondition>
+#include <QStringList>
+#include <cstring>
+
+namespace {
+
+// Minimum amount of new audio before another preview block is built. Most
+// preview levels do not divide it, so each level only emits the pixels that
+// are complete and the next block starts again at its first missing pixel.
+const qint64 kPreviewBlockSamples = 65536;
+
+const int kPreviewBaseSpp = 64;
+const int kPreviewMinSpp = 256;
+
+const QVector<int>& previewSamplesPerPixel();
+QVector<WaveformLevel> buildPreviewBlock(const float* samples, qint64 firstSample, qint64 count, int sampleRate,
+    QVector<qint64>& pixels, bool final);
+
+}
 
 WaveformWorker::WaveformWorker(QObject* parent)
     : QObject(parent)
     , m_audioConverter(nullptr)
+    , m_decodeService(nullptr)
     , m_cancelled(false)
+    , m_memoryBudget(256LL * 1024 * 1024)
+    , m_peakCache(new WaveformPeakCache())
 {
 }
 
 WaveformWorker::~WaveformWorker()
 {
+    delete m_peakCache;
 }
 
 void WaveformWorker::cancel()
@@ -24,6 +50,77 @@ void WaveformWorker::cancel()
     m_cancelled = true;
 }
 
+void WaveformWorker::setPeakCacheLimit(qint64 bytes)
+{
+    m_peakCache->setMaxBytes(bytes);
+}
+
+void WaveformWorker::clearPeakCache()
+{
+    m_peakCache->clear();
+    emit logMessage("Peak cache cleared: " + m_peakCache->directory());
+}
+
+bool WaveformWorker::loadSharedAudio(const QString& filePath, std::shared_ptr<DecodedAudio>& decoded)
+{
+    decoded = m_decodeService->acquire(filePath);
+
+    QVector<qint64> pixels(previewSamplesPerPixel().size(), 0);
+    qint64 delivered = 0;
+    while (!decoded->waitForFinished(200)) {
+        if (m_cancelled) {
+            return false;
+        }
+        emit progressUpdated(decoded->progress() / 10);
+        deliverPreview(*decoded, pixels, delivered, false);
+    }
+
+    if (!decoded->isValid()) {
+        emit generationFailed("Failed to load audio: " + decoded->errorString());
+        return false;
+    }
+
+    if (delivered > 0) {
+        deliverPreview(*decoded, pixels, delivered, true);
+    }
+
+    return true;
+}
+
+// `pixels` holds the number of complete pixels already delivered per preview
+// level; samples of a level's unfinished pixel are read again with the next
+// block. `final` also flushes the last partial pixel of every level.
+void WaveformWorker::deliverPreview(const DecodedAudio& decoded, QVector<qint64>& pixels, qint64& delivered, bool final)
+{
+    const int sampleRate = decoded.sampleRate();
+    if (sampleRate <= 0) {
+        return;
+    }
+
+    const qint64 end = decoded.sampleCount();
+    if (end <= delivered || (!final && end - delivered < kPreviewBlockSamples)) {
+        return;
+    }
+
+    const QVector<int>& spps = previewSamplesPerPixel();
+    qint64 first = end;
+    for (int i = 0; i < spps.size(); ++i) {
+        first = qMin(first, pixels[i] * spps[i]);
+    }
+
+    std::vector<float> samples(static_cast<size_t>(end - first));
+    const qint64 count = decoded.read(first, samples.data(), end - first);
+    if (count != end - first) {
+        return;
+    }
+
+    emit previewBlockReady(buildPreviewBlock(samples.data(), first, count, sampleRate, pixels, final),
+        first * 1000 / sampleRate,
+        end * 1000 / sampleRate,
+        decoded.expectedDurationMs());
+    delivered = end;
+}
+
 void WaveformWorker::processAudio(const QString& filePath)
 {
     m_cancelled = false;
@@ -31,16 +128,50 @@ void WaveformWorker::processAudio(const QString& filePath)
     emit logMessage("Loading audio: " + filePath);
     emit progressUpdated(0);
 
-    std::vector<float> audioData;
-    AudioConverter::ConversionParams params;
-    params.targetSampleRate = 44100;
-    params.targetChannels = 1;
-    params.targetFormat = AV_SAMPLE_FMT_S16;
-
-    if (!m_audioConverter->convertToMemory(filePath, audioData, params)) {
-        emit generationFailed("Failed to load audio: " + m_audioConverter->getLastError());
+    QVector<WaveformLevel> cachedLevels;
+    qint64 cachedDuration = 0;
+    if (m_peakCache->load(filePath, m_memoryBudget, cachedLevels, cachedDuration)) {
+        emit logMessage(QString("Loaded %1 LOD levels from peak file in %2 ms")
+            .arg(cachedLevels.size())
+            .arg(m_peakCache->stats().lastLoadMs));
+        emit progressUpdated(100);
+        emit waveformGenerated(cachedLevels, cachedDuration);
         return;
     }
+    if (!m_peakCache->lastError().isEmpty()) {
+        emit logMessage(m_peakCache->lastError());
+    }
+
+    std::shared_ptr<DecodedAudio> decoded;
+    std::vector<float> convertedData;
+    const std::vector<float>* audioSamples = nullptr;
+    int sampleRate = 0;
+
+    if (m_decodeService) {
+        if (!loadSharedAudio(filePath, decoded)) {
+            if (m_cancelled) {
+                emit logMessage("Cancelled");
+            }
+            return;
+        }
+        audioSamples = &decoded->samples();
+        sampleRate = decoded->sampleRate();
+    }
+    else {
+        AudioConverter::ConversionParams params;
+        params.targetSampleRate = 44100;
+        params.targetChannels = 1;
+        params.targetFormat = AV_SAMPLE_FMT_S16;
+
+        if (!m_audioConverter->convertToMemory(filePath, convertedData, params)) {
+            emit generationFailed("Failed to load audio: " + m_audioConverter->getLastError());
+            return;
+        }
+        audioSamples = &convertedData;
+        sampleRate = params.targetSampleRate;
+    }
+
+    const std::vector<float>& audioData = *audioSamples;
 
     if (m_cancelled) {
         emit logMessage("Cancelled");
@@ -53,13 +184,13 @@ void WaveformWorker::processAudio(const QString& filePath)
     }
 
     emit progressUpdated(10);
-    emit logMessage(QString("Loaded %1 samples at %2Hz").arg(audioData.size()).arg(params.targetSampleRate));
+    emit logMessage(QString("Loaded %1 samples at %2Hz").arg(audioData.size()).arg(sampleRate));
 
     QVector<WaveformLevel> levels;
     qint64 duration;
 
     try {
-        generateMultiLevelWaveform(audioData, params.targetSampleRate, levels, duration);
+        generateMultiLevelWaveform(audioData, sampleRate, levels, duration);
     }
     catch (const std::exception& e) {
         emit generationFailed(QString("Generation error: %1").arg(e.what()));
@@ -74,187 +205,585 @@ void WaveformWorker::processAudio(const QString& filePath)
     emit progressUpdated(100);
     emit logMessage(QString("Generated %1 LOD levels").arg(levels.size()));
 
+    // Hand the levels over first; the peak file can take a while to write.
+    // The levels share their data with the emitted copy.
     emit waveformGenerated(levels, duration);
+
+    if (m_peakCache->store(filePath, m_memoryBudget, levels, duration)) {
+        emit logMessage("Saved peak file to " + m_peakCache->directory());
+    }
+    else if (!m_peakCache->lastError().isEmpty()) {
+        emit logMessage("WARNING: " + m_peakCache->lastError());
+    }
+}
+
+namespace {
+
+const QVector<int>& lodSamplesPerPixel()
+{
+    static const QVector<int> levels = {
+        1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32,
+        40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+        320, 384, 448, 512, 640, 768, 896, 1024,
+        1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+        5120, 6144, 7168, 8192, 10240, 12288, 14336, 16384,
+        20480, 24576, 28672, 32768, 40960, 49152, 57344, 65536
+    };
+    return levels;
 }
 
-class LevelGeneratorTask : public QRunnable
+// Min/max of each group of `factor` raw samples; the last group may be short.
+void reduceSamples(const float* src, qint64 count, int factor, MinMaxPair* dst, qint64 firstOut, qint64 outCount)
 {
-public:
-    LevelGeneratorTask(const std::vector<float>* audioData,
-        int sampleRate,
-        WaveformLevel* level,
-        std::atomic<bool>* cancelled,
-        QMutex* mutex,
-        int* completed,
-        QWaitCondition* condition)
-        : m_audioData(audioData)
-        , m_sampleRate(sampleRate)
-        , m_level(level)
-        , m_cancelled(cancelled)
-        , m_mutex(mutex)
-        , m_completed(completed)
-        , m_condition(condition)
-    {
-        setAutoDelete(true);
+    qint64 o = firstOut;
+    const qint64 lastOut = firstOut + outCount;
+
+#ifdef LANGLISTEN_SSE2
+    if (factor == 2) {
+        // Four groups per step: split even/odd samples and compare lane-wise.
+        float* out = reinterpret_cast<float*>(dst);
+        for (; o + 4 <= lastOut && (o + 4) * 2 <= count; o += 4) {
+            const __m128 a = _mm_loadu_ps(src + o * 2);
+            const __m128 b = _mm_loadu_ps(src + o * 2 + 4);
+            const __m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m128 mn = _mm_min_ps(even, odd);
+            const __m128 mx = _mm_max_ps(even, odd);
+            _mm_storeu_ps(out + o * 2, _mm_unpacklo_ps(mn, mx));
+            _mm_storeu_ps(out + o * 2 + 4, _mm_unpackhi_ps(mn, mx));
+        }
     }
+#endif
+
+    for (; o < lastOut; ++o) {
+        const qint64 begin = o * factor;
+        const qint64 end = qMin(begin + factor, count);
+        qint64 i = begin;
+        float mn = src[i];
+        float mx = src[i];
+
+#ifdef LANGLISTEN_SSE2
+        if (end - begin >= 8) {
+            __m128 vmin = _mm_loadu_ps(src + i);
+            __m128 vmax = vmin;
+            for (i += 4; i + 4 <= end; i += 4) {
+                const __m128 v = _mm_loadu_ps(src + i);
+                vmin = _mm_min_ps(vmin, v);
+                vmax = _mm_max_ps(vmax, v);
+            }
+            float lanesMin[4];
+            float lanesMax[4];
+            _mm_storeu_ps(lanesMin, vmin);
+            _mm_storeu_ps(lanesMax, vmax);
+            mn = qMin(qMin(lanesMin[0], lanesMin[1]), qMin(lanesMin[2], lanesMin[3]));
+            mx = qMax(qMax(lanesMax[0], lanesMax[1]), qMax(lanesMax[2], lanesMax[3]));
+        }
+#endif
 
-    void run() override
-    {
-        if (m_cancelled->load()) return;
+        for (; i < end; ++i) {
+            mn = qMin(mn, src[i]);
+            mx = qMax(mx, src[i]);
+        }
+        dst[o] = MinMaxPair(mn, mx);
+    }
+}
 
-        int samplesPerPixel = m_level->samplesPerPixel;
-        if (samplesPerPixel < 1) samplesPerPixel = 1;
+// Coarser level from a finer one: combine `factor` parent entries per output.
+void reducePairs(const MinMaxPair* src, qint64 count, int factor, MinMaxPair* dst, qint64 firstOut, qint64 outCount)
+{
+    for (qint64 o = firstOut; o < firstOut + outCount; ++o) {
+        const qint64 begin = o * factor;
+        const qint64 end = qMin(begin + factor, count);
+        qint64 i = begin;
+        float mn = src[i].min;
+        float mx = src[i].max;
+
+#ifdef LANGLISTEN_SSE2
+        if (end - begin >= 4) {
+            // Two interleaved (min, max) entries per register: even lanes
+            // track minima, odd lanes maxima.
+            const float* p = reinterpret_cast<const float*>(src);
+            __m128 vmin = _mm_loadu_ps(p + i * 2);
+            __m128 vmax = vmin;
+            for (i += 2; i + 2 <= end; i += 2) {
+                const __m128 v = _mm_loadu_ps(p + i * 2);
+                vmin = _mm_min_ps(vmin, v);
+                vmax = _mm_max_ps(vmax, v);
+            }
+            float lanesMin[4];
+            float lanesMax[4];
+            _mm_storeu_ps(lanesMin, vmin);
+            _mm_storeu_ps(lanesMax, vmax);
+            mn = qMin(lanesMin[0], lanesMin[2]);
+            mx = qMax(lanesMax[1], lanesMax[3]);
+        }
+#endif
 
-        int totalSamples = m_audioData->size();
-        int numPixels = (totalSamples + samplesPerPixel - 1) / samplesPerPixel;
+        for (; i < end; ++i) {
+            mn = qMin(mn, src[i].min);
+            mx = qMax(mx, src[i].max);
+        }
+        dst[o] = MinMaxPair(mn, mx);
+    }
+}
 
-        m_level->data.clear();
-        m_level->data.reserve(numPixels);
+// Runs fn(first, count) over [0, total) in chunks on the global pool.
+template <typename Fn>
+void parallelChunks(qint64 total, Fn fn)
+{
+    const int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    const qint64 chunk = qMax<qint64>(16384, (total + threads * 4 - 1) / (threads * 4));
 
-        for (int pixel = 0; pixel < numPixels; ++pixel) {
-            if (m_cancelled->load()) return;
+    if (total <= chunk) {
+        fn(0, total);
+        return;
+    }
 
-            int startIdx = pixel * samplesPerPixel;
-            int endIdx = qMin(startIdx + samplesPerPixel, totalSamples);
+    QVector<qint64> starts;
+    for (qint64 first = 0; first < total; first += chunk) {
+        starts.append(first);
+    }
 
-            float minVal = 0.0f;
-            float maxVal = 0.0f;
+    QtConcurrent::blockingMap(starts, [&](qint64 first) {
+        fn(first, qMin(chunk, total - first));
+        });
+}
 
-            if (startIdx < totalSamples) {
-                minVal = (*m_audioData)[startIdx];
-                maxVal = (*m_audioData)[startIdx];
+qint64 levelBytes(qint64 entries, bool singleValue, WaveformFormat format)
+{
+    return entries * (singleValue ? 1 : 2) * WaveformLevel::bytesPerValue(format);
+}
 
-                for (int i = startIdx + 1; i < endIdx; ++i) {
-                    float sample = (*m_audioData)[i];
-                    if (sample < minVal) minVal = sample;
-                    if (sample > maxVal) maxVal = sample;
-                }
-            }
+// Chooses a format per level so the set fits `budgetBytes` (0 = unlimited):
+// the finest levels, which dominate the footprint, are narrowed to int16 and
+// then int8 first; if that is still too much they are left out entirely.
+QVector<bool> planFormats(const QVector<int>& lods, const QVector<qint64>& entries,
+    qint64 budgetBytes, QVector<WaveformFormat>& formats)
+{
+    const int n = lods.size();
+    formats.fill(WaveformFormat::Float32, n);
+    QVector<bool> kept(n, true);
+
+    auto bytes = [&](int li, WaveformFormat format) {
+        return levelBytes(entries[li], lods[li] == 1, format);
+    };
+
+    qint64 total = 0;
+    for (int li = 0; li < n; ++li) {
+        total += bytes(li, formats[li]);
+    }
+
+    if (budgetBytes <= 0) {
+        return kept;
+    }
 
-            m_level->data.append(MinMaxPair(minVal, maxVal));
+    for (WaveformFormat narrower : { WaveformFormat::Int16, WaveformFormat::Int8 }) {
+        for (int li = 0; li < n && total > budgetBytes; ++li) {
+            total -= bytes(li, formats[li]) - bytes(li, narrower);
+            formats[li] = narrower;
         }
+    }
 
-        QMutexLocker locker(m_mutex);
-        (*m_completed)++;
-        m_condition->wakeAll();
+    for (int li = 0; li < n - 1 && total > budgetBytes; ++li) {
+        total -= bytes(li, formats[li]);
+        kept[li] = false;
     }
 
-private:
-    const std::vector<float>* m_audioData;
-    int m_sampleRate;
-    WaveformLevel* m_level;
-    std::atomic<bool>* m_cancelled;
-    QMutex* m_mutex;
-    int* m_completed;
-    QWaitCondition* m_condition;
-};
+    return kept;
+}
 
-void WaveformWorker::generateMultiLevelWaveform(
-    const std::vector<float>& audioData,
-    int sampleRate,
-    QVector<WaveformLevel>& levels,
-    qint64& duration)
+float peakMagnitude(const float* samples, qint64 count)
 {
-    int totalSamples = audioData.size();
-    duration = static_cast<qint64>((totalSamples * 1000.0) / sampleRate);
+    QMutex mutex;
+    float peak = 0.0f;
 
-    QVector<int> lodLevels = {
-        1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32,
-        40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256,
-        320, 384, 448, 512, 640, 768, 896, 1024,
-        1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
-        5120, 6144, 7168, 8192, 10240, 12288, 14336, 16384,
-        20480, 24576, 28672, 32768, 40960, 49152, 57344, 65536
-    };
+    parallelChunks(count, [&](qint64 first, qint64 n) {
+        float local = 0.0f;
+        for (qint64 i = first; i < first + n; ++i) {
+            local = qMax(local, std::abs(samples[i]));
+        }
+        QMutexLocker locker(&mutex);
+        peak = qMax(peak, local);
+        });
 
-    levels.clear();
-    levels.reserve(lodLevels.size());
+    return peak;
+}
 
-    for (int i = 0; i < lodLevels.size(); ++i) {
-        if (m_cancelled) return;
+inline int floorToInt(float v)
+{
+    const int i = static_cast<int>(v);
+    return i - (static_cast<float>(i) > v ? 1 : 0);
+}
 
-        int samplesPerPixel = lodLevels[i];
-        double pixelsPerSecond = static_cast<double>(sampleRate) / samplesPerPixel;
+inline int ceilToInt(float v)
+{
+    const int i = static_cast<int>(v);
+    return i + (static_cast<float>(i) < v ? 1 : 0);
+}
 
-        WaveformLevel level;
-        level.samplesPerPixel = samplesPerPixel;
-        level.pixelsPerSecond = pixelsPerSecond;
+template <typename T>
+void quantizeSamples(const float* src, qint64 count, float inverseScale, int limit, T* dst)
+{
+    for (qint64 i = 0; i < count; ++i) {
+        dst[i] = static_cast<T>(qBound(-limit, qRound(src[i] * inverseScale), limit));
+    }
+}
 
-        levels.append(level);
+// Minima round down and maxima up, so a quantized envelope always covers
+// the original one.
+template <typename T>
+void quantizePairs(const MinMaxPair* src, qint64 count, float inverseScale, int limit, T* dst)
+{
+    for (qint64 i = 0; i < count; ++i) {
+        dst[2 * i] = static_cast<T>(qBound(-limit, floorToInt(src[i].min * inverseScale), limit));
+        dst[2 * i + 1] = static_cast<T>(qBound(-limit, ceilToInt(src[i].max * inverseScale), limit));
+    }
+}
 
-        emit logMessage(QString("LOD %1: %2 samples/px, %3 px/s")
-            .arg(i)
-            .arg(samplesPerPixel)
-            .arg(pixelsPerSecond, 0, 'f', 2));
+const char* formatName(WaveformFormat format)
+{
+    switch (format) {
+    case WaveformFormat::Int16: return "int16";
+    case WaveformFormat::Int8: return "int8";
+    default: return "float32";
     }
+}
 
-    QMutex mutex;
-    QWaitCondition condition;
-    int completed = 0;
+int quantizeLimit(WaveformFormat format)
+{
+    return format == WaveformFormat::Int16 ? 32767 : 127;
+}
+
+// Packs raw samples into a single-value level in the level's format.
+void storeSamples(const float* samples, qint64 count, float peak, WaveformLevel& level)
+{
+    level.count = static_cast<int>(count);
+    level.data.resize(levelBytes(count, true, level.format));
+    char* out = level.data.data();
+
+    if (level.format == WaveformFormat::Float32) {
+        level.scale = 1.0f;
+        memcpy(out, samples, count * sizeof(float));
+        return;
+    }
+
+    const int limit = quantizeLimit(level.format);
+    level.scale = peak > 0.0f ? peak / limit : 1.0f;
+    const float inverse = 1.0f / level.scale;
 
-    QThreadPool* pool = QThreadPool::globalInstance();
-    int maxThreads = pool->maxThreadCount();
+    parallelChunks(count, [&](qint64 first, qint64 n) {
+        if (level.format == WaveformFormat::Int16) {
+            quantizeSamples(samples + first, n, inverse, limit, reinterpret_cast<qint16*>(out) + first);
+        }
+        else {
+            quantizeSamples(samples + first, n, inverse, limit, reinterpret_cast<qint8*>(out) + first);
+        }
+        });
+}
 
-    for (int i = 0; i < levels.size(); ++i) {
-        if (m_cancelled) return;
+void storePairs(const QVector<MinMaxPair>& pairs, float peak, WaveformLevel& level)
+{
+    const qint64 count = pairs.size();
+    level.count = pairs.size();
+    level.data.resize(levelBytes(count, false, level.format));
+    char* out = level.data.data();
+
+    if (level.format == WaveformFormat::Float32) {
+        level.scale = 1.0f;
+        memcpy(out, pairs.constData(), count * sizeof(MinMaxPair));
+        return;
+    }
 
-        LevelGeneratorTask* task = new LevelGeneratorTask(
-            &audioData,
-            sampleRate,
-            &levels[i],
-            &m_cancelled,
-            &mutex,
-            &completed,
-            &condition
-        );
-        pool->start(task);
+    const int limit = quantizeLimit(level.format);
+    level.scale = peak > 0.0f ? peak / limit : 1.0f;
+    const float inverse = 1.0f / level.scale;
+    const MinMaxPair* src = pairs.constData();
+
+    parallelChunks(count, [&](qint64 first, qint64 n) {
+        if (level.format == WaveformFormat::Int16) {
+            quantizePairs(src + first, n, inverse, limit, reinterpret_cast<qint16*>(out) + first * 2);
+        }
+        else {
+            quantizePairs(src + first, n, inverse, limit, reinterpret_cast<qint8*>(out) + first * 2);
+        }
+        });
+}
+
+const QVector<int>& previewSamplesPerPixel()
+{
+    static const QVector<int> levels = [] {
+        QVector<int> result;
+        for (int spp : lodSamplesPerPixel()) {
+            if (spp >= kPreviewMinSpp) {
+                result.append(spp);
+            }
+        }
+        return result;
+    }();
+    return levels;
+}
+
+// Coarse levels (256 samples per pixel and up) for the samples starting at
+// `firstSample`. All of them are multiples of 64, so they are reduced from a
+// 64-sample base level; `firstSample` is the start of the earliest pixel still
+// missing, which makes it a multiple of 64 as well. Each level gets the pixels
+// from pixels[i] up to the last complete one (or the partial tail if `final`).
+QVector<WaveformLevel> buildPreviewBlock(const float* samples, qint64 firstSample, qint64 count, int sampleRate,
+    QVector<qint64>& pixels, bool final)
+{
+    const qint64 end = firstSample + count;
+
+    QVector<MinMaxPair> base(static_cast<int>((count + kPreviewBaseSpp - 1) / kPreviewBaseSpp));
+    reduceSamples(samples, count, kPreviewBaseSpp, base.data(), 0, base.size());
+
+    const QVector<int>& spps = previewSamplesPerPixel();
+    QVector<WaveformLevel> block;
+    for (int i = 0; i < spps.size(); ++i) {
+        const int spp = spps[i];
+        const qint64 lastPixel = final ? (end + spp - 1) / spp : end / spp;
+        const qint64 newPixels = qMax<qint64>(0, lastPixel - pixels[i]);
+
+        QVector<MinMaxPair> pairs(static_cast<int>(newPixels));
+        if (newPixels > 0) {
+            const qint64 offset = (pixels[i] * spp - firstSample) / kPreviewBaseSpp;
+            reducePairs(base.constData() + offset, base.size() - offset, spp / kPreviewBaseSpp, pairs.data(), 0, pairs.size());
+            pixels[i] = lastPixel;
+        }
+
+        WaveformLevel level;
+        level.samplesPerPixel = spp;
+        level.pixelsPerSecond = static_cast<double>(sampleRate) / spp;
+        storePairs(pairs, 0.0f, level);
+        block.append(level);
+    }
+
+    return block;
+}
+
+// Builds every LOD in one pass over the samples: level 1 and the levels with
+// no smaller divisor in the table (2, 3, 5, 7) come from the raw samples,
+// every other level from the largest level that divides it, which is at most
+// a few times larger than the result. Float min/max pairs only live until
+// their last child is built; each level is then packed into the format
+// planFormats() picked for `budgetBytes`.
+bool buildPyramid(const float* samples, qint64 count, int sampleRate, qint64 budgetBytes,
+    QVector<WaveformLevel>& levels, const std::atomic<bool>* cancelled,
+    const std::function<void(int done, int total)>& progress)
+{
+    const QVector<int>& lods = lodSamplesPerPixel();
+    const int n = lods.size();
+
+    QVector<int> parents(n, -1);
+    QVector<int> lastUse(n, -1);
+    QVector<qint64> entries(n);
+    for (int li = 0; li < n; ++li) {
+        entries[li] = (count + lods[li] - 1) / lods[li];
+        for (int pi = li - 1; pi > 0; --pi) {
+            if (lods[li] % lods[pi] == 0) {
+                parents[li] = pi;
+                lastUse[pi] = li;
+                break;
+            }
+        }
     }
 
-    while (completed < levels.size()) {
-        {
-            QMutexLocker locker(&mutex);
-            condition.wait(&mutex, 100);
+    QVector<WaveformFormat> formats;
+    const QVector<bool> kept = planFormats(lods, entries, budgetBytes, formats);
+    const float peak = peakMagnitude(samples, count);
+
+    QVector<WaveformLevel> built(n);
+    QVector<QVector<MinMaxPair>> pairs(n);
+
+    auto finish = [&](int li) {
+        if (kept[li]) {
+            storePairs(pairs[li], peak, built[li]);
+        }
+        pairs[li] = QVector<MinMaxPair>();
+    };
+
+    levels.clear();
+
+    for (int li = 0; li < n; ++li) {
+        if (cancelled && cancelled->load()) {
+            return false;
         }
 
-        if (m_cancelled) return;
+        const int spp = lods[li];
+        WaveformLevel& level = built[li];
+        level.samplesPerPixel = spp;
+        level.pixelsPerSecond = static_cast<double>(sampleRate) / spp;
+        level.format = formats[li];
+        level.singleValue = spp == 1;
+
+        if (spp == 1) {
+            if (kept[li]) {
+                storeSamples(samples, count, peak, level);
+            }
+        }
+        else {
+            const qint64 outCount = entries[li];
+            pairs[li].resize(static_cast<int>(outCount));
+            MinMaxPair* dst = pairs[li].data();
+            const int parent = parents[li];
+
+            if (parent < 0) {
+                parallelChunks(outCount, [&](qint64 first, qint64 chunk) {
+                    reduceSamples(samples, count, spp, dst, first, chunk);
+                    });
+            }
+            else {
+                const int factor = spp / lods[parent];
+                const MinMaxPair* src = pairs[parent].constData();
+                const qint64 srcCount = pairs[parent].size();
+                parallelChunks(outCount, [&](qint64 first, qint64 chunk) {
+                    reducePairs(src, srcCount, factor, dst, first, chunk);
+                    });
+            }
 
-        int progress = 10 + (completed * 90) / levels.size();
-        emit progressUpdated(progress);
+            if (lastUse[li] < 0) {
+                finish(li);
+            }
+            if (parent >= 0 && lastUse[parent] == li) {
+                finish(parent);
+            }
+        }
+
+        if (progress) {
+            progress(li + 1, n);
+        }
+    }
+
+    for (int li = 0; li < n; ++li) {
+        if (kept[li]) {
+            levels.append(std::move(built[li]));
+        }
     }
 
-    pool->waitForDone();
+    return true;
 }
 
-void WaveformWorker::generateLevel(const std::vector<float>& audioData,
-    int sampleRate,
-    int samplesPerPixel,
-    QVector<MinMaxPair>& output)
+// The previous scheme: every level rescans all samples, one task per level.
+void buildLevelsPerTask(const float* samples, qint64 count, QVector<QVector<MinMaxPair>>& levels)
 {
-    if (samplesPerPixel < 1) samplesPerPixel = 1;
+    const QVector<int>& lods = lodSamplesPerPixel();
 
-    int totalSamples = audioData.size();
-    int numPixels = (totalSamples + samplesPerPixel - 1) / samplesPerPixel;
+    levels.clear();
+    levels.resize(lods.size());
 
-    output.clear();
-    output.reserve(numPixels);
+    QVector<int> indices;
+    for (int li = 0; li < lods.size(); ++li) {
+        indices.append(li);
+    }
 
-    for (int pixel = 0; pixel < numPixels; ++pixel) {
-        if (m_cancelled) return;
+    QtConcurrent::blockingMap(indices, [&](int li) {
+        QVector<MinMaxPair>& level = levels[li];
+        const int spp = lods[li];
+        const qint64 numPixels = (count + spp - 1) / spp;
+        level.reserve(static_cast<int>(numPixels));
+
+        for (qint64 pixel = 0; pixel < numPixels; ++pixel) {
+            const qint64 startIdx = pixel * spp;
+            const qint64 endIdx = qMin(startIdx + spp, count);
+            float minVal = samples[startIdx];
+            float maxVal = samples[startIdx];
+            for (qint64 i = startIdx + 1; i < endIdx; ++i) {
+                if (samples[i] < minVal) minVal = samples[i];
+                if (samples[i] > maxVal) maxVal = samples[i];
+            }
+            level.append(MinMaxPair(minVal, maxVal));
+        }
+        });
+}
 
-        int startIdx = pixel * samplesPerPixel;
-        int endIdx = qMin(startIdx + samplesPerPixel, totalSamples);
+}
 
-        float minVal = audioData[startIdx];
-        float maxVal = audioData[startIdx];
+void WaveformWorker::generateMultiLevelWaveform(
+    const std::vector<float>& audioData,
+    int sampleRate,
+    QVector<WaveformLevel>& levels,
+    qint64& duration)
+{
+    qint64 totalSamples = static_cast<qint64>(audioData.size());
+    duration = static_cast<qint64>((totalSamples * 1000.0) / sampleRate);
 
-        for (int i = startIdx + 1; i < endIdx; ++i) {
-            float sample = audioData[i];
-            if (sample < minVal) minVal = sample;
-            if (sample > maxVal) maxVal = sample;
+    QElapsedTimer timer;
+    timer.start();
+
+    bool completed = buildPyramid(audioData.data(), totalSamples, sampleRate, m_memoryBudget, levels, &m_cancelled,
+        [this](int done, int total) {
+            emit progressUpdated(10 + (done * 90) / total);
+        });
+
+    if (completed) {
+        emit logMessage(QString("Built %1 LOD levels (%2 to %3 samples/px) in %4 ms")
+            .arg(levels.size())
+            .arg(levels.first().samplesPerPixel)
+            .arg(levels.last().samplesPerPixel)
+            .arg(timer.elapsed()));
+
+        qint64 totalBytes = 0;
+        QStringList largest;
+        for (const WaveformLevel& level : levels) {
+            totalBytes += level.byteSize();
+            if (level.byteSize() >= 1024 * 1024) {
+                largest.append(QString("%1 spp %2 %3 MB")
+                    .arg(level.samplesPerPixel)
+                    .arg(formatName(level.format))
+                    .arg(level.byteSize() / (1024.0 * 1024.0), 0, 'f', 1));
+            }
         }
+        emit logMessage(QString("Waveform levels use %1 MB (budget %2 MB)%3")
+            .arg(totalBytes / (1024.0 * 1024.0), 0, 'f', 1)
+            .arg(m_memoryBudget / (1024 * 1024))
+            .arg(largest.isEmpty() ? QString() : ": " + largest.join(", ")));
+    }
+}
 
-        output.append(MinMaxPair(minVal, maxVal));
+WaveformWorker::BenchmarkResult WaveformWorker::benchmark(int seconds, int sampleRate, qint64 budgetBytes)
+{
+    BenchmarkResult result;
+    result.seconds = seconds;
+    result.sampleRate = sampleRate;
+
+    const qint64 count = static_cast<qint64>(seconds) * sampleRate;
+    std::vector<float> samples(static_cast<size_t>(count));
+    quint32 noise = 12345;
+    for (qint64 i = 0; i < count; ++i) {
+        noise = noise * 1664525u + 1013904223u;
+        const float envelope = 0.5f + 0.5f * std::sin(static_cast<float>(i) * 6.2831853f * 3.0f / sampleRate);
+        samples[static_cast<size_t>(i)] = envelope * (static_cast<float>(noise >> 8) / 8388608.0f - 1.0f);
     }
+
+    QVector<WaveformLevel> pyramid;
+    QElapsedTimer timer;
+    timer.start();
+    buildPyramid(samples.data(), count, sampleRate, 0, pyramid, nullptr, nullptr);
+    result.pyramidMs = timer.elapsed();
+
+    QVector<QVector<MinMaxPair>> legacy;
+    timer.restart();
+    buildLevelsPerTask(samples.data(), count, legacy);
+    result.perTaskMs = timer.elapsed();
+
+    result.identical = pyramid.size() == legacy.size();
+    for (int li = 0; result.identical && li < pyramid.size(); ++li) {
+        const WaveformLevel& a = pyramid[li];
+        const QVector<MinMaxPair>& b = legacy[li];
+        result.identical = a.size() == b.size();
+        for (int i = 0; result.identical && i < a.size(); ++i) {
+            const MinMaxPair pair = a.at(i);
+            result.identical = pair.min == b[i].min && pair.max == b[i].max;
+        }
+        result.floatBytes += a.byteSize();
+    }
+
+    QVector<WaveformLevel> compact;
+    buildPyramid(samples.data(), count, sampleRate, budgetBytes, compact, nullptr, nullptr);
+    for (const WaveformLevel& level : compact) {
+        result.compactBytes += level.byteSize();
+    }
+
+    return result;
 }
 
 WaveformGenerator::WaveformGenerator(QObject* parent)
@@ -262,6 +791,8 @@ WaveformGenerator::WaveformGenerator(QObject* parent)
     , m_duration(0)
     , m_isLoaded(false)
     , m_isProcessing(false)
+    , m_memoryBudgetMb(256)
+    , m_peakCacheLimitMb(512)
 {
     m_audioConverter = new AudioConverter(this);
 
@@ -269,6 +800,8 @@ WaveformGenerator::WaveformGenerator(QObject* parent)
     m_workerThread = new QThread(this);
 
     m_worker->setAudioConverter(m_audioConverter);
+    m_worker->setMemoryBudget(static_cast<qint64>(m_memoryBudgetMb) * 1024 * 1024);
+    m_worker->setPeakCacheLimit(static_cast<qint64>(m_peakCacheLimitMb) * 1024 * 1024);
     m_worker->moveToThread(m_workerThread);
 
     connect(m_workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
@@ -277,6 +810,8 @@ WaveformGenerator::WaveformGenerator(QObject* parent)
         this, &WaveformGenerator::onWaveformGenerated);
     connect(m_worker, &WaveformWorker::generationFailed,
         this, &WaveformGenerator::onGenerationFailed);
+    connect(m_worker, &WaveformWorker::previewBlockReady,
+        this, &WaveformGenerator::onPreviewBlockReady);
     connect(m_worker, &WaveformWorker::progressUpdated,
         this, &WaveformGenerator::onProgressUpdated);
     connect(m_worker, &WaveformWorker::logMessage,
@@ -287,6 +822,55 @@ WaveformGenerator::WaveformGenerator(QObject* parent)
     emit logMessage("WaveformGenerator initialized");
 }
 
+void WaveformGenerator::setDecodeService(AudioDecodeService* service)
+{
+    m_worker->setDecodeService(service);
+}
+
+void WaveformGenerator::setMemoryBudgetMb(int megabytes)
+{
+    megabytes = qMax(0, megabytes);
+    if (m_memoryBudgetMb == megabytes) {
+        return;
+    }
+
+    m_memoryBudgetMb = megabytes;
+    m_worker->setMemoryBudget(static_cast<qint64>(megabytes) * 1024 * 1024);
+    emit memoryBudgetMbChanged();
+    emit logMessage(QString("Waveform memory budget: %1 MB (applies to the next load)").arg(megabytes));
+}
+
+void WaveformGenerator::setPeakCacheLimitMb(int megabytes)
+{
+    megabytes = qMax(0, megabytes);
+    if (m_peakCacheLimitMb == megabytes) {
+        return;
+    }
+
+    m_peakCacheLimitMb = megabytes;
+    m_worker->setPeakCacheLimit(static_cast<qint64>(megabytes) * 1024 * 1024);
+    emit peakCacheLimitMbChanged();
+    emit logMessage(megabytes > 0
+        ? QString("Peak cache limit: %1 MB").arg(megabytes)
+        : QString("Peak cache disabled"));
+}
+
+void WaveformGenerator::clearPeakCache()
+{
+    QMetaObject::invokeMethod(m_worker, [this]() {
+        m_worker->clearPeakCache();
+        }, Qt::QueuedConnection);
+}
+
+qint64 WaveformGenerator::memoryUsage() const
+{
+    qint64 total = 0;
+    for (const WaveformLevel& level : m_levels) {
+        total += level.byteSize();
+    }
+    return total;
+}
+
 WaveformGenerator::~WaveformGenerator()
 {
     if (m_workerThread) {
@@ -317,6 +901,7 @@ bool WaveformGenerator::loadAudio(const QString& filePath)
 void WaveformGenerator::clear()
 {
     m_levels.clear();
+    m_previewBuffers.clear();
     m_duration = 0;
     m_isLoaded = false;
 
@@ -370,17 +955,26 @@ int WaveformGenerator::findBestLevel(double pixelsPerSecond) const
     return bestIndex;
 }
 
+WaveformLevel WaveformGenerator::level(int levelIndex) const
+{
+    if (levelIndex < 0 || levelIndex >= m_levels.size()) {
+        return WaveformLevel();
+    }
+    return m_levels[levelIndex];
+}
+
 QVariantList WaveformGenerator::getLevelData(int levelIndex) const
 {
     if (levelIndex < 0 || levelIndex >= m_levels.size()) {
         return QVariantList();
     }
 
-    const QVector<MinMaxPair>& data = m_levels[levelIndex].data;
+    const WaveformLevel& level = m_levels[levelIndex];
     QVariantList result;
-    result.reserve(data.size() * 2);
+    result.reserve(level.size() * 2);
 
-    for (const MinMaxPair& pair : data) {
+    for (int i = 0; i < level.size(); ++i) {
+        const MinMaxPair pair = level.at(i);
         result.append(pair.min);
         result.append(pair.max);
     }
@@ -388,9 +982,44 @@ QVariantList WaveformGenerator::getLevelData(int levelIndex) const
     return result;
 }
 
+QVariantList WaveformGenerator::levelMemoryUsage() const
+{
+    QVariantList result;
+    for (const WaveformLevel& level : m_levels) {
+        QVariantMap entry;
+        entry["samplesPerPixel"] = level.samplesPerPixel;
+        entry["format"] = formatName(level.format);
+        entry["entries"] = level.size();
+        entry["bytes"] = level.byteSize();
+        result.append(entry);
+    }
+    return result;
+}
+
+QString WaveformGenerator::runPyramidBenchmark(int seconds)
+{
+    WaveformWorker::BenchmarkResult result = WaveformWorker::benchmark(qMax(1, seconds));
+
+    QString summary = QString("Waveform LOD benchmark (%1 s at %2 Hz, %3 threads): "
+        "single-pass pyramid %4 ms, per-level rescans %5 ms, results %6; "
+        "float levels %7 MB, compact levels %8 MB")
+        .arg(result.seconds)
+        .arg(result.sampleRate)
+        .arg(QThreadPool::globalInstance()->maxThreadCount())
+        .arg(result.pyramidMs)
+        .arg(result.perTaskMs)
+        .arg(result.identical ? "identical" : "DIFFER")
+        .arg(result.floatBytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(result.compactBytes / (1024.0 * 1024.0), 0, 'f', 1);
+
+    emit logMessage(summary);
+    return summary;
+}
+
 void WaveformGenerator::onWaveformGenerated(QVector<WaveformLevel> levels, qint64 duration)
 {
     m_levels = levels;
+    m_previewBuffers.clear();
     m_duration = duration;
     m_isLoaded = true;
     m_isProcessing = false;
@@ -406,6 +1035,59 @@ void WaveformGenerator::onWaveformGenerated(QVector<WaveformLevel> levels, qint6
         .arg(levels.size()));
 }
 
+void WaveformGenerator::onPreviewBlockReady(QVector<WaveformLevel> block, qint64 startMs, qint64 endMs, qint64 expectedDurationMs)
+{
+    if (!m_isProcessing || block.isEmpty()) {
+        return;
+    }
+
+    const bool fresh = m_levels.size() != block.size() || m_previewBuffers.size() != block.size();
+    if (fresh) {
+        m_levels = block;
+        m_previewBuffers.resize(block.size());
+        for (int i = 0; i < block.size(); ++i) {
+            // Room for the whole file up front, so appends never reallocate.
+            const WaveformLevel& level = block[i];
+            const qint64 bytesPerEntry = level.count > 0 ? level.data.size() / level.count : 0;
+            const qint64 expectedEntries = static_cast<qint64>(expectedDurationMs / 1000.0 * level.pixelsPerSecond) + 1;
+            m_previewBuffers[i] = std::make_shared<QByteArray>();
+            m_previewBuffers[i]->reserve(qMax<qint64>(level.data.size(), expectedEntries * bytesPerEntry));
+            m_previewBuffers[i]->append(level.data);
+        }
+    }
+    else {
+        for (int i = 0; i < block.size(); ++i) {
+            std::shared_ptr<QByteArray>& buffer = m_previewBuffers[i];
+            const qint64 needed = buffer->size() + block[i].data.size();
+            if (needed > buffer->capacity()) {
+                // The duration estimate was short. Move to a new buffer and
+                // leave the old one to the copies still pointing into it.
+                auto grown = std::make_shared<QByteArray>();
+                grown->reserve(qMax<qint64>(needed, buffer->capacity() * 2));
+                grown->append(*buffer);
+                buffer = grown;
+            }
+            buffer->append(block[i].data);
+            m_levels[i].count += block[i].count;
+        }
+    }
+
+    for (int i = 0; i < m_levels.size(); ++i) {
+        m_levels[i].data = QByteArray::fromRawData(m_previewBuffers[i]->constData(), m_previewBuffers[i]->size());
+        m_levels[i].mapping = m_previewBuffers[i];
+    }
+
+    if (expectedDurationMs > m_duration) {
+        m_duration = expectedDurationMs;
+        emit durationChanged();
+    }
+
+    if (fresh) {
+        emit levelsChanged();
+    }
+    emit levelsRangeUpdated(startMs, endMs);
+}
+
 void WaveformGenerator::onGenerationFailed(const QString& error)
 {
     m_isProcessing = false;
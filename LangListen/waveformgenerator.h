@@ -4,12 +4,15 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
+#include <QByteArray>
 #include <QVariantList>
 #include <QThread>
 #include <QMutex>
 #include <QMap>
 #include <atomic>
+#include <memory>
 #include "audioconverter.h"
+#include "audiodecodeservice.h"
 
 struct MinMaxPair {
     float min;
@@ -19,47 +22,150 @@ struct MinMaxPair {
     MinMaxPair(float _min, float _max) : min(_min), max(_max) {}
 };
 
+enum class WaveformFormat {
+    Float32,
+    Int16,
+    Int8
+};
+
+// One LOD, packed according to `format`. Quantized entries hold
+// value / scale rounded outwards so the envelope never shrinks. Levels at
+// one sample per pixel store a single value per entry (min == max).
 struct WaveformLevel {
-    QVector<MinMaxPair> data;
+    QByteArray data;
+    // Keeps a memory-mapped peak file alive while `data` points into it.
+    std::shared_ptr<const void> mapping;
+    WaveformFormat format;
+    float scale;
+    bool singleValue;
+    int count;
     int samplesPerPixel;
     double pixelsPerSecond;
 
-    WaveformLevel() : samplesPerPixel(0), pixelsPerSecond(0.0) {}
+    WaveformLevel()
+        : format(WaveformFormat::Float32)
+        , scale(1.0f)
+        , singleValue(false)
+        , count(0)
+        , samplesPerPixel(0)
+        , pixelsPerSecond(0.0)
+    {
+    }
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    qint64 byteSize() const { return data.size(); }
+
+    static int bytesPerValue(WaveformFormat format)
+    {
+        switch (format) {
+        case WaveformFormat::Int16: return 2;
+        case WaveformFormat::Int8: return 1;
+        default: return 4;
+        }
+    }
+
+    MinMaxPair at(int index) const
+    {
+        const int values = singleValue ? 1 : 2;
+        const char* p = data.constData() + static_cast<qint64>(index) * values * bytesPerValue(format);
+        float mn;
+        float mx;
+        switch (format) {
+        case WaveformFormat::Int16: {
+            const qint16* v = reinterpret_cast<const qint16*>(p);
+            mn = v[0] * scale;
+            mx = v[values - 1] * scale;
+            break;
+        }
+        case WaveformFormat::Int8: {
+            const qint8* v = reinterpret_cast<const qint8*>(p);
+            mn = v[0] * scale;
+            mx = v[values - 1] * scale;
+            break;
+        }
+        default: {
+            const float* v = reinterpret_cast<const float*>(p);
+            mn = v[0];
+            mx = v[values - 1];
+            break;
+        }
+        }
+        return MinMaxPair(mn, mx);
+    }
 };
 
+class WaveformPeakCache;
+
 class WaveformWorker : public QObject
 {
     Q_OBJECT
 
 public:
+    struct BenchmarkResult {
+        int seconds;
+        int sampleRate;
+        qint64 pyramidMs;
+        qint64 perTaskMs;
+        qint64 floatBytes;
+        qint64 compactBytes;
+        bool identical;
+
+        BenchmarkResult()
+            : seconds(0)
+            , sampleRate(0)
+            , pyramidMs(0)
+            , perTaskMs(0)
+            , floatBytes(0)
+            , compactBytes(0)
+            , identical(false)
+        {
+        }
+    };
+
     explicit WaveformWorker(QObject* parent = nullptr);
     ~WaveformWorker();
 
+    // Builds all LODs for synthetic audio with the single-pass pyramid and
+    // with the previous one-task-per-level rescans, and checks they agree.
+    // Also reports the footprint of float levels versus the compact formats
+    // chosen under `budgetBytes`.
+    static BenchmarkResult benchmark(int seconds, int sampleRate = 44100, qint64 budgetBytes = 64 * 1024 * 1024);
+
+    void setMemoryBudget(qint64 bytes) { m_memoryBudget = bytes; }
+    void setPeakCacheLimit(qint64 bytes);
+
     void setAudioConverter(AudioConverter* converter) { m_audioConverter = converter; }
+    void setDecodeService(AudioDecodeService* service) { m_decodeService = service; }
 
 public slots:
     void processAudio(const QString& filePath);
     void cancel();
+    void clearPeakCache();
 
 signals:
     void progressUpdated(int progress);
     void waveformGenerated(QVector<WaveformLevel> levels, qint64 duration);
+    // Coarse levels for [startMs, endMs) of a file still being decoded; each
+    // entry of `block` holds only the new data of that level.
+    void previewBlockReady(QVector<WaveformLevel> block, qint64 startMs, qint64 endMs, qint64 expectedDurationMs);
     void generationFailed(const QString& error);
     void logMessage(const QString& message);
 
 private:
     AudioConverter* m_audioConverter;
+    AudioDecodeService* m_decodeService;
     std::atomic<bool> m_cancelled;
+    std::atomic<qint64> m_memoryBudget;
+    WaveformPeakCache* m_peakCache;
+
+    bool loadSharedAudio(const QString& filePath, std::shared_ptr<DecodedAudio>& decoded);
+    void deliverPreview(const DecodedAudio& decoded, QVector<qint64>& pixels, qint64& delivered, bool final);
 
     void generateMultiLevelWaveform(const std::vector<float>& audioData,
         int sampleRate,
         QVector<WaveformLevel>& levels,
         qint64& duration);
-
-    void generateLevel(const std::vector<float>& audioData,
-        int sampleRate,
-        int samplesPerPixel,
-        QVector<MinMaxPair>& output);
 };
 
 class WaveformGenerator : public QObject
@@ -68,6 +174,9 @@ class WaveformGenerator : public QObject
         Q_PROPERTY(qint64 duration READ duration NOTIFY durationChanged)
         Q_PROPERTY(bool isLoaded READ isLoaded NOTIFY isLoadedChanged)
         Q_PROPERTY(bool isProcessing READ isProcessing NOTIFY isProcessingChanged)
+        Q_PROPERTY(int memoryBudgetMb READ memoryBudgetMb WRITE setMemoryBudgetMb NOTIFY memoryBudgetMbChanged)
+        Q_PROPERTY(qint64 memoryUsage READ memoryUsage NOTIFY levelsChanged)
+        Q_PROPERTY(int peakCacheLimitMb READ peakCacheLimitMb WRITE setPeakCacheLimitMb NOTIFY peakCacheLimitMbChanged)
 
 public:
     explicit WaveformGenerator(QObject* parent = nullptr);
@@ -76,35 +185,60 @@ public:
     qint64 duration() const { return m_duration; }
     bool isLoaded() const { return m_isLoaded; }
     bool isProcessing() const { return m_isProcessing; }
+    int memoryBudgetMb() const { return m_memoryBudgetMb; }
+    void setMemoryBudgetMb(int megabytes);
+    qint64 memoryUsage() const;
+    int peakCacheLimitMb() const { return m_peakCacheLimitMb; }
+    void setPeakCacheLimitMb(int megabytes);
 
     const QVector<WaveformLevel>& getLevels() const { return m_levels; }
+    // Implicitly shared copy for C++ consumers: no sample data is copied and
+    // the copy stays valid even if the generator replaces its levels.
+    WaveformLevel level(int levelIndex) const;
+
+    void setDecodeService(AudioDecodeService* service);
 
     Q_INVOKABLE bool loadAudio(const QString& filePath);
     Q_INVOKABLE void clear();
     Q_INVOKABLE void cancelLoading();
+    Q_INVOKABLE void clearPeakCache();
     Q_INVOKABLE int findBestLevel(double pixelsPerSecond) const;
+    // Boxes every entry into a QVariant; meant for QML only.
     Q_INVOKABLE QVariantList getLevelData(int levelIndex) const;
+    Q_INVOKABLE QVariantList levelMemoryUsage() const;
+    Q_INVOKABLE QString runPyramidBenchmark(int seconds = 600);
 
 signals:
     void durationChanged();
     void isLoadedChanged();
     void isProcessingChanged();
+    void memoryBudgetMbChanged();
+    void peakCacheLimitMbChanged();
     void loadingProgress(int progress);
     void loadingCompleted();
     void loadingFailed(const QString& error);
     void logMessage(const QString& message);
     void levelsChanged();
+    // Data for [startMs, endMs) was appended to the levels while loading.
+    void levelsRangeUpdated(qint64 startMs, qint64 endMs);
 
 private slots:
     void onWaveformGenerated(QVector<WaveformLevel> levels, qint64 duration);
+    void onPreviewBlockReady(QVector<WaveformLevel> block, qint64 startMs, qint64 endMs, qint64 expectedDurationMs);
     void onGenerationFailed(const QString& error);
     void onProgressUpdated(int progress);
 
 private:
     QVector<WaveformLevel> m_levels;
+    // Growing storage behind the preview levels. The levels handed out are
+    // raw views into it that keep it alive through `mapping`, so the view's
+    // copies never share the buffer being appended to.
+    QVector<std::shared_ptr<QByteArray>> m_previewBuffers;
     qint64 m_duration;
     bool m_isLoaded;
     bool m_isProcessing;
+    int m_memoryBudgetMb;
+    int m_peakCacheLimitMb;
 
     AudioConverter* m_audioConverter;
     WaveformWorker* m_worker;
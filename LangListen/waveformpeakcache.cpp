@@ -0,0 +1,298 @@
+﻿#include "waveformpeakcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const char kMagic[8] = { 'L', 'L', 'P', 'E', 'A', 'K', 'S', '\0' };
+const quint32 kVersion = 1;
+const quint32 kByteOrderMark = 0x01020304;
+const qint64 kAlignment = 16;
+
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 levelCount;
+    quint32 reserved;
+    qint64 sourceSize;
+    qint64 sourceModifiedMs;
+    qint64 budgetBytes;
+    qint64 durationMs;
+};
+
+struct LevelHeader {
+    qint32 samplesPerPixel;
+    qint32 format;
+    qint32 singleValue;
+    qint32 count;
+    float scale;
+    quint32 reserved;
+    double pixelsPerSecond;
+    qint64 offset;
+    qint64 bytes;
+};
+
+static_assert(sizeof(FileHeader) == 56, "peak file header layout changed");
+static_assert(sizeof(LevelHeader) == 48, "peak level header layout changed");
+
+qint64 alignUp(qint64 value)
+{
+    return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+qint64 expectedBytes(const LevelHeader& level)
+{
+    return static_cast<qint64>(level.count) * (level.singleValue ? 1 : 2) *
+        WaveformLevel::bytesPerValue(static_cast<WaveformFormat>(level.format));
+}
+
+}
+
+WaveformPeakCache::WaveformPeakCache(const QString& directory)
+    : m_directory(directory)
+    , m_maxBytes(512LL * 1024 * 1024)
+{
+    if (m_directory.isEmpty()) {
+        m_directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/peaks";
+    }
+}
+
+QString WaveformPeakCache::peakFilePath(const QString& audioPath) const
+{
+    QFileInfo fileInfo(audioPath);
+    QString key = fileInfo.canonicalFilePath().isEmpty() ? fileInfo.absoluteFilePath() : fileInfo.canonicalFilePath();
+    QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + "/" + QString::fromLatin1(hash) + ".peaks";
+}
+
+bool WaveformPeakCache::load(const QString& audioPath, qint64 budgetBytes, QVector<WaveformLevel>& levels, qint64& durationMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto fail = [this](const QString& error) {
+        QMutexLocker locker(&m_mutex);
+        m_stats.misses++;
+        m_lastError = error;
+        return false;
+    };
+
+    if (m_maxBytes <= 0) {
+        return fail(QString());
+    }
+
+    QFileInfo source(audioPath);
+    const QString path = peakFilePath(audioPath);
+
+    // The QFile owns the mapping; every loaded level holds a reference so the
+    // mapping outlives the last copy of the levels.
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return fail(QString());
+    }
+
+    const qint64 fileSize = file->size();
+    if (fileSize < static_cast<qint64>(sizeof(FileHeader))) {
+        return fail("Peak file is truncated: " + path);
+    }
+
+    const uchar* base = file->map(0, fileSize);
+    if (!base) {
+        return fail("Cannot map peak file: " + file->errorString());
+    }
+
+    FileHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion ||
+        header.byteOrder != kByteOrderMark) {
+        return fail("Peak file has an unknown format: " + path);
+    }
+
+    if (header.sourceSize != source.size() ||
+        header.sourceModifiedMs != source.lastModified().toMSecsSinceEpoch() ||
+        header.budgetBytes != budgetBytes) {
+        return fail("Peak file is stale: " + path);
+    }
+
+    const qint64 tableEnd = static_cast<qint64>(sizeof(FileHeader)) +
+        static_cast<qint64>(header.levelCount) * static_cast<qint64>(sizeof(LevelHeader));
+    if (header.levelCount == 0 || tableEnd > fileSize) {
+        return fail("Peak file has a corrupt level table: " + path);
+    }
+
+    std::shared_ptr<const void> mapping = file;
+    QVector<WaveformLevel> result;
+    result.reserve(static_cast<int>(header.levelCount));
+
+    for (quint32 li = 0; li < header.levelCount; ++li) {
+        LevelHeader entry;
+        memcpy(&entry, base + sizeof(FileHeader) + li * sizeof(LevelHeader), sizeof(entry));
+
+        if (entry.samplesPerPixel <= 0 || entry.count < 0 ||
+            entry.format < static_cast<qint32>(WaveformFormat::Float32) ||
+            entry.format > static_cast<qint32>(WaveformFormat::Int8) ||
+            entry.bytes != expectedBytes(entry) ||
+            entry.offset < tableEnd || entry.offset % kAlignment != 0 ||
+            entry.offset + entry.bytes > fileSize) {
+            return fail("Peak file has a corrupt level table: " + path);
+        }
+
+        WaveformLevel level;
+        level.data = QByteArray::fromRawData(reinterpret_cast<const char*>(base + entry.offset), entry.bytes);
+        level.mapping = mapping;
+        level.format = static_cast<WaveformFormat>(entry.format);
+        level.scale = entry.scale;
+        level.singleValue = entry.singleValue != 0;
+        level.count = entry.count;
+        level.samplesPerPixel = entry.samplesPerPixel;
+        level.pixelsPerSecond = entry.pixelsPerSecond;
+        result.append(level);
+    }
+
+    levels = result;
+    durationMs = header.durationMs;
+
+    // Mark the file as recently used for eviction.
+    QFile touch(path);
+    if (touch.open(QIODevice::ReadWrite)) {
+        touch.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_stats.hits++;
+    m_stats.lastLoadMs = timer.elapsed();
+    m_lastError.clear();
+    return true;
+}
+
+bool WaveformPeakCache::store(const QString& audioPath, qint64 budgetBytes, const QVector<WaveformLevel>& levels, qint64 durationMs)
+{
+    auto fail = [this](const QString& error) {
+        QMutexLocker locker(&m_mutex);
+        m_lastError = error;
+        return false;
+    };
+
+    if (m_maxBytes <= 0 || levels.isEmpty()) {
+        return false;
+    }
+
+    if (!QDir().mkpath(m_directory)) {
+        return fail("Cannot create peak cache directory: " + m_directory);
+    }
+
+    QFileInfo source(audioPath);
+    QSaveFile file(peakFilePath(audioPath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return fail("Cannot write peak file: " + file.errorString());
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.levelCount = static_cast<quint32>(levels.size());
+    header.sourceSize = source.size();
+    header.sourceModifiedMs = source.lastModified().toMSecsSinceEpoch();
+    header.budgetBytes = budgetBytes;
+    header.durationMs = durationMs;
+
+    QVector<LevelHeader> table(levels.size());
+    qint64 offset = alignUp(sizeof(FileHeader) + levels.size() * sizeof(LevelHeader));
+
+    for (int li = 0; li < levels.size(); ++li) {
+        const WaveformLevel& level = levels[li];
+        LevelHeader& entry = table[li];
+        memset(&entry, 0, sizeof(entry));
+        entry.samplesPerPixel = level.samplesPerPixel;
+        entry.format = static_cast<qint32>(level.format);
+        entry.singleValue = level.singleValue ? 1 : 0;
+        entry.count = level.count;
+        entry.scale = level.scale;
+        entry.pixelsPerSecond = level.pixelsPerSecond;
+        entry.offset = offset;
+        entry.bytes = level.byteSize();
+        offset = alignUp(offset + entry.bytes);
+    }
+
+    qint64 written = file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    written += file.write(reinterpret_cast<const char*>(table.constData()), table.size() * sizeof(LevelHeader));
+
+    for (int li = 0; li < levels.size(); ++li) {
+        if (written < table[li].offset) {
+            written += file.write(QByteArray(table[li].offset - written, '\0'));
+        }
+        written += file.write(levels[li].data.constData(), levels[li].byteSize());
+    }
+
+    if (written != table.last().offset + table.last().bytes || !file.commit()) {
+        return fail("Failed to write peak file: " + file.errorString());
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stats.writes++;
+        m_lastError.clear();
+    }
+
+    evict();
+    return true;
+}
+
+qint64 WaveformPeakCache::evict()
+{
+    QDir dir(m_directory);
+    const QFileInfoList files = dir.entryInfoList(QStringList() << "*.peaks", QDir::Files, QDir::Time);
+
+    qint64 kept = 0;
+    qint64 removed = 0;
+    for (const QFileInfo& fileInfo : files) {
+        if (kept + fileInfo.size() <= m_maxBytes) {
+            kept += fileInfo.size();
+            continue;
+        }
+        // A file still mapped by a loaded waveform may refuse removal on
+        // Windows; it is retried on the next eviction.
+        if (QFile::remove(fileInfo.absoluteFilePath())) {
+            removed += fileInfo.size();
+        }
+        else {
+            kept += fileInfo.size();
+        }
+    }
+
+    return removed;
+}
+
+void WaveformPeakCache::clear()
+{
+    QDir dir(m_directory);
+    const QFileInfoList files = dir.entryInfoList(QStringList() << "*.peaks", QDir::Files);
+    for (const QFileInfo& fileInfo : files) {
+        QFile::remove(fileInfo.absoluteFilePath());
+    }
+}
+
+WaveformPeakCache::Stats WaveformPeakCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+QString WaveformPeakCache::lastError() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lastError;
+}
@@ -0,0 +1,60 @@
+﻿#ifndef WAVEFORMPEAKCACHE_H
+#define WAVEFORMPEAKCACHE_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+#include "waveformgenerator.h"
+
+// On-disk cache of generated waveform pyramids, one versioned peak file per
+// audio file. Files are keyed by the canonical path and validated against the
+// audio's size and modification time; loaded levels alias a memory mapping of
+// the file, so reopening a file costs neither decoding nor copying. The
+// directory is trimmed to a total size, least recently used files first.
+class WaveformPeakCache
+{
+public:
+    struct Stats {
+        int hits;
+        int misses;
+        int writes;
+        qint64 lastLoadMs;
+
+        Stats()
+            : hits(0)
+            , misses(0)
+            , writes(0)
+            , lastLoadMs(0)
+        {
+        }
+    };
+
+    explicit WaveformPeakCache(const QString& directory = QString());
+
+    QString directory() const { return m_directory; }
+    void setMaxBytes(qint64 bytes) { m_maxBytes = bytes; }
+    qint64 maxBytes() const { return m_maxBytes; }
+
+    // `budgetBytes` is part of the key: a different budget yields different
+    // formats, so a file built under another budget is treated as a miss.
+    bool load(const QString& audioPath, qint64 budgetBytes, QVector<WaveformLevel>& levels, qint64& durationMs);
+    bool store(const QString& audioPath, qint64 budgetBytes, const QVector<WaveformLevel>& levels, qint64 durationMs);
+
+    qint64 evict();
+    void clear();
+    Stats stats() const;
+    QString lastError() const;
+
+private:
+    QString peakFilePath(const QString& audioPath) const;
+
+    QString m_directory;
+    std::atomic<qint64> m_maxBytes;
+
+    mutable QMutex m_mutex;
+    Stats m_stats;
+    QString m_lastError;
+};
+
+#endif
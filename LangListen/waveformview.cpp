@@ -5,9 +5,254 @@
 #include <QtMath>
 #include <QtConcurrent>
 #include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
+#include <QSGRendererInterface>
+#include <QSGSimpleRectNode>
+#include <QSGTransformNode>
+#include <QSGVertexColorMaterial>
+#include <QFutureWatcher>
+
+namespace {
+
+const int kTileWidth = 256;
+const int kMaxCachedTiles = 512;
+
+// Fixed child layout of the item's scene graph subtree, bottom to top.
+class WaveformRootNode : public QSGNode
+{
+public:
+    struct TileNode {
+        std::shared_ptr<const WaveformTile> tile;
+        QSGTransformNode* transform;
+    };
+
+    WaveformRootNode()
+        : background(nullptr)
+        , tiles(nullptr)
+        , highlights(nullptr)
+        , overlay(nullptr)
+        , playhead(nullptr)
+    {
+    }
+
+    ~WaveformRootNode()
+    {
+        if (overlay) {
+            delete overlay->texture();
+        }
+    }
+
+    QSGSimpleRectNode* background;
+    QSGNode* tiles;
+    // Keyed by tile; holding the tile keeps its address from being reused.
+    QHash<const WaveformTile*, TileNode> tileNodes;
+    QSGNode* highlights;
+    QSGImageNode* overlay;
+    QSGSimpleRectNode* playhead;
+};
+
+QSGGeometryNode* createColoredNode(QSGGeometry::DrawingMode mode)
+{
+    auto* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+    geometry->setDrawingMode(mode);
+    geometry->setLineWidth(1.0f);
+
+    auto* node = new QSGGeometryNode();
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setMaterial(new QSGVertexColorMaterial());
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+void setColoredVertex(QSGGeometry::ColoredPoint2D& vertex, qreal x, qreal y, const QColor& color)
+{
+    // The vertex color material expects premultiplied alpha.
+    const qreal alpha = color.alphaF();
+    vertex.set(static_cast<float>(x), static_cast<float>(y),
+        static_cast<uchar>(color.red() * alpha),
+        static_cast<uchar>(color.green() * alpha),
+        static_cast<uchar>(color.blue() * alpha),
+        static_cast<uchar>(color.alpha()));
+}
+
+void updateWaveformGeometry(QSGGeometryNode* barsNode, QSGGeometryNode* segmentsNode, const WaveformShapes& shapes)
+{
+    QSGGeometry* bars = barsNode->geometry();
+    bars->allocate(shapes.bars.size() * 6);
+    QSGGeometry::ColoredPoint2D* v = bars->vertexDataAsColoredPoint2D();
+    for (const WaveformShapes::Bar& bar : shapes.bars) {
+        const QRectF& r = bar.rect;
+        setColoredVertex(v[0], r.left(), r.top(), bar.color);
+        setColoredVertex(v[1], r.right(), r.top(), bar.color);
+        setColoredVertex(v[2], r.left(), r.bottom(), bar.color);
+        setColoredVertex(v[3], r.right(), r.top(), bar.color);
+        setColoredVertex(v[4], r.right(), r.bottom(), bar.color);
+        setColoredVertex(v[5], r.left(), r.bottom(), bar.color);
+        v += 6;
+    }
+    barsNode->markDirty(QSGNode::DirtyGeometry);
+
+    QSGGeometry* segments = segmentsNode->geometry();
+    segments->allocate(shapes.segments.size() * 2);
+    v = segments->vertexDataAsColoredPoint2D();
+    for (const WaveformShapes::Segment& segment : shapes.segments) {
+        setColoredVertex(v[0], segment.line.x1(), segment.line.y1(), segment.color);
+        setColoredVertex(v[1], segment.line.x2(), segment.line.y2(), segment.color);
+        v += 2;
+    }
+    segmentsNode->markDirty(QSGNode::DirtyGeometry);
+}
+
+void replaceTexture(QSGImageNode* node, QSGTexture* texture)
+{
+    QSGTexture* previous = node->texture();
+    node->setTexture(texture);
+    delete previous;
+}
+
+QImage createLayerImage(const QSizeF& size, qreal devicePixelRatio)
+{
+    QImage image((size * devicePixelRatio).toSize().expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(Qt::transparent);
+    return image;
+}
+
+QImage rasterizeShapes(const WaveformShapes& shapes, const QSizeF& size, qreal devicePixelRatio)
+{
+    QImage image = createLayerImage(size, devicePixelRatio);
+    QPainter painter(&image);
+
+    for (const WaveformShapes::Bar& bar : shapes.bars) {
+        painter.fillRect(bar.rect, bar.color);
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    QColor penColor;
+    for (const WaveformShapes::Segment& segment : shapes.segments) {
+        if (segment.color != penColor) {
+            penColor = segment.color;
+            painter.setPen(QPen(penColor, 0.8));
+        }
+        painter.drawLine(segment.line);
+    }
+
+    return image;
+}
+
+// The software scene graph backend draws no custom geometry, so there a
+// tile is shown as a texture of the same shapes.
+QSGNode* createTileContent(QQuickWindow* window, const WaveformTile& tile, qreal height, bool software)
+{
+    if (software) {
+        QImage image = tile.image.isNull()
+            ? rasterizeShapes(tile.shapes, QSizeF(kTileWidth + 1, height), window->effectiveDevicePixelRatio())
+            : tile.image;
+        QSGImageNode* node = window->createImageNode();
+        node->setTexture(window->createTextureFromImage(image));
+        node->setOwnsTexture(true);
+        node->setRect(QRectF(QPointF(0, 0), image.deviceIndependentSize()));
+        return node;
+    }
+
+    auto* content = new QSGNode();
+    QSGGeometryNode* bars = createColoredNode(QSGGeometry::DrawTriangles);
+    QSGGeometryNode* segments = createColoredNode(QSGGeometry::DrawLines);
+    updateWaveformGeometry(bars, segments, tile.shapes);
+    content->appendChildNode(bars);
+    content->appendChildNode(segments);
+    return content;
+}
+
+// Shapes for content pixels [tileX, tileX + width) in tile-local coordinates.
+// Columns inside [highlightFirst, highlightLast] belong to the current
+// sentence. The sample-level polyline reaches one pixel past the tile so
+// neighbouring tiles join up.
+void buildTileShapes(const WaveformLevel& level, qreal pixelsPerSecond, qint64 tileX, int width,
+    qreal height, int highlightFirst, int highlightLast, WaveformShapes& shapes)
+{
+    if (level.isEmpty() || level.pixelsPerSecond <= 0) {
+        return;
+    }
+
+    const qreal centerY = height * 0.5;
+    const qreal amp = height * 0.48;
+    const qreal pixelsPerDataPoint = pixelsPerSecond / level.pixelsPerSecond;
+
+    if (pixelsPerDataPoint >= 4.0) {
+        QPointF previousPoint;
+        bool previousInSentence = false;
+        bool hasPrevious = false;
+
+        for (int pixelX = 0; pixelX <= width; ++pixelX) {
+            qreal globalPixelPos = tileX + pixelX;
+            int idx = qRound(globalPixelPos / pixelsPerDataPoint);
+            if (idx < 0 || idx >= level.size())
+                continue;
+
+            float sampleValue = level.at(idx).max;
+            QPointF point(pixelX, centerY - sampleValue * amp);
+            bool isInCurrentSentence = pixelX >= highlightFirst && pixelX <= highlightLast;
+
+            shapes.bars.append(WaveformShapes::Bar{ QRectF(point.x() - 2.0, point.y() - 2.0, 4.0, 4.0),
+                isInCurrentSentence ? QColor(244, 67, 54) : QColor(30, 50, 100) });
+
+            if (hasPrevious) {
+                shapes.segments.append(WaveformShapes::Segment{ QLineF(previousPoint, point),
+                    (previousInSentence || isInCurrentSentence) ? QColor(244, 67, 54, 180) : QColor(30, 50, 100, 180) });
+            }
+
+            previousPoint = point;
+            previousInSentence = isInCurrentSentence;
+            hasPrevious = true;
+        }
+        return;
+    }
+
+    shapes.bars.reserve(width);
+
+    for (int pixelX = 0; pixelX < width; ++pixelX) {
+        qreal globalPixelPos = tileX + pixelX;
+        int idxStart = qMax(0, qFloor(globalPixelPos / pixelsPerDataPoint));
+        int idxEnd = qMin(level.size(), qCeil((globalPixelPos + 1.0) / pixelsPerDataPoint));
+
+        if (idxStart >= idxEnd)
+            continue;
+
+        const MinMaxPair first = level.at(idxStart);
+        float columnMin = first.min;
+        float columnMax = first.max;
+
+        for (int dataIdx = idxStart + 1; dataIdx < idxEnd; ++dataIdx) {
+            const MinMaxPair pair = level.at(dataIdx);
+            if (pair.min < columnMin) columnMin = pair.min;
+            if (pair.max > columnMax) columnMax = pair.max;
+        }
+
+        qreal yMax = centerY - columnMax * amp;
+        qreal yMin = centerY - columnMin * amp;
+        bool isInCurrentSentence = pixelX >= highlightFirst && pixelX <= highlightLast;
+
+        // Never thinner than a pixel so silent stretches still show the baseline.
+        shapes.bars.append(WaveformShapes::Bar{ QRectF(pixelX, yMax, 1.0, qMax<qreal>(1.0, yMin - yMax)),
+            isInCurrentSentence ? QColor(244, 67, 54) : QColor(33, 66, 133) });
+    }
+}
+
+void appendBorder(QSGNode* parent, const QRectF& rect, const QColor& color, qreal width)
+{
+    parent->appendChildNode(new QSGSimpleRectNode(QRectF(rect.left(), rect.top(), rect.width(), width), color));
+    parent->appendChildNode(new QSGSimpleRectNode(QRectF(rect.left(), rect.bottom() - width, rect.width(), width), color));
+    parent->appendChildNode(new QSGSimpleRectNode(QRectF(rect.left(), rect.top(), width, rect.height()), color));
+    parent->appendChildNode(new QSGSimpleRectNode(QRectF(rect.right() - width, rect.top(), width, rect.height()), color));
+}
+
+}
 
 WaveformView::WaveformView(QQuickItem* parent)
-    : QQuickPaintedItem(parent)
+    : QQuickItem(parent)
     , m_waveformGenerator(nullptr)
     , m_currentPosition(0.0)
     , m_pixelsPerSecond(100.0)
@@ -31,10 +276,15 @@ WaveformView::WaveformView(QQuickItem* parent)
     , m_dragOriginalTime(0)
     , m_hoveredBoundaryIndex(-1)
     , m_hoveredBoundaryIsStart(false)
+    , m_dirty(AllDirty)
+    , m_tileEpoch(0)
+    , m_tileClock(0)
+    , m_tileHits(0)
+    , m_tileMisses(0)
+    , m_softwareBackend(false)
 {
-    setAntialiasing(true);
-    setRenderTarget(QQuickPaintedItem::FramebufferObject);
-    setPerformanceHint(QQuickPaintedItem::FastFBOResizing, true);
+    setFlag(ItemHasContents, true);
+    m_tilePool.setMaxThreadCount(2);
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton);
     setAcceptHoverEvents(true);
 }
@@ -55,6 +305,8 @@ void WaveformView::setWaveformGenerator(WaveformGenerator* generator)
     if (m_waveformGenerator) {
         connect(m_waveformGenerator, &WaveformGenerator::levelsChanged,
             this, &WaveformView::onLevelsChanged);
+        connect(m_waveformGenerator, &WaveformGenerator::levelsRangeUpdated,
+            this, &WaveformView::onLevelsRangeUpdated);
         connect(m_waveformGenerator, &WaveformGenerator::durationChanged,
             this, &WaveformView::updateContentWidth);
 
@@ -75,7 +327,7 @@ void WaveformView::setEnableBoundaryEdit(bool enable)
         m_hoveredBoundaryIndex = -1;
     }
 
-    update();
+    invalidate(OverlayDirty);
     updateCursor();
     emit enableBoundaryEditChanged();
 }
@@ -106,7 +358,7 @@ void WaveformView::setCurrentPosition(qreal position)
         }
     }
 
-    update();
+    invalidate(m_showPerformance ? OverlayDirty : 0);
     emit currentPositionChanged();
 }
 
@@ -126,7 +378,7 @@ void WaveformView::updateCurrentSentence()
             QTimer::singleShot(50, this, &WaveformView::centerCurrentSentence);
         }
 
-        update();
+        invalidate(AllDirty);
         emit currentSentenceIndexChanged();
     }
 }
@@ -233,7 +485,7 @@ void WaveformView::setPixelsPerSecond(qreal pps)
 
     updateContentWidth();
     updateCurrentLevel();
-    update();
+    invalidate(AllDirty);
     emit pixelsPerSecondChanged();
 }
 
@@ -246,7 +498,7 @@ void WaveformView::setScrollPosition(qreal position)
     m_scrollPosition = position;
     m_pageStartTime = pixelsToSeconds(position);
 
-    update();
+    invalidate(AllDirty);
     emit scrollPositionChanged();
 }
 
@@ -255,7 +507,7 @@ void WaveformView::setShowPerformance(bool show)
     if (m_showPerformance == show) return;
     m_showPerformance = show;
     emit showPerformanceChanged();
-    update();
+    invalidate(OverlayDirty);
 }
 
 void WaveformView::setFollowPlayback(bool follow)
@@ -282,7 +534,7 @@ void WaveformView::setShowSentenceHighlight(bool show)
 {
     if (m_showSentenceHighlight == show) return;
     m_showSentenceHighlight = show;
-    update();
+    invalidate(HighlightsDirty);
     emit showSentenceHighlightChanged();
 }
 
@@ -301,23 +553,38 @@ void WaveformView::addSentence(qint64 startMs, qint64 endMs, const QString& text
     }
 
     SentenceSegment segment(startMs, endMs, text);
-    m_sentences.append(segment);
 
-    std::sort(m_sentences.begin(), m_sentences.end(),
-        [](const SentenceSegment& a, const SentenceSegment& b) {
-            return a.startTimeMs < b.startTimeMs;
-        });
+    // Streaming transcription appends in time order; otherwise insert at the sorted position.
+    if (m_sentences.isEmpty() || startMs >= m_sentences.last().startTimeMs) {
+        m_sentences.append(segment);
+        m_sentenceIndex.append(segment);
+    }
+    else {
+        auto it = std::upper_bound(m_sentences.begin(), m_sentences.end(), startMs,
+            [](qint64 ms, const SentenceSegment& seg) { return ms < seg.startTimeMs; });
+        const int index = static_cast<int>(it - m_sentences.begin());
+        m_sentences.insert(index, segment);
+        m_sentenceIndex.insert(index, segment);
+        if (m_currentSentenceIndex >= index) {
+            ++m_currentSentenceIndex;
+            emit currentSentenceIndexChanged();
+        }
+        if (m_hoveredSentenceIndex >= index) {
+            ++m_hoveredSentenceIndex;
+        }
+    }
 
-    update();
+    invalidate(AllDirty);
     updateCurrentSentence();
 }
 
 void WaveformView::clearSentences()
 {
     m_sentences.clear();
+    m_sentenceIndex.clear();
     m_currentSentenceIndex = -1;
     m_hoveredSentenceIndex = -1;
-    update();
+    invalidate(AllDirty);
     emit currentSentenceIndexChanged();
 }
 
@@ -336,12 +603,7 @@ QVariantMap WaveformView::getSentenceAt(int index) const
 
 int WaveformView::findSentenceAtTime(qint64 timeMs) const
 {
-    for (int i = 0; i < m_sentences.size(); ++i) {
-        if (m_sentences[i].contains(timeMs)) {
-            return i;
-        }
-    }
-    return -1;
+    return m_sentenceIndex.find(timeMs, m_currentSentenceIndex);
 }
 
 void WaveformView::seekToPosition(qreal normalizedPosition)
@@ -566,7 +828,7 @@ void WaveformView::mouseReleaseEvent(QMouseEvent* event)
         emit boundaryDragEnded();
 
         updateCursor();
-        update();
+        invalidate(AllDirty);
         event->accept();
         return;
     }
@@ -610,8 +872,9 @@ void WaveformView::mouseMoveEvent(QMouseEvent* event)
 
             seg.endTimeMs = newTimeMs;
         }
+        m_sentenceIndex.rebuild(m_sentences);
 
-        update();
+        invalidate(AllDirty);
         event->accept();
         return;
     }
@@ -622,9 +885,9 @@ void WaveformView::mouseMoveEvent(QMouseEvent* event)
 
     if (timeMs != m_hoveredTimeMs) {
         m_hoveredTimeMs = timeMs;
-        m_hoveredSentenceIndex = findSentenceAtTime(timeMs);
+        m_hoveredSentenceIndex = m_sentenceIndex.find(timeMs, m_hoveredSentenceIndex);
         emit hoveredTimeChanged(timeMs);
-        update();
+        invalidate(HighlightsDirty | OverlayDirty);
     }
 
     event->accept();
@@ -644,7 +907,7 @@ void WaveformView::hoverMoveEvent(QHoverEvent* event)
             m_hoveredBoundaryIndex = sentenceIndex;
             m_hoveredBoundaryIsStart = isStart;
             updateCursor();
-            update();
+            invalidate(OverlayDirty);
             return;
         }
     }
@@ -652,7 +915,7 @@ void WaveformView::hoverMoveEvent(QHoverEvent* event)
     if (m_hoveredBoundaryIndex >= 0) {
         m_hoveredBoundaryIndex = -1;
         updateCursor();
-        update();
+        invalidate(OverlayDirty);
     }
 
     qreal mouseX = event->position().x();
@@ -661,9 +924,9 @@ void WaveformView::hoverMoveEvent(QHoverEvent* event)
 
     if (timeMs != m_hoveredTimeMs) {
         m_hoveredTimeMs = timeMs;
-        m_hoveredSentenceIndex = findSentenceAtTime(timeMs);
+        m_hoveredSentenceIndex = m_sentenceIndex.find(timeMs, m_hoveredSentenceIndex);
         emit hoveredTimeChanged(timeMs);
-        update();
+        invalidate(HighlightsDirty | OverlayDirty);
     }
 }
 
@@ -672,7 +935,7 @@ void WaveformView::hoverLeaveEvent(QHoverEvent* event)
     Q_UNUSED(event);
     m_hoveredTimeMs = -1;
     m_hoveredSentenceIndex = -1;
-    update();
+    invalidate(HighlightsDirty | OverlayDirty);
 }
 
 void WaveformView::wheelEvent(QWheelEvent* event)
@@ -723,74 +986,362 @@ void WaveformView::wheelEvent(QWheelEvent* event)
 
 void WaveformView::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
 {
-    QQuickPaintedItem::geometryChange(newGeometry, oldGeometry);
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
     if (newGeometry.size() != oldGeometry.size()) {
         updateContentWidth();
-        update();
+        invalidate(AllDirty);
     }
 }
 
 void WaveformView::onLevelsChanged()
 {
+    clearTileCache();
+    updateCurrentLevel();
+    invalidate(WaveformDirty);
+}
+
+void WaveformView::onLevelsRangeUpdated(qint64 startMs, qint64 endMs)
+{
+    if (!m_waveformGenerator) {
+        return;
+    }
+
+    const int previousIndex = m_currentLevelIndex;
+    const bool hadLevel = !m_currentLevel.isEmpty();
     updateCurrentLevel();
+
+    if (!hadLevel || m_currentLevelIndex != previousIndex) {
+        clearTileCache();
+        invalidate(WaveformDirty);
+        return;
+    }
+
+    m_currentLevel = m_waveformGenerator->level(m_currentLevelIndex);
+    invalidateTiles(startMs, endMs);
+
+    // Only rebuild the waveform when the newly decoded span is on screen.
+    const qreal left = timeToPixel(startMs) - m_scrollPosition;
+    const qreal right = timeToPixel(endMs) - m_scrollPosition;
+    if (right >= 0.0 && left <= width()) {
+        invalidate(WaveformDirty);
+    }
+}
+
+void WaveformView::invalidate(int flags)
+{
+    m_dirty |= flags;
+    if (flags & WaveformDirty) {
+        polish();
+    }
     update();
 }
 
+void WaveformView::updatePolish()
+{
+    const QVector<VisibleTile> previousTiles = m_visibleTiles;
+    m_visibleTiles.clear();
+    m_softwareBackend = window() && window()->rendererInterface() &&
+        window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software;
+
+    if (m_currentLevel.isEmpty() || !m_waveformGenerator || width() <= 0 || height() <= 0) {
+        return;
+    }
+
+    qreal sentenceStart = -1;
+    qreal sentenceEnd = -2;
+    if (m_currentSentenceIndex >= 0 && m_currentSentenceIndex < m_sentences.size()) {
+        const SentenceSegment& seg = m_sentences[m_currentSentenceIndex];
+        sentenceStart = timeToPixel(seg.startTimeMs);
+        sentenceEnd = timeToPixel(seg.endTimeMs);
+    }
+
+    const qint64 firstIndex = qFloor(m_scrollPosition / kTileWidth);
+    const qint64 lastIndex = qFloor((m_scrollPosition + width()) / kTileWidth);
+
+    for (qint64 index = firstIndex; index <= lastIndex; ++index) {
+        const qint64 tileX = index * kTileWidth;
+
+        WaveformTileKey key;
+        key.epoch = m_tileEpoch;
+        key.levelIndex = m_currentLevelIndex;
+        key.pixelsPerSecondMilli = qRound64(m_pixelsPerSecond * 1000.0);
+        key.height = qCeil(height());
+        key.index = index;
+        key.highlightFirst = qMax(0, qCeil(sentenceStart - tileX));
+        key.highlightLast = qMin(kTileWidth, qFloor(sentenceEnd - tileX));
+        if (key.highlightFirst > key.highlightLast) {
+            key.highlightFirst = -1;
+            key.highlightLast = -1;
+        }
+
+        VisibleTile visible;
+        visible.key = key;
+        visible.x = tileX;
+
+        auto it = m_tileCache.find(key);
+        if (it != m_tileCache.end()) {
+            ++m_tileHits;
+            it->lastUse = ++m_tileClock;
+            visible.tile = it->tile;
+        }
+        else {
+            ++m_tileMisses;
+            requestTile(key, tileX);
+
+            // Keep showing what was there (e.g. the old highlight) until the
+            // replacement arrives instead of flashing an empty column.
+            for (const VisibleTile& previous : previousTiles) {
+                if (previous.x == tileX && previous.key.levelIndex == key.levelIndex &&
+                    previous.key.pixelsPerSecondMilli == key.pixelsPerSecondMilli &&
+                    previous.key.height == key.height) {
+                    visible.tile = previous.tile;
+                    break;
+                }
+            }
+        }
+
+        m_visibleTiles.append(visible);
+    }
+
+    m_dirty |= TilesDirty;
+}
+
+void WaveformView::requestTile(const WaveformTileKey& key, qint64 tileX)
+{
+    if (m_pendingTiles.contains(key)) {
+        return;
+    }
+    const quint64 request = ++m_tileClock;
+    m_pendingTiles.insert(key, request);
+
+    const WaveformLevel level = m_currentLevel;
+    const qreal pixelsPerSecond = m_pixelsPerSecond;
+    const qreal tileHeight = key.height;
+    const bool software = m_softwareBackend;
+    const qreal devicePixelRatio = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+
+    auto* watcher = new QFutureWatcher<std::shared_ptr<const WaveformTile>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, key, request]() {
+        std::shared_ptr<const WaveformTile> tile = watcher->result();
+        watcher->deleteLater();
+        onTileReady(key, request, tile);
+        });
+
+    watcher->setFuture(QtConcurrent::run(&m_tilePool, [level, pixelsPerSecond, tileX, tileHeight, key, software, devicePixelRatio]() {
+        auto tile = std::make_shared<WaveformTile>();
+        buildTileShapes(level, pixelsPerSecond, tileX, kTileWidth, tileHeight,
+            key.highlightFirst, key.highlightLast, tile->shapes);
+        if (software) {
+            tile->image = rasterizeShapes(tile->shapes, QSizeF(kTileWidth + 1, tileHeight), devicePixelRatio);
+        }
+        return std::shared_ptr<const WaveformTile>(tile);
+        }));
+}
+
+void WaveformView::onTileReady(const WaveformTileKey& key, quint64 request, std::shared_ptr<const WaveformTile> tile)
+{
+    auto pending = m_pendingTiles.find(key);
+    if (pending == m_pendingTiles.end() || pending.value() != request) {
+        return;
+    }
+    m_pendingTiles.erase(pending);
+    if (key.epoch != m_tileEpoch || !tile) {
+        return;
+    }
+
+    while (m_tileCache.size() >= kMaxCachedTiles) {
+        auto oldest = m_tileCache.begin();
+        for (auto it = m_tileCache.begin(); it != m_tileCache.end(); ++it) {
+            if (it->lastUse < oldest->lastUse) {
+                oldest = it;
+            }
+        }
+        m_tileCache.erase(oldest);
+    }
+
+    TileCacheEntry entry;
+    entry.tile = tile;
+    entry.lastUse = ++m_tileClock;
+    m_tileCache.insert(key, entry);
+
+    bool visible = false;
+    for (VisibleTile& candidate : m_visibleTiles) {
+        if (candidate.key == key) {
+            candidate.tile = tile;
+            visible = true;
+        }
+    }
+
+    if (visible) {
+        invalidate(TilesDirty);
+    }
+}
+
+void WaveformView::clearTileCache()
+{
+    ++m_tileEpoch;
+    m_tileCache.clear();
+}
+
+// Drops cached and in-flight tiles overlapping [startMs, endMs), at whatever
+// zoom they were built for. A progressive load only ever touches the tail.
+void WaveformView::invalidateTiles(qint64 startMs, qint64 endMs)
+{
+    auto overlaps = [startMs, endMs](const WaveformTileKey& key) {
+        const qreal pixelsPerMs = key.pixelsPerSecondMilli / 1000000.0;
+        const qreal left = key.index * kTileWidth;
+        // Tiles are drawn one pixel wider to meet their neighbour; allow a
+        // pixel of rounding on both sides of the range as well.
+        const qreal right = left + kTileWidth + 1;
+        return startMs * pixelsPerMs - 1.0 < right && endMs * pixelsPerMs + 1.0 >= left;
+    };
+
+    for (auto it = m_tileCache.begin(); it != m_tileCache.end();) {
+        if (overlaps(it.key())) {
+            it = m_tileCache.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto it = m_pendingTiles.begin(); it != m_pendingTiles.end();) {
+        if (overlaps(it.key())) {
+            it = m_pendingTiles.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
 void WaveformView::updateCurrentLevel()
 {
-    if (!m_waveformGenerator || !m_waveformGenerator->isLoaded()) {
-        m_currentLevelCache.clear();
+    if (!m_waveformGenerator || m_waveformGenerator->getLevels().isEmpty()) {
+        m_currentLevel = WaveformLevel();
         m_currentLevelIndex = -1;
         return;
     }
 
     int newLevelIndex = m_waveformGenerator->findBestLevel(m_pixelsPerSecond);
 
-    if (newLevelIndex != m_currentLevelIndex || m_currentLevelCache.isEmpty()) {
+    if (newLevelIndex != m_currentLevelIndex || m_currentLevel.isEmpty()) {
         m_currentLevelIndex = newLevelIndex;
-        QVariantList levelData = m_waveformGenerator->getLevelData(newLevelIndex);
-        variantListToCache(levelData, m_currentLevelCache);
+        m_currentLevel = m_waveformGenerator->level(newLevelIndex);
     }
 }
 
-void WaveformView::variantListToCache(const QVariantList& data, QVector<MinMaxPair>& cache)
+QSGNode* WaveformView::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data)
 {
-    cache.clear();
-    cache.reserve(data.size() / 2);
-    for (int i = 0; i < data.size() - 1; i += 2) {
-        MinMaxPair pair;
-        pair.min = data[i].toFloat();
-        pair.max = data[i + 1].toFloat();
-        cache.append(pair);
+    Q_UNUSED(data);
+
+    auto* root = static_cast<WaveformRootNode*>(oldNode);
+    const QRectF bounds = boundingRect();
+
+    if (bounds.isEmpty()) {
+        delete root;
+        m_dirty = AllDirty;
+        return nullptr;
     }
-}
 
-void WaveformView::paint(QPainter* painter)
-{
-    painter->fillRect(boundingRect(), QColor(245, 245, 245));
-    painter->setRenderHint(QPainter::Antialiasing, true);
+    const bool software = window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software;
 
-    paintCenterLine(painter);
-    paintWaveform(painter);
-    paintTimeAxis(painter);
+    if (!root) {
+        root = new WaveformRootNode();
+        root->background = new QSGSimpleRectNode(bounds, QColor(245, 245, 245));
+        root->appendChildNode(root->background);
 
-    if (m_showSentenceHighlight) {
-        paintSentenceHighlights(painter);
+        root->tiles = new QSGNode();
+        root->appendChildNode(root->tiles);
+
+        root->highlights = new QSGNode();
+        root->appendChildNode(root->highlights);
+
+        root->overlay = window()->createImageNode();
+        root->appendChildNode(root->overlay);
+
+        root->playhead = new QSGSimpleRectNode(QRectF(), QColor(244, 67, 54));
+        root->appendChildNode(root->playhead);
+
+        m_dirty = AllDirty;
     }
 
-    if (m_enableBoundaryEdit) {
-        paintSentenceBoundaries(painter);
+    root->background->setRect(bounds);
+
+    if (m_dirty & (WaveformDirty | TilesDirty)) {
+        // Reuse the nodes of tiles that stay on screen and only move them.
+        QHash<const WaveformTile*, WaveformRootNode::TileNode> kept;
+        for (const VisibleTile& visible : m_visibleTiles) {
+            if (!visible.tile || kept.contains(visible.tile.get())) {
+                continue;
+            }
+
+            WaveformRootNode::TileNode entry;
+            auto it = root->tileNodes.find(visible.tile.get());
+            if (it != root->tileNodes.end()) {
+                entry = it.value();
+                root->tileNodes.erase(it);
+            }
+            else {
+                entry.tile = visible.tile;
+                entry.transform = new QSGTransformNode();
+                entry.transform->appendChildNode(createTileContent(window(), *visible.tile, visible.key.height, software));
+                root->tiles->appendChildNode(entry.transform);
+            }
+
+            QMatrix4x4 matrix;
+            matrix.translate(static_cast<float>(visible.x - m_scrollPosition), 0.0f);
+            entry.transform->setMatrix(matrix);
+            kept.insert(visible.tile.get(), entry);
+        }
+
+        for (const WaveformRootNode::TileNode& stale : std::as_const(root->tileNodes)) {
+            root->tiles->removeChildNode(stale.transform);
+            delete stale.transform;
+        }
+        root->tileNodes = kept;
     }
 
-    paintPlayhead(painter);
+    if (m_dirty & HighlightsDirty) {
+        updateHighlightNodes(root->highlights);
+    }
+
+    if (m_dirty & OverlayDirty) {
+        replaceTexture(root->overlay, window()->createTextureFromImage(renderOverlay()));
+        root->overlay->setRect(bounds);
+    }
+
+    m_dirty = 0;
+
+    // Playback only moves this node; everything above is reused as is.
+    const qreal x = playheadX();
+    root->playhead->setRect(x < 0 ? QRectF() : QRectF(x - 1.0, 0.0, 2.0, bounds.height()));
+
+    return root;
+}
+
+QImage WaveformView::renderOverlay()
+{
+    QImage image = createLayerImage(size(), window() ? window()->effectiveDevicePixelRatio() : 1.0);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    paintCenterLine(&painter);
+    paintTimeAxis(&painter);
+
+    if (m_enableBoundaryEdit) {
+        paintSentenceBoundaries(&painter);
+    }
 
     if (m_hoveredTimeMs >= 0) {
-        paintHoverInfo(painter);
+        paintHoverInfo(&painter);
     }
 
     if (m_showPerformance) {
-        paintPerformanceInfo(painter);
+        paintPerformanceInfo(&painter);
     }
+
+    return image;
 }
 
 void WaveformView::paintBoundaryHandle(QPainter* painter, qreal x, bool isStart, bool isHovered)
@@ -917,14 +1468,22 @@ void WaveformView::paintSentenceBoundaries(QPainter* painter)
     painter->restore();
 }
 
-void WaveformView::paintSentenceHighlights(QPainter* painter)
+void WaveformView::updateHighlightNodes(QSGNode* parent)
 {
-    if (m_sentences.isEmpty() || !m_waveformGenerator)
+    while (QSGNode* child = parent->firstChild()) {
+        parent->removeChildNode(child);
+        delete child;
+    }
+
+    if (!m_showSentenceHighlight || m_sentences.isEmpty() || !m_waveformGenerator)
         return;
 
-    painter->save();
+    int first = 0;
+    int last = 0;
+    m_sentenceIndex.range(pixelToTime(m_scrollPosition) - 1, pixelToTime(m_scrollPosition + width()) + 1, first, last);
 
-    for (int i = 0; i < m_sentences.size(); ++i) {
+    for (int position = first; position < last; ++position) {
+        const int i = m_sentenceIndex.indexAt(position);
         const SentenceSegment& seg = m_sentences[i];
 
         qreal startPixel = timeToPixel(seg.startTimeMs) - m_scrollPosition;
@@ -934,243 +1493,18 @@ void WaveformView::paintSentenceHighlights(QPainter* painter)
         if (endPixel < 0 || startPixel > width())
             continue;
 
-        QColor bgColor;
-        if (i == m_currentSentenceIndex) {
-            bgColor = QColor(0, 0, 0, 0);
-        }
-        else if (i == m_hoveredSentenceIndex) {
-            bgColor = QColor(100, 181, 246, 60);
-        }
-        else {
-            bgColor = QColor(200, 200, 200, 30);
-        }
-
         QRectF rect(startPixel, 0, segWidth, height());
 
-        if (i != m_currentSentenceIndex) {
-            painter->fillRect(rect, bgColor);
-        }
-
         if (i == m_currentSentenceIndex) {
-            QPen borderPen(QColor(255, 152, 0), 2.0);
-            painter->setPen(borderPen);
-            painter->drawRect(rect);
+            appendBorder(parent, rect, QColor(255, 152, 0), 2.0);
         }
         else if (i == m_hoveredSentenceIndex) {
-            QPen borderPen(QColor(33, 150, 243), 1.5);
-            painter->setPen(borderPen);
-            painter->drawRect(rect);
-        }
-    }
-
-    painter->restore();
-}
-
-void WaveformView::paintWaveform(QPainter* painter, const QSizeF& size)
-{
-    if (m_currentLevelCache.isEmpty() || m_contentWidth <= 0 || !m_waveformGenerator) {
-        return;
-    }
-
-    const qreal viewW = size.isEmpty() ? width() : size.width();
-    const qreal viewH = size.isEmpty() ? height() : size.height();
-    const qreal centerY = viewH * 0.5;
-    const qreal amp = viewH * 0.48;
-
-    const QVector<WaveformLevel>& levels = m_waveformGenerator->getLevels();
-    if (m_currentLevelIndex < 0 || m_currentLevelIndex >= levels.size()) {
-        return;
-    }
-
-    const WaveformLevel& currentLevel = levels[m_currentLevelIndex];
-    const qreal pixelsPerDataPoint = m_pixelsPerSecond / currentLevel.pixelsPerSecond;
-
-    if (pixelsPerDataPoint >= 4.0) {
-        paintWaveformSampleLevel(painter, viewW, viewH, centerY, amp, pixelsPerDataPoint);
-    }
-    else if (pixelsPerDataPoint >= 0.8) {
-        paintWaveformPeakLines(painter, viewW, viewH, centerY, amp, pixelsPerDataPoint);
-    }
-    else {
-        paintWaveformDense(painter, viewW, viewH, centerY, amp, pixelsPerDataPoint);
-    }
-}
-
-void WaveformView::paintWaveformSampleLevel(QPainter* painter, qreal viewW, qreal viewH,
-    qreal centerY, qreal amp, qreal pixelsPerDataPoint)
-{
-    painter->setRenderHint(QPainter::Antialiasing, false);
-
-    qreal currentSentenceStartPixel = -1;
-    qreal currentSentenceEndPixel = -1;
-    if (m_currentSentenceIndex >= 0 && m_currentSentenceIndex < m_sentences.size()) {
-        const SentenceSegment& seg = m_sentences[m_currentSentenceIndex];
-        currentSentenceStartPixel = timeToPixel(seg.startTimeMs) - m_scrollPosition;
-        currentSentenceEndPixel = timeToPixel(seg.endTimeMs) - m_scrollPosition;
-    }
-
-    int startPixel = qMax(0, int(0));
-    int endPixel = qMin(int(viewW) + 1, int(viewW) + 1);
-
-    QVector<QPointF> samplePoints;
-    QVector<bool> isCurrentSentencePoints;
-    samplePoints.reserve(endPixel - startPixel);
-    isCurrentSentencePoints.reserve(endPixel - startPixel);
-
-    for (int pixelX = startPixel; pixelX < endPixel; ++pixelX) {
-        qreal globalPixelPos = m_scrollPosition + pixelX;
-        qreal dataIndex = globalPixelPos / pixelsPerDataPoint;
-
-        int idx = qRound(dataIndex);
-        if (idx < 0 || idx >= m_currentLevelCache.size())
-            continue;
-
-        float sampleValue = m_currentLevelCache[idx].max;
-        qreal y = centerY - sampleValue * amp;
-
-        samplePoints.append(QPointF(pixelX, y));
-
-        bool isInCurrentSentence = (pixelX >= currentSentenceStartPixel &&
-            pixelX <= currentSentenceEndPixel);
-        isCurrentSentencePoints.append(isInCurrentSentence);
-    }
-
-    for (int i = 0; i < samplePoints.size(); ++i) {
-        QColor pointColor = isCurrentSentencePoints[i] ?
-            QColor(244, 67, 54) :
-            QColor(30, 50, 100);
-        painter->setBrush(pointColor);
-        painter->setPen(Qt::NoPen);
-        painter->drawEllipse(samplePoints[i], 2, 2);
-    }
-
-    if (samplePoints.size() > 1) {
-        for (int i = 0; i < samplePoints.size() - 1; ++i) {
-            QColor lineColor = (isCurrentSentencePoints[i] || isCurrentSentencePoints[i + 1]) ?
-                QColor(244, 67, 54, 180) :
-                QColor(30, 50, 100, 180);
-            QPen linePen(lineColor, 0.8);
-            painter->setPen(linePen);
-            painter->drawLine(samplePoints[i], samplePoints[i + 1]);
-        }
-    }
-}
-
-void WaveformView::paintWaveformPeakLines(QPainter* painter, qreal viewW, qreal viewH,
-    qreal centerY, qreal amp, qreal pixelsPerDataPoint)
-{
-    painter->setRenderHint(QPainter::Antialiasing, false);
-
-    int startPixel = qMax(0, int(0));
-    int endPixel = qMin(int(viewW) + 1, int(viewW) + 1);
-
-    qreal currentSentenceStartPixel = -1;
-    qreal currentSentenceEndPixel = -1;
-    if (m_currentSentenceIndex >= 0 && m_currentSentenceIndex < m_sentences.size()) {
-        const SentenceSegment& seg = m_sentences[m_currentSentenceIndex];
-        currentSentenceStartPixel = timeToPixel(seg.startTimeMs) - m_scrollPosition;
-        currentSentenceEndPixel = timeToPixel(seg.endTimeMs) - m_scrollPosition;
-    }
-
-    for (int pixelX = startPixel; pixelX < endPixel; ++pixelX) {
-        qreal globalPixelPos = m_scrollPosition + pixelX;
-        qreal dataIndexStart = globalPixelPos / pixelsPerDataPoint;
-        qreal dataIndexEnd = (globalPixelPos + 1.0) / pixelsPerDataPoint;
-
-        int idxStart = qFloor(dataIndexStart);
-        int idxEnd = qCeil(dataIndexEnd);
-
-        idxStart = qMax(0, idxStart);
-        idxEnd = qMin(m_currentLevelCache.size(), idxEnd);
-
-        if (idxStart >= idxEnd || idxStart >= m_currentLevelCache.size())
-            continue;
-
-        float columnMin = m_currentLevelCache[idxStart].min;
-        float columnMax = m_currentLevelCache[idxStart].max;
-
-        for (int dataIdx = idxStart + 1; dataIdx < idxEnd; ++dataIdx) {
-            if (dataIdx >= m_currentLevelCache.size()) break;
-            float minVal = m_currentLevelCache[dataIdx].min;
-            float maxVal = m_currentLevelCache[dataIdx].max;
-            if (minVal < columnMin) columnMin = minVal;
-            if (maxVal > columnMax) columnMax = maxVal;
+            parent->appendChildNode(new QSGSimpleRectNode(rect, QColor(100, 181, 246, 60)));
+            appendBorder(parent, rect, QColor(33, 150, 243), 1.5);
         }
-
-        qreal yMax = centerY - columnMax * amp;
-        qreal yMin = centerY - columnMin * amp;
-
-        bool isInCurrentSentence = (pixelX >= currentSentenceStartPixel &&
-            pixelX <= currentSentenceEndPixel);
-
-        QColor waveColor = isInCurrentSentence ?
-            QColor(244, 67, 54) :
-            QColor(33, 66, 133);
-
-        QPen linePen(waveColor, 1.0);
-        linePen.setCapStyle(Qt::FlatCap);
-        painter->setPen(linePen);
-
-        painter->drawLine(QPointF(pixelX, yMax), QPointF(pixelX, yMin));
-    }
-}
-
-void WaveformView::paintWaveformDense(QPainter* painter, qreal viewW, qreal viewH,
-    qreal centerY, qreal amp, qreal pixelsPerDataPoint)
-{
-    painter->setRenderHint(QPainter::Antialiasing, false);
-
-    int startPixel = qMax(0, int(0));
-    int endPixel = qMin(int(viewW) + 1, int(viewW) + 1);
-
-    qreal currentSentenceStartPixel = -1;
-    qreal currentSentenceEndPixel = -1;
-    if (m_currentSentenceIndex >= 0 && m_currentSentenceIndex < m_sentences.size()) {
-        const SentenceSegment& seg = m_sentences[m_currentSentenceIndex];
-        currentSentenceStartPixel = timeToPixel(seg.startTimeMs) - m_scrollPosition;
-        currentSentenceEndPixel = timeToPixel(seg.endTimeMs) - m_scrollPosition;
-    }
-
-    for (int pixelX = startPixel; pixelX < endPixel; ++pixelX) {
-        qreal globalPixelPos = m_scrollPosition + pixelX;
-        qreal dataIndexStart = globalPixelPos / pixelsPerDataPoint;
-        qreal dataIndexEnd = (globalPixelPos + 1.0) / pixelsPerDataPoint;
-
-        int idxStart = qFloor(dataIndexStart);
-        int idxEnd = qCeil(dataIndexEnd);
-
-        idxStart = qMax(0, idxStart);
-        idxEnd = qMin(m_currentLevelCache.size(), idxEnd);
-
-        if (idxStart >= idxEnd || idxStart >= m_currentLevelCache.size())
-            continue;
-
-        float columnMin = m_currentLevelCache[idxStart].min;
-        float columnMax = m_currentLevelCache[idxStart].max;
-
-        for (int dataIdx = idxStart + 1; dataIdx < idxEnd; ++dataIdx) {
-            if (dataIdx >= m_currentLevelCache.size()) break;
-            float minVal = m_currentLevelCache[dataIdx].min;
-            float maxVal = m_currentLevelCache[dataIdx].max;
-            if (minVal < columnMin) columnMin = minVal;
-            if (maxVal > columnMax) columnMax = maxVal;
+        else {
+            parent->appendChildNode(new QSGSimpleRectNode(rect, QColor(200, 200, 200, 30)));
         }
-
-        qreal yMax = centerY - columnMax * amp;
-        qreal yMin = centerY - columnMin * amp;
-
-        bool isInCurrentSentence = (pixelX >= currentSentenceStartPixel &&
-            pixelX <= currentSentenceEndPixel);
-
-        QColor waveColor = isInCurrentSentence ?
-            QColor(244, 67, 54) :
-            QColor(33, 66, 133);
-
-        QPen linePen(waveColor, 1.0);
-        linePen.setCapStyle(Qt::FlatCap);
-        painter->setPen(linePen);
-
-        painter->drawLine(QPointF(pixelX, yMax), QPointF(pixelX, yMin));
     }
 }
 
@@ -1186,10 +1520,10 @@ void WaveformView::paintCenterLine(QPainter* painter, const QSizeF& size)
     painter->drawLine(QPointF(0, centerY), QPointF(viewW, centerY));
 }
 
-void WaveformView::paintPlayhead(QPainter* painter)
+qreal WaveformView::playheadX() const
 {
     if (!m_waveformGenerator || m_waveformGenerator->duration() <= 0)
-        return;
+        return -1;
 
     int playheadX = m_playheadXInPage + 2;
 
@@ -1205,18 +1539,10 @@ void WaveformView::paintPlayhead(QPainter* painter)
     }
 
     if (playheadX < 2 || (playheadX > viewWidth - 2 && !isAtEnd)) {
-        return;
+        return -1;
     }
 
-    painter->setRenderHint(QPainter::Antialiasing, true);
-
-    QPen mainPen(QColor(244, 67, 54), 2);
-    mainPen.setCapStyle(Qt::RoundCap);
-    painter->setPen(mainPen);
-    painter->drawLine(QPointF(playheadX, 0), QPointF(playheadX, height()));
-
-    painter->setBrush(QColor(244, 67, 54));
-    painter->setPen(Qt::NoPen);
+    return playheadX;
 }
 
 void WaveformView::paintHoverInfo(QPainter* painter)
@@ -1425,7 +1751,7 @@ void WaveformView::paintPerformanceInfo(QPainter* painter)
         .arg(totalMinutes, 2, 10, QChar('0'))
         .arg(totalSecs, 2, 10, QChar('0'));
 
-    QString info = QString("PPS: %1 | Level: %2 | PlayheadX: %3 | PageStart: %4s | Time: %5/%6 | Scroll: %7 | Sentence: %8/%9")
+    QString info = QString("PPS: %1 | Level: %2 | PlayheadX: %3 | PageStart: %4s | Time: %5/%6 | Scroll: %7 | Sentence: %8/%9 | Tiles: %10 hit / %11 miss / %12 cached")
         .arg(m_pixelsPerSecond, 0, 'f', 1)
         .arg(m_currentLevelIndex)
         .arg(m_playheadXInPage)
@@ -1434,7 +1760,10 @@ void WaveformView::paintPerformanceInfo(QPainter* painter)
         .arg(totalTime)
         .arg(m_scrollPosition, 0, 'f', 0)
         .arg(m_currentSentenceIndex + 1)
-        .arg(m_sentences.size());
+        .arg(m_sentences.size())
+        .arg(m_tileHits)
+        .arg(m_tileMisses)
+        .arg(m_tileCache.size());
 
     painter->setPen(QColor(244, 67, 54));
     painter->setFont(QFont("monospace", 9, QFont::Bold));
@@ -1,19 +1,76 @@
 ﻿#ifndef WAVEFORMVIEW_H
 #define WAVEFORMVIEW_H
 
-#include <QQuickPaintedItem>
+#include <QQuickItem>
 #include <QPainter>
-#include <QPixmap>
+#include <QImage>
+#include <QColor>
+#include <QLineF>
+#include <QRectF>
 #include <QVariantList>
 #include <QVector>
 #include <QElapsedTimer>
 #include <QWheelEvent>
 #include <QMouseEvent>
 #include <QHoverEvent>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <memory>
 #include "waveformgenerator.h"
 #include "ffmpegaudioengine.h"
 
-class WaveformView : public QQuickPaintedItem
+// Primitives for a stretch of waveform: filled bars for
+// peak columns and sample dots, line segments joining individual samples.
+struct WaveformShapes {
+    struct Bar {
+        QRectF rect;
+        QColor color;
+    };
+    struct Segment {
+        QLineF line;
+        QColor color;
+    };
+
+    QVector<Bar> bars;
+    QVector<Segment> segments;
+};
+
+// A fixed-width strip of the waveform at one zoom and height, in
+// tile-local coordinates. `image` is only filled for the software backend.
+struct WaveformTile {
+    WaveformShapes shapes;
+    QImage image;
+};
+
+// Everything a tile's content depends on. The highlight range is the
+// current sentence clipped to the tile (local pixels, -1 when absent), so a
+// sentence change only misses the tiles it touches.
+struct WaveformTileKey {
+    int epoch;
+    int levelIndex;
+    qint64 pixelsPerSecondMilli;
+    int height;
+    qint64 index;
+    int highlightFirst;
+    int highlightLast;
+
+    bool operator==(const WaveformTileKey& other) const
+    {
+        return epoch == other.epoch && levelIndex == other.levelIndex &&
+            pixelsPerSecondMilli == other.pixelsPerSecondMilli && height == other.height &&
+            index == other.index && highlightFirst == other.highlightFirst &&
+            highlightLast == other.highlightLast;
+    }
+};
+
+inline size_t qHash(const WaveformTileKey& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.epoch, key.levelIndex, key.pixelsPerSecondMilli, key.height,
+        key.index, key.highlightFirst, key.highlightLast);
+}
+
+class WaveformView : public QQuickItem
 {
     Q_OBJECT
 
@@ -95,7 +152,8 @@ signals:
     void boundaryDragEnded();
 
 protected:
-    void paint(QPainter* painter) override;
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+    void updatePolish() override;
     void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
     void wheelEvent(QWheelEvent* event) override;
     void mousePressEvent(QMouseEvent* event) override;
@@ -106,8 +164,28 @@ protected:
 
 private slots:
     void onLevelsChanged();
+    void onLevelsRangeUpdated(qint64 startMs, qint64 endMs);
 
 private:
+    enum DirtyFlag {
+        WaveformDirty = 0x1,
+        HighlightsDirty = 0x2,
+        OverlayDirty = 0x4,
+        TilesDirty = 0x8,
+        AllDirty = WaveformDirty | HighlightsDirty | OverlayDirty
+    };
+
+    struct VisibleTile {
+        WaveformTileKey key;
+        qint64 x;
+        std::shared_ptr<const WaveformTile> tile;
+    };
+
+    struct TileCacheEntry {
+        std::shared_ptr<const WaveformTile> tile;
+        quint64 lastUse;
+    };
+
     enum class DragMode {
         None,
         StartBoundary,
@@ -115,7 +193,8 @@ private:
     };
 
     WaveformGenerator* m_waveformGenerator;
-    QVector<MinMaxPair> m_currentLevelCache;
+    // Shares the generator's packed data; never copied or converted.
+    WaveformLevel m_currentLevel;
 
     qreal m_currentPosition;
     qreal m_pixelsPerSecond;
@@ -139,6 +218,7 @@ private:
     int m_currentLevelIndex;
 
     QVector<SentenceSegment> m_sentences;
+    SentenceIndex m_sentenceIndex;
     int m_currentSentenceIndex;
     int m_hoveredSentenceIndex;
     bool m_showSentenceHighlight;
@@ -153,26 +233,42 @@ private:
     const qreal m_boundaryHandleRadius = 8.0;
     const qreal m_boundaryHitRadius = 12.0;
 
+    // Scene graph parts to rebuild on the next updatePaintNode; the playhead
+    // node is repositioned on every update.
+    int m_dirty;
+
+    // Waveform tiles rendered on m_tilePool; updatePolish() picks the ones
+    // covering the viewport and updatePaintNode() only repositions them.
+    QHash<WaveformTileKey, TileCacheEntry> m_tileCache;
+    // In-flight requests, stamped from m_tileClock so a request dropped by
+    // invalidateTiles() is not cached when it completes.
+    QHash<WaveformTileKey, quint64> m_pendingTiles;
+    QVector<VisibleTile> m_visibleTiles;
+    QThreadPool m_tilePool;
+    int m_tileEpoch;
+    quint64 m_tileClock;
+    qint64 m_tileHits;
+    qint64 m_tileMisses;
+    bool m_softwareBackend;
+
+    void invalidate(int flags);
     void updateCurrentLevel();
-    void variantListToCache(const QVariantList& data, QVector<MinMaxPair>& cache);
 
-    void paintWaveform(QPainter* painter, const QSizeF& size = QSizeF());
-    void paintSentenceHighlights(QPainter* painter);
+    void requestTile(const WaveformTileKey& key, qint64 tileX);
+    void onTileReady(const WaveformTileKey& key, quint64 request, std::shared_ptr<const WaveformTile> tile);
+    void clearTileCache();
+    void invalidateTiles(qint64 startMs, qint64 endMs);
+    void updateHighlightNodes(QSGNode* parent);
+    QImage renderOverlay();
+    qreal playheadX() const;
+
     void paintSentenceBoundaries(QPainter* painter);
-    void paintPlayhead(QPainter* painter);
     void paintCenterLine(QPainter* painter, const QSizeF& size = QSizeF());
     void paintTimeAxis(QPainter* painter);
     void paintPerformanceInfo(QPainter* painter);
     void paintHoverInfo(QPainter* painter);
     void paintBoundaryHandle(QPainter* painter, qreal x, bool isStart, bool isHovered);
 
-    void paintWaveformSampleLevel(QPainter* painter, qreal viewW, qreal viewH,
-        qreal centerY, qreal amp, qreal pixelsPerDataPoint);
-    void paintWaveformPeakLines(QPainter* painter, qreal viewW, qreal viewH,
-        qreal centerY, qreal amp, qreal pixelsPerDataPoint);
-    void paintWaveformDense(QPainter* painter, qreal viewW, qreal viewH,
-        qreal centerY, qreal amp, qreal pixelsPerDataPoint);
-
     void updateContentWidth();
     void updateCurrentSentence();
     qreal timeToPixel(qint64 timeMs) const;
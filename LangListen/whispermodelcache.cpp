@@ -0,0 +1,120 @@
+﻿#include "whispermodelcache.h"
+#include <QFileInfo>
+#include <QElapsedTimer>
+
+WhisperModelCache& WhisperModelCache::instance()
+{
+    static WhisperModelCache cache;
+    return cache;
+}
+
+WhisperModelCache::WhisperModelCache()
+    : m_capacity(2)
+{
+}
+
+std::shared_ptr<whisper_context> WhisperModelCache::acquire(const QString& modelPath, bool useGpu, bool* cacheHit)
+{
+    QFileInfo fileInfo(modelPath);
+    QString key = fileInfo.canonicalFilePath().isEmpty() ? modelPath : fileInfo.canonicalFilePath();
+    QDateTime modified = fileInfo.lastModified();
+
+    if (cacheHit) {
+        *cacheHit = false;
+    }
+
+    // Loading happens under the lock so that two callers asking for the same
+    // model never read it from disk twice.
+    QMutexLocker locker(&m_mutex);
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->modelPath == key && it->useGpu == useGpu) {
+            if (it->modified != modified) {
+                m_entries.erase(it);
+                break;
+            }
+            m_entries.splice(m_entries.begin(), m_entries, it);
+            m_stats.hits++;
+            if (cacheHit) {
+                *cacheHit = true;
+            }
+            return m_entries.front().context;
+        }
+    }
+
+    // A GPU init that failed once (e.g. CUDA mismatch) fails again; do not pay
+    // for it on every request until the model file changes.
+    for (auto it = m_failures.begin(); it != m_failures.end(); ++it) {
+        if (it->modelPath == key && it->useGpu == useGpu) {
+            if (it->modified == modified) {
+                return nullptr;
+            }
+            m_failures.erase(it);
+            break;
+        }
+    }
+
+    m_stats.misses++;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    struct whisper_context_params cparams = whisper_context_default_params();
+    cparams.use_gpu = useGpu;
+
+    struct whisper_context* ctx = whisper_init_from_file_with_params(
+        modelPath.toUtf8().constData(), cparams);
+
+    m_stats.lastLoadMs = timer.elapsed();
+    m_stats.totalLoadMs += m_stats.lastLoadMs;
+
+    Entry entry;
+    entry.modelPath = key;
+    entry.useGpu = useGpu;
+    entry.modified = modified;
+
+    if (!ctx) {
+        m_stats.loadFailures++;
+        m_failures.push_back(entry);
+        return nullptr;
+    }
+
+    entry.context = std::shared_ptr<whisper_context>(ctx, whisper_free);
+    m_entries.push_front(entry);
+    evictLocked();
+
+    return entry.context;
+}
+
+void WhisperModelCache::setCapacity(int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+    m_capacity = qMax(1, capacity);
+    evictLocked();
+}
+
+int WhisperModelCache::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_capacity;
+}
+
+void WhisperModelCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_failures.clear();
+}
+
+WhisperModelCache::Stats WhisperModelCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void WhisperModelCache::evictLocked()
+{
+    while (static_cast<int>(m_entries.size()) > m_capacity) {
+        m_entries.pop_back();
+    }
+}
@@ -0,0 +1,66 @@
+﻿#ifndef WHISPERMODELCACHE_H
+#define WHISPERMODELCACHE_H
+
+#include <QString>
+#include <QDateTime>
+#include <QMutex>
+#include <list>
+#include <memory>
+
+extern "C" {
+#include "whisper.h"
+}
+
+// Process-wide LRU of loaded whisper contexts keyed by model path and compute
+// mode. A context stays alive while any holder keeps its shared_ptr, even after
+// eviction. whisper_full on the context's default state is not reentrant, so
+// concurrent users must run on their own whisper_state.
+class WhisperModelCache
+{
+public:
+    struct Stats {
+        int hits;
+        int misses;
+        int loadFailures;
+        qint64 lastLoadMs;
+        qint64 totalLoadMs;
+
+        Stats()
+            : hits(0)
+            , misses(0)
+            , loadFailures(0)
+            , lastLoadMs(0)
+            , totalLoadMs(0)
+        {
+        }
+    };
+
+    static WhisperModelCache& instance();
+
+    std::shared_ptr<whisper_context> acquire(const QString& modelPath, bool useGpu, bool* cacheHit = nullptr);
+
+    void setCapacity(int capacity);
+    int capacity() const;
+    void clear();
+    Stats stats() const;
+
+private:
+    WhisperModelCache();
+
+    struct Entry {
+        QString modelPath;
+        bool useGpu;
+        QDateTime modified;
+        std::shared_ptr<whisper_context> context;
+    };
+
+    void evictLocked();
+
+    mutable QMutex m_mutex;
+    std::list<Entry> m_entries;
+    std::list<Entry> m_failures;
+    int m_capacity;
+    Stats m_stats;
+};
+
+#endif
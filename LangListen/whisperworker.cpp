@@ -4,9 +4,21 @@
 #include <QLibrary>
 #include <QProcess>
 #include <QDir>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
 #include <cstring>
 #include <fstream>
 #include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <thread>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
 
 #ifdef _WIN32
 #include <windows.h>
@@ -16,14 +28,350 @@
 #pragma comment(lib, "setupapi.lib")
 #endif
 
+namespace {
+
+const int kWhisperSampleRate = 16000;
+
+qint64 steadyNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct AudioWindow {
+    qint64 startSample = 0;
+    std::vector<float> samples;
+    bool isLast = false;
+};
+
+// Bounded hand-off between the decode/resample thread and inference. close()
+// releases both sides: the producer stops pushing and the consumer drains.
+class AudioWindowQueue
+{
+public:
+    explicit AudioWindowQueue(int capacity)
+        : m_capacity(qMax(1, capacity))
+        , m_closed(false)
+    {
+    }
+
+    bool push(AudioWindow&& window)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_closed && static_cast<int>(m_windows.size()) >= m_capacity) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed) {
+            return false;
+        }
+        m_windows.push_back(std::move(window));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(AudioWindow& window)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_windows.empty() && !m_closed) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        if (m_windows.empty()) {
+            return false;
+        }
+        window = std::move(m_windows.front());
+        m_windows.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void close()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notFull.wakeAll();
+        m_notEmpty.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+    std::deque<AudioWindow> m_windows;
+    int m_capacity;
+    bool m_closed;
+};
+
+// Cuts the 16 kHz stream into overlapping windows. One window is held back so
+// the final one can be flagged isLast before it reaches the queue.
+class AudioWindowBuilder
+{
+public:
+    AudioWindowBuilder(AudioWindowQueue& queue, int windowSamples, int overlapSamples)
+        : m_queue(queue)
+        , m_windowSamples(windowSamples)
+        , m_overlapSamples(overlapSamples)
+        , m_bufferStart(0)
+        , m_totalSamples(0)
+        , m_hasPending(false)
+    {
+        m_buffer.reserve(static_cast<size_t>(windowSamples));
+    }
+
+    bool append(const float* data, int count)
+    {
+        m_buffer.insert(m_buffer.end(), data, data + count);
+        m_totalSamples += count;
+
+        while (static_cast<int>(m_buffer.size()) >= m_windowSamples) {
+            AudioWindow window;
+            window.startSample = m_bufferStart;
+            window.samples.assign(m_buffer.begin(), m_buffer.begin() + m_windowSamples);
+            if (!pushPending(std::move(window))) {
+                return false;
+            }
+
+            int step = m_windowSamples - m_overlapSamples;
+            m_buffer.erase(m_buffer.begin(), m_buffer.begin() + step);
+            m_bufferStart += step;
+        }
+        return true;
+    }
+
+    bool finish()
+    {
+        if (!m_buffer.empty() && (!m_hasPending || static_cast<int>(m_buffer.size()) > m_overlapSamples)) {
+            AudioWindow window;
+            window.startSample = m_bufferStart;
+            window.samples.swap(m_buffer);
+            if (!pushPending(std::move(window))) {
+                return false;
+            }
+        }
+
+        if (!m_hasPending) {
+            return true;
+        }
+
+        m_pending.isLast = true;
+        m_hasPending = false;
+        return m_queue.push(std::move(m_pending));
+    }
+
+    qint64 totalSamples() const { return m_totalSamples; }
+
+private:
+    bool pushPending(AudioWindow&& window)
+    {
+        bool ok = true;
+        if (m_hasPending) {
+            ok = m_queue.push(std::move(m_pending));
+        }
+        m_pending = std::move(window);
+        m_hasPending = true;
+        return ok;
+    }
+
+    AudioWindowQueue& m_queue;
+    int m_windowSamples;
+    int m_overlapSamples;
+    std::vector<float> m_buffer;
+    qint64 m_bufferStart;
+    qint64 m_totalSamples;
+    AudioWindow m_pending;
+    bool m_hasPending;
+};
+
+class StreamResampler
+{
+public:
+    StreamResampler()
+        : m_swr(nullptr)
+    {
+    }
+
+    ~StreamResampler()
+    {
+        swr_free(&m_swr);
+    }
+
+    bool init(int inputRate, int outputRate)
+    {
+        if (inputRate == outputRate) {
+            return true;
+        }
+
+        AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+        int ret = swr_alloc_set_opts2(&m_swr,
+            &mono, AV_SAMPLE_FMT_FLT, outputRate,
+            &mono, AV_SAMPLE_FMT_FLT, inputRate,
+            0, nullptr);
+        return ret >= 0 && swr_init(m_swr) >= 0;
+    }
+
+    // Passing null input flushes the resampler's delay line.
+    const float* process(const float* input, int count, int& outCount)
+    {
+        if (!m_swr) {
+            outCount = input ? count : 0;
+            return input;
+        }
+
+        int capacity = swr_get_out_samples(m_swr, count);
+        m_output.resize(static_cast<size_t>(qMax(capacity, 0)));
+
+        uint8_t* out = reinterpret_cast<uint8_t*>(m_output.data());
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(input);
+        outCount = swr_convert(m_swr, &out, capacity, input ? &in : nullptr, input ? count : 0);
+        return m_output.data();
+    }
+
+private:
+    SwrContext* m_swr;
+    std::vector<float> m_output;
+};
+
+// Takes the decode lease by value: dropping it on cancel stops the shared
+// decode too, unless the waveform still holds a lease on the same file.
+bool streamDecodedAudio(std::shared_ptr<DecodedAudio> decoded, AudioWindowBuilder& builder,
+    std::atomic<qint64>& expectedDurationMs, const std::atomic<bool>& cancelled, QString& error)
+{
+    while (!decoded->waitForSamples(1, 200)) {
+        if (cancelled) {
+            decoded.reset();
+            error = "Cancelled";
+            return false;
+        }
+        if (decoded->isFinished()) {
+            break;
+        }
+    }
+
+    if (decoded->isFinished() && !decoded->isValid()) {
+        error = "Audio decoding failed: " + decoded->errorString();
+        return false;
+    }
+
+    StreamResampler resampler;
+    if (!resampler.init(decoded->sampleRate(), kWhisperSampleRate)) {
+        error = "Failed to initialize streaming resampler";
+        return false;
+    }
+
+    std::vector<float> chunk(1 << 15);
+    qint64 offset = 0;
+    int outCount = 0;
+
+    while (true) {
+        if (cancelled) {
+            decoded.reset();
+            error = "Cancelled";
+            return false;
+        }
+
+        expectedDurationMs = decoded->expectedDurationMs();
+
+        bool finished = decoded->isFinished();
+        qint64 got = decoded->read(offset, chunk.data(), static_cast<qint64>(chunk.size()));
+        if (got > 0) {
+            offset += got;
+            const float* out = resampler.process(chunk.data(), static_cast<int>(got), outCount);
+            if (outCount > 0 && !builder.append(out, outCount)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (finished) {
+            break;
+        }
+        decoded->waitForSamples(offset + 1, 200);
+    }
+
+    if (!decoded->isValid()) {
+        error = "Audio decoding failed: " + decoded->errorString();
+        return false;
+    }
+
+    const float* out = resampler.process(nullptr, 0, outCount);
+    if (outCount > 0 && !builder.append(out, outCount)) {
+        return false;
+    }
+    return true;
+}
+
+struct TranscribedSegment {
+    int64_t t0;
+    int64_t t1;
+    QString text;
+};
+
+// Splits near the evenly spaced targets, moving each cut to the quietest
+// 20 ms frame within +-10 s so that no word is cut in half.
+std::vector<std::pair<size_t, size_t>> splitAtSilence(const std::vector<float>& audio, size_t begin, int chunkCount)
+{
+    const size_t frame = kWhisperSampleRate / 50;
+    const size_t searchRadius = static_cast<size_t>(kWhisperSampleRate) * 10;
+
+    std::vector<std::pair<size_t, size_t>> chunks;
+    size_t start = begin;
+
+    for (int k = 1; k < chunkCount; ++k) {
+        size_t target = begin + (audio.size() - begin) * k / chunkCount;
+        size_t lo = qMax(start + frame, target > searchRadius ? target - searchRadius : 0);
+        size_t hi = qMin(audio.size(), target + searchRadius);
+
+        size_t best = target;
+        float bestEnergy = std::numeric_limits<float>::max();
+        for (size_t pos = lo; pos + frame <= hi; pos += frame) {
+            float energy = 0.0f;
+            for (size_t j = pos; j < pos + frame; ++j) {
+                energy += audio[j] * audio[j];
+            }
+            if (energy < bestEnergy) {
+                bestEnergy = energy;
+                best = pos + frame / 2;
+            }
+        }
+
+        if (best <= start || best >= audio.size()) {
+            continue;
+        }
+        chunks.emplace_back(start, best - start);
+        start = best;
+    }
+
+    chunks.emplace_back(start, audio.size() - start);
+    return chunks;
+}
+
+QString formatSegment(int64_t t0, int64_t t1, const QString& text)
+{
+    return QString("[%1 -> %2] ")
+        .arg(t0 / 100.0, 0, 'f', 2)
+        .arg(t1 / 100.0, 0, 'f', 2) + text + "\n";
+}
+
+}
+
+QMutex WhisperWorker::s_capabilitiesMutex;
+bool WhisperWorker::s_capabilitiesDetected = false;
+SystemCapabilities WhisperWorker::s_capabilities;
+
 WhisperWorker::WhisperWorker(QObject* parent)
     : QObject(parent)
     , m_ctx(nullptr)
+    , m_state(nullptr)
     , m_computeMode(ComputeMode::UNKNOWN)
     , m_audioConverter(nullptr)
+    , m_decodeService(nullptr)
     , m_audioDuration(0.0f)
+    , m_cancelRequested(false)
+    , m_cancelRequestedAtMs(0)
+    , m_reservedCores(0)
+    , m_resumeCs(0)
 {
     m_audioConverter = new AudioConverter(this);
+    m_audioConverter->setCancelFlag(&m_cancelRequested);
 
     connect(m_audioConverter, &AudioConverter::logMessage, this, &WhisperWorker::logMessage);
     connect(m_audioConverter, &AudioConverter::conversionStarted, this, [this]() {
@@ -36,10 +384,9 @@ WhisperWorker::WhisperWorker(QObject* parent)
 
 WhisperWorker::~WhisperWorker()
 {
-    if (m_ctx) {
-        whisper_free(m_ctx);
-        m_ctx = nullptr;
-    }
+    releaseState();
+    m_ctx = nullptr;
+    m_model.reset();
 }
 
 bool WhisperWorker::checkCudaRuntime(QString& version)
@@ -161,18 +508,59 @@ SystemCapabilities WhisperWorker::detectSystemCapabilities()
     return caps;
 }
 
-bool WhisperWorker::tryInitWithGpu(const QString& modelPath, QString& errorMsg)
+SystemCapabilities WhisperWorker::cachedSystemCapabilities()
 {
-    emit logMessage("→ Attempting GPU mode initialization...");
+    QMutexLocker locker(&s_capabilitiesMutex);
+
+    if (!s_capabilitiesDetected) {
+        s_capabilities = detectSystemCapabilities();
+        s_capabilitiesDetected = true;
+    }
+    else {
+        emit logMessage("Using GPU capability detection cached for this session");
+    }
+
+    return s_capabilities;
+}
+
+bool WhisperWorker::acquireModel(const QString& modelPath, bool useGpu)
+{
+    bool cacheHit = false;
+    std::shared_ptr<whisper_context> model = WhisperModelCache::instance().acquire(modelPath, useGpu, &cacheHit);
 
-    struct whisper_context_params cparams = whisper_context_default_params();
-    cparams.use_gpu = true;
+    if (!model) {
+        return false;
+    }
 
-    struct whisper_context* ctx = whisper_init_from_file_with_params(
-        modelPath.toUtf8().constData(), cparams);
+    m_model = model;
+    m_ctx = model.get();
+
+    if (cacheHit) {
+        emit logMessage("✓ Reusing model context from cache");
+    }
+    else {
+        emit logMessage(QString("Model loaded from disk in %1 ms")
+            .arg(WhisperModelCache::instance().stats().lastLoadMs));
+    }
+    return true;
+}
+
+void WhisperWorker::reportModelCacheStats()
+{
+    WhisperModelCache::Stats stats = WhisperModelCache::instance().stats();
+    emit logMessage(QString("Model cache: %1 hits, %2 misses, last load %3 ms, total load %4 ms")
+        .arg(stats.hits)
+        .arg(stats.misses)
+        .arg(stats.lastLoadMs)
+        .arg(stats.totalLoadMs));
+    emit modelCacheStatsChanged(stats.hits, stats.misses, stats.lastLoadMs);
+}
+
+bool WhisperWorker::tryInitWithGpu(const QString& modelPath, QString& errorMsg)
+{
+    emit logMessage("→ Attempting GPU mode initialization...");
 
-    if (ctx) {
-        m_ctx = ctx;
+    if (acquireModel(modelPath, true)) {
         m_computeMode = ComputeMode::GPU_ACCELERATED;
         emit logMessage("✓ GPU mode initialization successful!");
         return true;
@@ -188,14 +576,7 @@ bool WhisperWorker::tryInitWithCpu(const QString& modelPath, QString& errorMsg)
 {
     emit logMessage("→ Using CPU mode initialization...");
 
-    struct whisper_context_params cparams = whisper_context_default_params();
-    cparams.use_gpu = false;
-
-    struct whisper_context* ctx = whisper_init_from_file_with_params(
-        modelPath.toUtf8().constData(), cparams);
-
-    if (ctx) {
-        m_ctx = ctx;
+    if (acquireModel(modelPath, false)) {
         m_computeMode = ComputeMode::CPU_ONLY;
         emit logMessage("✓ CPU mode initialization successful");
         return true;
@@ -224,16 +605,27 @@ QString WhisperWorker::formatCapabilities(const SystemCapabilities& caps)
 
 bool WhisperWorker::initModel(const QString& modelPath)
 {
+    QDateTime modified = QFileInfo(modelPath).lastModified();
+
+    if (m_ctx && m_modelPath == modelPath && m_modelModified == modified) {
+        QString modeStr = (m_computeMode == ComputeMode::GPU_ACCELERATED) ?
+            "GPU accelerated" : "CPU mode";
+        emit logMessage(QString("✓ Model already resident (%1), skipping reload").arg(modeStr));
+        reportModelCacheStats();
+        emit modelLoaded(true, QString("Model loaded successfully (%1)").arg(modeStr));
+        return true;
+    }
+
     emit logMessage("====================================");
     emit logMessage("Initializing Whisper model...");
     emit logMessage("====================================");
 
-    if (m_ctx) {
-        whisper_free(m_ctx);
-        m_ctx = nullptr;
-    }
+    releaseState();
+    m_ctx = nullptr;
+    m_model.reset();
+    m_modelPath.clear();
 
-    m_capabilities = detectSystemCapabilities();
+    m_capabilities = cachedSystemCapabilities();
 
     QString capInfo = formatCapabilities(m_capabilities);
     emit logMessage(capInfo);
@@ -276,10 +668,15 @@ bool WhisperWorker::initModel(const QString& modelPath)
     if (!success) {
         m_lastError = "Model initialization failed: " + errorMsg;
         m_computeMode = ComputeMode::UNKNOWN;
+        reportModelCacheStats();
         emit modelLoaded(false, m_lastError);
         return false;
     }
 
+    m_modelPath = modelPath;
+    m_modelModified = modified;
+    reportModelCacheStats();
+
     QString modeStr = (m_computeMode == ComputeMode::GPU_ACCELERATED) ?
         "GPU accelerated" : "CPU mode";
     QString details = QString("Using %1, model path: %2").arg(modeStr, modelPath);
@@ -395,7 +792,44 @@ bool WhisperWorker::readWavFile(const QString& path, std::vector<float>& audio)
     return true;
 }
 
-bool WhisperWorker::loadAndConvertAudio(const QString& audioPath, std::vector<float>& audioData)
+bool WhisperWorker::loadSharedAudio(const QString& audioPath, std::shared_ptr<const std::vector<float>>& audioData)
+{
+    std::shared_ptr<DecodedAudio> decoded = m_decodeService->acquire(audioPath);
+
+    if (!decoded->isFinished()) {
+        emit logMessage("Waiting for shared audio decode...");
+    }
+
+    while (!decoded->waitForFinished(200)) {
+        if (m_cancelRequested) {
+            // Releasing the lease cancels the shared decode if nobody else reads it.
+            decoded.reset();
+            m_lastError = "Cancelled";
+            return false;
+        }
+        emit transcriptionProgress(decoded->progress() / 2);
+    }
+
+    if (!decoded->isValid()) {
+        m_lastError = "Audio decoding failed: " + decoded->errorString();
+        emit logMessage("ERROR: " + m_lastError);
+        return false;
+    }
+
+    audioData = decoded->resampled(16000);
+    if (!audioData) {
+        m_lastError = "Failed to resample shared audio to 16kHz";
+        emit logMessage("ERROR: " + m_lastError);
+        return false;
+    }
+
+    emit logMessage(QString("Using shared decoded audio: %1Hz -> 16000Hz, %2 samples")
+        .arg(decoded->sampleRate())
+        .arg(audioData->size()));
+    return true;
+}
+
+bool WhisperWorker::loadAndConvertAudio(const QString& audioPath, std::shared_ptr<const std::vector<float>>& audioData)
 {
     emit logMessage(QString("Loading audio file: %1").arg(audioPath));
 
@@ -408,11 +842,18 @@ bool WhisperWorker::loadAndConvertAudio(const QString& audioPath, std::vector<fl
 
     emit logMessage(QString("File size: %1 bytes").arg(fileInfo.size()));
 
+    if (m_decodeService) {
+        return loadSharedAudio(audioPath, audioData);
+    }
+
+    auto samples = std::make_shared<std::vector<float>>();
+
     if (!needsConversion(audioPath)) {
         emit logMessage("Audio file already in correct format (16kHz, mono, 16-bit WAV)");
-        bool result = readWavFile(audioPath, audioData);
+        bool result = readWavFile(audioPath, *samples);
         if (result) {
-            emit logMessage(QString("Successfully loaded %1 samples").arg(audioData.size()));
+            emit logMessage(QString("Successfully loaded %1 samples").arg(samples->size()));
+            audioData = samples;
         }
         return result;
     }
@@ -424,38 +865,243 @@ bool WhisperWorker::loadAndConvertAudio(const QString& audioPath, std::vector<fl
     params.targetChannels = 1;
     params.targetFormat = AV_SAMPLE_FMT_S16;
 
-    if (!m_audioConverter->convertToMemory(audioPath, audioData, params)) {
+    if (!m_audioConverter->convertToMemory(audioPath, *samples, params)) {
+        if (m_cancelRequested) {
+            return false;
+        }
         m_lastError = "Audio conversion failed: " + m_audioConverter->getLastError();
         emit logMessage("ERROR: " + m_lastError);
         return false;
     }
 
-    emit logMessage(QString("Conversion successful: %1 samples").arg(audioData.size()));
+    emit logMessage(QString("Conversion successful: %1 samples").arg(samples->size()));
+    audioData = samples;
     return true;
 }
 
+struct whisper_full_params WhisperWorker::defaultFullParams(int threads)
+{
+    struct whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.print_progress = false;
+    params.print_timestamps = false;
+    params.print_special = false;
+    params.translate = false;
+    params.language = "en";
+    params.n_threads = threads;
+    // Checked between graph nodes, so an abort lands within one compute step.
+    params.abort_callback = WhisperWorker::abortCallback;
+    params.abort_callback_user_data = this;
+    return params;
+}
+
+void WhisperWorker::emitSegment(int64_t t0, int64_t t1, const QString& text, bool journal)
+{
+    emit segmentTranscribed(formatSegment(t0, t1, text));
+    emit segmentReady(t0 * 10, t1 * 10, text.trimmed());
+
+    if (journal && m_journal.isOpen()) {
+        m_journal.append(t0, t1, text);
+    }
+}
+
+int64_t WhisperWorker::resumeFromJournal(const QString& audioPath, QString& result, int& segmentCount)
+{
+    m_resumePrompt.clear();
+
+    if (!m_options.journal) {
+        return 0;
+    }
+
+    const QString settings = QString("%1|vad=%2")
+        .arg(QFileInfo(m_modelPath).fileName())
+        .arg(m_options.skipSilence ? 1 : 0);
+
+    std::vector<TranscriptionJournal::Segment> recovered;
+    if (!m_journal.open(audioPath, settings, recovered)) {
+        emit logMessage("WARNING: Cannot open transcription journal, continuing without it: " + m_journal.lastError());
+        return 0;
+    }
+
+    if (recovered.empty()) {
+        return 0;
+    }
+
+    int64_t resumeCs = 0;
+    QString promptText;
+    for (const TranscriptionJournal::Segment& segment : recovered) {
+        emitSegment(segment.t0, segment.t1, segment.text, false);
+        result += formatSegment(segment.t0, segment.t1, segment.text);
+        ++segmentCount;
+        resumeCs = qMax(resumeCs, segment.t1);
+        promptText = (promptText + segment.text).right(200);
+    }
+
+    // The tail of the recovered text stands in for the decoder context that
+    // was lost, like the prompt carried across streaming windows.
+    m_resumePrompt = promptText.toUtf8();
+
+    emit logMessage(QString("Journal: recovered %1 segments, resuming at %2 s")
+        .arg(recovered.size())
+        .arg(resumeCs / 100.0, 0, 'f', 2));
+    return resumeCs;
+}
+
+void WhisperWorker::reportJournalOverhead(qint64 elapsedMs)
+{
+    if (!m_journal.isOpen()) {
+        return;
+    }
+
+    const TranscriptionJournal::Stats& stats = m_journal.stats();
+    const double journalMs = (stats.writeNs + stats.syncNs) / 1e6;
+    const double processedMs = qMax(0.0, m_audioDuration * 1000.0 - m_resumeCs * 10.0);
+    const double bareMs = elapsedMs - journalMs;
+
+    emit logMessage(QString("Journal: %1 segments, %2 fsyncs, %3 ms writing + %4 ms syncing (%5% of %6 ms); RTF %7, %8 without journaling")
+        .arg(stats.segments)
+        .arg(stats.syncs)
+        .arg(stats.writeNs / 1e6, 0, 'f', 2)
+        .arg(stats.syncNs / 1e6, 0, 'f', 2)
+        .arg(elapsedMs > 0 ? journalMs * 100.0 / elapsedMs : 0.0, 0, 'f', 3)
+        .arg(elapsedMs)
+        .arg(processedMs > 0.0 ? elapsedMs / processedMs : 0.0, 0, 'f', 3)
+        .arg(processedMs > 0.0 ? qMax(0.0, bareMs) / processedMs : 0.0, 0, 'f', 3));
+}
+
+void WhisperWorker::requestCancel()
+{
+    if (!m_cancelRequested.exchange(true)) {
+        m_cancelRequestedAtMs = steadyNowMs();
+    }
+}
+
+bool WhisperWorker::abortCallback(void* user_data)
+{
+    return static_cast<WhisperWorker*>(user_data)->m_cancelRequested.load();
+}
+
+void WhisperWorker::finishCancelled(const QString& partialText, int segmentCount)
+{
+    // Kept on disk, so the next run on this file continues from here.
+    m_journal.close();
+
+    m_lastError = "Cancelled";
+    emit logMessage(QString("WARNING: Transcription cancelled, stopped %1 ms after the request; keeping %2 segments")
+        .arg(steadyNowMs() - m_cancelRequestedAtMs)
+        .arg(segmentCount));
+    emit transcriptionCancelled(partialText, segmentCount);
+}
+
+int WhisperWorker::runFull(struct whisper_full_params params, const float* samples, int count)
+{
+    if (!m_options.privateState) {
+        return whisper_full(m_ctx, params, samples, count);
+    }
+
+    if (!m_state) {
+        m_state = whisper_init_state(m_ctx);
+        if (!m_state) {
+            return -1;
+        }
+    }
+    return whisper_full_with_state(m_ctx, m_state, params, samples, count);
+}
+
+void WhisperWorker::releaseState()
+{
+    if (m_state) {
+        whisper_free_state(m_state);
+        m_state = nullptr;
+    }
+}
+
+int WhisperWorker::fullSegmentCount() const
+{
+    return m_state ? whisper_full_n_segments_from_state(m_state) : whisper_full_n_segments(m_ctx);
+}
+
+int64_t WhisperWorker::fullSegmentT0(int index) const
+{
+    return m_state ? whisper_full_get_segment_t0_from_state(m_state, index) : whisper_full_get_segment_t0(m_ctx, index);
+}
+
+int64_t WhisperWorker::fullSegmentT1(int index) const
+{
+    return m_state ? whisper_full_get_segment_t1_from_state(m_state, index) : whisper_full_get_segment_t1(m_ctx, index);
+}
+
+QString WhisperWorker::fullSegmentText(int index) const
+{
+    return QString::fromUtf8(m_state ? whisper_full_get_segment_text_from_state(m_state, index)
+        : whisper_full_get_segment_text(m_ctx, index));
+}
+
+int WhisperWorker::planParallelStates(size_t sampleCount) const
+{
+    if (m_computeMode != ComputeMode::CPU_ONLY || m_options.parallelStates == 1) {
+        return 1;
+    }
+
+    // Each state carries its own KV cache and compute buffers, so keep at least
+    // four threads per state and one minute of audio per chunk.
+    const int totalThreads = threadBudget();
+    int states = m_options.parallelStates > 0 ? m_options.parallelStates : qMin(8, totalThreads / 4);
+    int maxByLength = static_cast<int>(sampleCount / (static_cast<size_t>(kWhisperSampleRate) * 60));
+
+    return qBound(1, qMin(states, maxByLength), totalThreads);
+}
+
+int WhisperWorker::threadBudget() const
+{
+    const int cores = qMax(1, QThread::idealThreadCount() - m_reservedCores);
+    return m_options.threadBudget > 0 ? qMin(m_options.threadBudget, cores) : cores;
+}
+
+// Streaming runs one window at a time on a single state, each prompted with
+// the text committed before it. A long file on CPU finishes sooner split over
+// parallel states, whose chunks still reach the UI in order as they complete.
+bool WhisperWorker::prefersParallel(const QString& audioPath)
+{
+    if (m_computeMode != ComputeMode::CPU_ONLY || m_options.parallelStates == 1) {
+        return false;
+    }
+
+    AudioConverter converter;
+    if (!converter.probe(audioPath)) {
+        return false;
+    }
+    const qint64 durationMs = qMax<qint64>(0, converter.sourceDurationMs());
+    return planParallelStates(static_cast<size_t>(durationMs) * (kWhisperSampleRate / 1000)) > 1;
+}
+
+// CPU threads for each of `stateCount` states running at once. A GPU run
+// only needs one thread to drive the device.
+int WhisperWorker::threadsPerState(int stateCount) const
+{
+    if (m_computeMode != ComputeMode::CPU_ONLY) {
+        return 1;
+    }
+    return qMax(1, threadBudget() / qMax(1, stateCount));
+}
+
 void WhisperWorker::newSegmentCallback(struct whisper_context* ctx, struct whisper_state* state, int n_new, void* user_data)
 {
+    Q_UNUSED(ctx);
     WhisperWorker* worker = static_cast<WhisperWorker*>(user_data);
 
-    const int n_segments = whisper_full_n_segments(ctx);
+    // `state` is whichever state whisper_full ran on, default or private.
+    const int n_segments = whisper_full_n_segments_from_state(state);
 
     for (int i = n_segments - n_new; i < n_segments; ++i) {
-        const char* text = whisper_full_get_segment_text(ctx, i);
-        int64_t t0 = whisper_full_get_segment_t0(ctx, i);
-        int64_t t1 = whisper_full_get_segment_t1(ctx, i);
-
-        QString timestamp = QString("[%1 -> %2] ")
-            .arg(t0 / 100.0, 0, 'f', 2)
-            .arg(t1 / 100.0, 0, 'f', 2);
-
-        QString segmentText = timestamp + QString::fromUtf8(text) + "\n";
+        const char* text = whisper_full_get_segment_text_from_state(state, i);
+        int64_t t0 = worker->toSourceCs(whisper_full_get_segment_t0_from_state(state, i), true);
+        int64_t t1 = worker->toSourceCs(whisper_full_get_segment_t1_from_state(state, i), false);
 
-        emit worker->segmentTranscribed(segmentText);
+        worker->emitSegment(t0, t1, QString::fromUtf8(text));
     }
 
     if (n_segments > 0) {
-        int64_t t_end = whisper_full_get_segment_t1(ctx, n_segments - 1);
+        int64_t t_end = worker->toSourceCs(whisper_full_get_segment_t1_from_state(state, n_segments - 1), false);
         float timeProcessed = t_end / 100.0f;
 
         int transcriptionProgress = 0;
@@ -474,17 +1120,36 @@ void WhisperWorker::transcribe(const QString& audioPath)
         return;
     }
 
+    if (m_cancelRequested) {
+        finishCancelled(QString(), 0);
+        return;
+    }
+
+    if (m_options.streaming) {
+        if (!prefersParallel(audioPath)) {
+            transcribeStreaming(audioPath);
+            return;
+        }
+        emit logMessage("Long file on CPU: using parallel states instead of streaming windows");
+    }
+
     emit transcriptionStarted();
 
     QString modeStr = (m_computeMode == ComputeMode::GPU_ACCELERATED) ? "GPU" : "CPU";
     emit logMessage(QString("Starting transcription (%1 mode)...").arg(modeStr));
 
-    std::vector<float> audio;
-    if (!loadAndConvertAudio(audioPath, audio)) {
+    std::shared_ptr<const std::vector<float>> audioData;
+    if (!loadAndConvertAudio(audioPath, audioData)) {
+        if (m_cancelRequested) {
+            finishCancelled(QString(), 0);
+            return;
+        }
         emit transcriptionFailed(m_lastError);
         return;
     }
 
+    const std::vector<float>& audio = *audioData;
+
     if (audio.empty()) {
         m_lastError = "Audio data is empty after loading/conversion";
         emit logMessage("ERROR: " + m_lastError);
@@ -496,54 +1161,483 @@ void WhisperWorker::transcribe(const QString& audioPath)
     m_audioDuration = audio.size() / 16000.0f;
     emit logMessage(QString("Audio duration: %1 seconds").arg(m_audioDuration, 0, 'f', 2));
 
-    struct whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-    params.print_progress = false;
+    m_speechSpans.clear();
+    std::vector<float> speechAudio;
+    const std::vector<float>* inferenceAudio = &audio;
+
+    if (m_options.skipSilence) {
+        QElapsedTimer vadTimer;
+        vadTimer.start();
+
+        VoiceActivityDetector detector;
+        std::vector<VoiceActivityDetector::Region> regions = detector.detect(audio.data(), static_cast<qint64>(audio.size()));
+        qint64 speechSamples = VoiceActivityDetector::totalLength(regions);
+        double skipped = 1.0 - static_cast<double>(speechSamples) / audio.size();
+
+        emit logMessage(QString("VAD: %1 speech regions, %2% of audio skipped (analysis %3 ms)")
+            .arg(regions.size())
+            .arg(skipped * 100.0, 0, 'f', 1)
+            .arg(vadTimer.elapsed()));
+
+        if (regions.empty()) {
+            emit logMessage("WARNING: No speech detected by VAD, nothing to transcribe.");
+            emit transcriptionProgress(100);
+            emit transcriptionCompleted("");
+            return;
+        }
+
+        // Below a few percent the extra joins cost more accuracy than they save.
+        if (skipped > 0.05) {
+            speechAudio = VoiceActivityDetector::compact(audio.data(), regions, kWhisperSampleRate / 5, m_speechSpans);
+            inferenceAudio = &speechAudio;
+        }
+    }
+
+    QString result;
+    int segmentCount = 0;
+    bool success = true;
+
+    m_resumeCs = resumeFromJournal(audioPath, result, segmentCount);
+    const size_t startSample = static_cast<size_t>(qMin<qint64>(static_cast<qint64>(inferenceAudio->size()),
+        VoiceActivityDetector::mapFromSource(m_speechSpans, m_resumeCs * kWhisperSampleRate / 100)));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Less than a second left means the interrupted run had reached the end.
+    if (inferenceAudio->size() - startSample >= static_cast<size_t>(kWhisperSampleRate)) {
+        int stateCount = planParallelStates(inferenceAudio->size() - startSample);
+        if (stateCount > 1) {
+            success = transcribeParallel(*inferenceAudio, startSample, stateCount, result, segmentCount);
+        }
+        else {
+            success = transcribeSingle(*inferenceAudio, startSample, result, segmentCount);
+        }
+    }
+
+    if (m_cancelRequested) {
+        finishCancelled(result, segmentCount);
+        return;
+    }
+
+    if (!success) {
+        m_journal.close();
+        emit logMessage("ERROR: " + m_lastError);
+        emit transcriptionFailed(m_lastError);
+        return;
+    }
+
+    // RTF is processing time over audio time, as in the CLI report.
+    const qint64 elapsedMs = timer.elapsed();
+    const double processedMs = m_audioDuration * 1000.0 - m_resumeCs * 10.0;
+    emit logMessage(QString("Transcription completed! Generated %1 segments in %2 ms, RTF %3 (using %4 mode)")
+        .arg(segmentCount)
+        .arg(elapsedMs)
+        .arg(processedMs > 0.0 ? elapsedMs / processedMs : 0.0, 0, 'f', 3)
+        .arg(modeStr));
+
+    reportJournalOverhead(elapsedMs);
+    m_journal.discard();
+
+    if (inferenceAudio != &audio) {
+        emit logMessage(QString("VAD: inferred %1 s instead of %2 s, expected speedup %3x")
+            .arg(inferenceAudio->size() / static_cast<double>(kWhisperSampleRate), 0, 'f', 1)
+            .arg(m_audioDuration, 0, 'f', 1)
+            .arg(static_cast<double>(audio.size()) / inferenceAudio->size(), 0, 'f', 2));
+    }
+
+    if (m_options.benchmark) {
+        runBaselineBenchmark(audio, elapsedMs);
+    }
+
+    emit transcriptionProgress(100);
+
+    if (segmentCount == 0) {
+        emit logMessage("WARNING: No segments were generated. The audio may be silent or the model may not have detected speech.");
+    }
+
+    emit transcriptionCompleted(result);
+}
+
+bool WhisperWorker::transcribeSingle(const std::vector<float>& audio, size_t startSample, QString& result, int& segmentCount)
+{
+    struct whisper_full_params params = defaultFullParams(threadsPerState(1));
     params.print_timestamps = true;
-    params.print_special = false;
-    params.translate = false;
-    params.language = "en";
-    params.n_threads = (m_computeMode == ComputeMode::CPU_ONLY) ? 4 : 1;
-    params.offset_ms = 0;
+    params.offset_ms = static_cast<int>(startSample * 1000 / kWhisperSampleRate);
     params.duration_ms = 0;
 
+    if (startSample > 0 && !m_resumePrompt.isEmpty()) {
+        params.initial_prompt = m_resumePrompt.constData();
+    }
+
     params.new_segment_callback = WhisperWorker::newSegmentCallback;
     params.new_segment_callback_user_data = this;
 
     emit logMessage(QString("Starting Whisper transcription with %1 threads...").arg(params.n_threads));
     emit transcriptionProgress(50);
 
-    int ret = whisper_full(m_ctx, params, audio.data(), audio.size());
+    int ret = runFull(params, audio.data(), static_cast<int>(audio.size()));
 
-    if (ret != 0) {
+    // An aborted run still holds the windows it finished; those segments were
+    // already emitted and form the partial result.
+    if (ret != 0 && !m_cancelRequested) {
         m_lastError = "Transcription failed, error code: " + QString::number(ret);
+        return false;
+    }
+
+    int n_segments = fullSegmentCount();
+    for (int i = 0; i < n_segments; ++i) {
+        int64_t t0 = toSourceCs(fullSegmentT0(i), true);
+        int64_t t1 = toSourceCs(fullSegmentT1(i), false);
+
+        result += formatSegment(t0, t1, fullSegmentText(i));
+    }
+
+    segmentCount += n_segments;
+    return ret == 0;
+}
+
+void WhisperWorker::runBaselineBenchmark(const std::vector<float>& audio, qint64 elapsedMs)
+{
+    emit logMessage("Benchmark: re-running the single-call path over the full audio for comparison...");
+
+    // The legacy path this pipeline replaced: one whisper_full call with a
+    // fixed four CPU threads.
+    const int baselineThreads = (m_computeMode == ComputeMode::CPU_ONLY) ? 4 : 1;
+    struct whisper_full_params params = defaultFullParams(baselineThreads);
+
+    QElapsedTimer timer;
+    timer.start();
+    int ret = runFull(params, audio.data(), static_cast<int>(audio.size()));
+    const qint64 baselineMs = timer.elapsed();
+
+    if (ret != 0) {
+        emit logMessage(QString("Benchmark: single-call run failed, error code: %1").arg(ret));
+        return;
+    }
+
+    emit logMessage(QString("Benchmark: single call (%1 threads, no VAD) %2 ms, current pipeline %3 ms, speedup %4x")
+        .arg(baselineThreads)
+        .arg(baselineMs)
+        .arg(elapsedMs)
+        .arg(elapsedMs > 0 ? static_cast<double>(baselineMs) / elapsedMs : 0.0, 0, 'f', 2));
+}
+
+int64_t WhisperWorker::toSourceCs(int64_t cs, bool isStart) const
+{
+    if (m_speechSpans.empty()) {
+        return cs;
+    }
+
+    const int64_t samplesPerCs = kWhisperSampleRate / 100;
+    return VoiceActivityDetector::mapToSource(m_speechSpans, cs * samplesPerCs, isStart) / samplesPerCs;
+}
+
+void WhisperWorker::transcribeStreaming(const QString& audioPath)
+{
+    emit transcriptionStarted();
+
+    QString modeStr = (m_computeMode == ComputeMode::GPU_ACCELERATED) ? "GPU" : "CPU";
+    emit logMessage(QString("Starting streaming transcription (%1 mode, %2 s windows, %3 s overlap)...")
+        .arg(modeStr)
+        .arg(m_options.windowMs / 1000.0, 0, 'f', 1)
+        .arg(m_options.overlapMs / 1000.0, 0, 'f', 1));
+
+    QFileInfo fileInfo(audioPath);
+    if (!fileInfo.exists()) {
+        m_lastError = "Audio file does not exist: " + audioPath;
         emit logMessage("ERROR: " + m_lastError);
         emit transcriptionFailed(m_lastError);
         return;
     }
 
-    emit transcriptionProgress(100);
+    QElapsedTimer timer;
+    timer.start();
+
+    const int samplesPerMs = kWhisperSampleRate / 1000;
+    const int windowMs = qMax(1000, m_options.windowMs);
+    const int overlapMs = qBound(0, m_options.overlapMs, windowMs / 2);
+    const int windowSamples = windowMs * samplesPerMs;
+    const int overlapSamples = overlapMs * samplesPerMs;
+
+    AudioWindowQueue queue(m_options.queueCapacity);
+    AudioWindowBuilder builder(queue, windowSamples, overlapSamples);
+    std::atomic<qint64> expectedDurationMs(0);
+    QString producerError;
+    bool producerOk = false;
+
+    std::thread producer([&]() {
+        if (m_decodeService) {
+            producerOk = streamDecodedAudio(m_decodeService->acquire(audioPath), builder, expectedDurationMs,
+                m_cancelRequested, producerError);
+        }
+        else {
+            AudioConverter converter;
+            connect(&converter, &AudioConverter::logMessage, this, &WhisperWorker::logMessage, Qt::DirectConnection);
+            converter.setCancelFlag(&m_cancelRequested);
+
+            AudioConverter::ConversionParams params;
+            params.targetSampleRate = kWhisperSampleRate;
+            params.targetChannels = 1;
+            params.targetFormat = AV_SAMPLE_FMT_FLT;
+
+            producerOk = converter.convertToSink(audioPath, [&](const float* samples, int count) {
+                expectedDurationMs = converter.sourceDurationMs();
+                return builder.append(samples, count);
+                }, params);
+            if (!producerOk) {
+                producerError = "Audio conversion failed: " + converter.getLastError();
+            }
+        }
 
-    int n_segments = whisper_full_n_segments(m_ctx);
-    emit logMessage(QString("Transcription completed! Generated %1 segments (using %2 mode)").arg(n_segments).arg(modeStr));
+        if (producerOk) {
+            producerOk = builder.finish();
+        }
+        queue.close();
+        });
 
-    if (n_segments == 0) {
-        emit logMessage("WARNING: No segments were generated. The audio may be silent or the model may not have detected speech.");
-        emit transcriptionCompleted("");
+    struct whisper_full_params params = defaultFullParams(threadsPerState(1));
+    params.no_context = true;
+
+    const int64_t overlapCs = overlapMs / 10;
+    int64_t committedEndCs = 0;
+    qint64 firstSegmentMs = -1;
+    int windowCount = 0;
+    int segmentCount = 0;
+    int skippedWindows = 0;
+    bool inferenceFailed = false;
+    VoiceActivityDetector detector;
+    QString result;
+    QString promptText;
+    QByteArray prompt;
+    AudioWindow window;
+
+    m_resumeCs = resumeFromJournal(audioPath, result, segmentCount);
+    committedEndCs = m_resumeCs;
+    promptText = QString::fromUtf8(m_resumePrompt);
+
+    while (queue.pop(window)) {
+        if (m_cancelRequested) {
+            break;
+        }
+
+        const int64_t windowStartCs = window.startSample * 100 / kWhisperSampleRate;
+        const int64_t windowEndCs = windowStartCs + static_cast<int64_t>(window.samples.size()) * 100 / kWhisperSampleRate;
+        const int64_t seamCs = window.isLast ? std::numeric_limits<int64_t>::max() : windowEndCs - overlapCs / 2;
+
+        // Already in the journal from the interrupted run.
+        if (windowEndCs <= m_resumeCs) {
+            ++windowCount;
+            continue;
+        }
+
+        if (m_options.skipSilence &&
+            detector.detect(window.samples.data(), static_cast<qint64>(window.samples.size())).empty()) {
+            ++windowCount;
+            ++skippedWindows;
+            continue;
+        }
+
+        // Carry the tail of the committed text across the seam instead of
+        // whisper's own context, which would include the discarded overlap.
+        prompt = promptText.toUtf8();
+        params.initial_prompt = prompt.isEmpty() ? nullptr : prompt.constData();
+        params.offset_ms = static_cast<int>(qMax<int64_t>(0, m_resumeCs - windowStartCs) * 10);
+        params.n_threads = threadsPerState(1);
+
+        int ret = runFull(params, window.samples.data(), static_cast<int>(window.samples.size()));
+        if (ret != 0 && m_cancelRequested) {
+            break;
+        }
+        if (ret != 0) {
+            m_lastError = "Transcription failed, error code: " + QString::number(ret);
+            inferenceFailed = true;
+            break;
+        }
+
+        const int n_segments = fullSegmentCount();
+        for (int i = 0; i < n_segments; ++i) {
+            int64_t t0 = windowStartCs + fullSegmentT0(i);
+            int64_t t1 = windowStartCs + fullSegmentT1(i);
+
+            if (t0 >= seamCs) {
+                break;
+            }
+            if ((t0 + t1) / 2 < committedEndCs) {
+                continue;
+            }
+
+            t0 = qMax(t0, committedEndCs);
+            t1 = qMax(t1, t0);
+
+            QString text = fullSegmentText(i);
+
+            if (firstSegmentMs < 0) {
+                firstSegmentMs = timer.elapsed();
+                emit logMessage(QString("First segment ready after %1 ms").arg(firstSegmentMs));
+            }
+
+            emitSegment(t0, t1, text);
+            result += formatSegment(t0, t1, text);
+            committedEndCs = t1;
+            ++segmentCount;
+
+            promptText = (promptText + text).right(200);
+        }
+
+        ++windowCount;
+
+        qint64 totalMs = expectedDurationMs;
+        if (totalMs > 0) {
+            emit transcriptionProgress(static_cast<int>(qMin<qint64>(99, windowEndCs * 10 * 100 / totalMs)));
+        }
+    }
+
+    queue.close();
+    producer.join();
+
+    m_audioDuration = builder.totalSamples() / static_cast<float>(kWhisperSampleRate);
+
+    if (m_cancelRequested) {
+        finishCancelled(result, segmentCount);
         return;
     }
 
-    QString result;
-    for (int i = 0; i < n_segments; ++i) {
-        const char* text = whisper_full_get_segment_text(m_ctx, i);
-        int64_t t0 = whisper_full_get_segment_t0(m_ctx, i);
-        int64_t t1 = whisper_full_get_segment_t1(m_ctx, i);
+    QString error;
+    if (inferenceFailed) {
+        error = m_lastError;
+    }
+    else if (!producerOk) {
+        error = producerError.isEmpty() ? QString("Audio streaming stopped unexpectedly") : producerError;
+    }
+    else if (builder.totalSamples() == 0) {
+        error = "Audio data is empty after loading/conversion";
+    }
 
-        QString timestamp = QString("[%1 -> %2] ")
-            .arg(t0 / 100.0, 0, 'f', 2)
-            .arg(t1 / 100.0, 0, 'f', 2);
+    if (!error.isEmpty()) {
+        m_journal.close();
+        m_lastError = error;
+        emit logMessage("ERROR: " + m_lastError);
+        emit transcriptionFailed(m_lastError);
+        return;
+    }
 
-        result += timestamp + QString::fromUtf8(text) + "\n";
+    emit transcriptionProgress(100);
+    emit logMessage(QString("Streaming transcription completed: %1 segments from %2 windows, %3 s of audio in %4 ms (first segment after %5 ms, using %6 mode)")
+        .arg(segmentCount)
+        .arg(windowCount)
+        .arg(m_audioDuration, 0, 'f', 2)
+        .arg(timer.elapsed())
+        .arg(firstSegmentMs)
+        .arg(modeStr));
+
+    reportJournalOverhead(timer.elapsed());
+    m_journal.discard();
+
+    if (skippedWindows > 0) {
+        emit logMessage(QString("VAD: skipped %1 of %2 windows without speech")
+            .arg(skippedWindows)
+            .arg(windowCount));
+    }
+
+    if (segmentCount == 0) {
+        emit logMessage("WARNING: No segments were generated. The audio may be silent or the model may not have detected speech.");
     }
 
     emit transcriptionCompleted(result);
-}
\ No newline at end of file
+}
+
+bool WhisperWorker::transcribeParallel(const std::vector<float>& audio, size_t startSample, int stateCount, QString& result, int& segmentCount)
+{
+    const int totalThreads = threadBudget();
+    const std::vector<std::pair<size_t, size_t>> chunks = splitAtSilence(audio, startSample, stateCount);
+    const int stateThreads = threadsPerState(static_cast<int>(chunks.size()));
+
+    emit logMessage(QString("Starting parallel transcription: %1 chunks x %2 threads (%3 cores available)")
+        .arg(chunks.size())
+        .arg(stateThreads)
+        .arg(totalThreads));
+    emit transcriptionProgress(50);
+
+    std::vector<std::vector<TranscribedSegment>> chunkSegments(chunks.size());
+    std::vector<int> chunkResults(chunks.size(), 0);
+    std::vector<char> chunkCancelled(chunks.size(), 0);
+    std::vector<std::thread> threads;
+    threads.reserve(chunks.size());
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        threads.emplace_back([this, &audio, &chunks, &chunkSegments, &chunkResults, &chunkCancelled, c, stateThreads]() {
+            struct whisper_state* state = whisper_init_state(m_ctx);
+            if (!state) {
+                chunkResults[c] = -1;
+                return;
+            }
+
+            struct whisper_full_params params = defaultFullParams(stateThreads);
+            if (c == 0 && chunks[c].first > 0 && !m_resumePrompt.isEmpty()) {
+                params.initial_prompt = m_resumePrompt.constData();
+            }
+            const float* data = audio.data() + chunks[c].first;
+            chunkResults[c] = whisper_full_with_state(m_ctx, state, params, data, static_cast<int>(chunks[c].second));
+            chunkCancelled[c] = m_cancelRequested ? 1 : 0;
+
+            if (chunkResults[c] == 0 || chunkCancelled[c]) {
+                const int64_t offsetCs = static_cast<int64_t>(chunks[c].first) * 100 / kWhisperSampleRate;
+                const int n_segments = whisper_full_n_segments_from_state(state);
+                chunkSegments[c].reserve(n_segments);
+                for (int i = 0; i < n_segments; ++i) {
+                    TranscribedSegment segment;
+                    segment.t0 = toSourceCs(offsetCs + whisper_full_get_segment_t0_from_state(state, i), true);
+                    segment.t1 = toSourceCs(offsetCs + whisper_full_get_segment_t1_from_state(state, i), false);
+                    segment.text = QString::fromUtf8(whisper_full_get_segment_text_from_state(state, i));
+                    chunkSegments[c].push_back(segment);
+                }
+            }
+
+            whisper_free_state(state);
+            });
+    }
+
+    // Chunks are contiguous, so joining in order yields segments in time order
+    // and lets earlier chunks reach the UI while later ones are still running.
+    // After a cancel, output stops with the first chunk that may be incomplete
+    // so the partial result has no gaps.
+    int failedChunk = -1;
+    bool stopped = false;
+
+    for (size_t c = 0; c < threads.size(); ++c) {
+        threads[c].join();
+
+        if (chunkResults[c] != 0 && !chunkCancelled[c]) {
+            if (failedChunk < 0) {
+                failedChunk = static_cast<int>(c);
+            }
+            continue;
+        }
+        if (failedChunk >= 0 || stopped) {
+            continue;
+        }
+
+        for (const TranscribedSegment& segment : chunkSegments[c]) {
+            emitSegment(segment.t0, segment.t1, segment.text);
+            result += formatSegment(segment.t0, segment.t1, segment.text);
+            ++segmentCount;
+        }
+
+        if (chunkCancelled[c]) {
+            stopped = true;
+            continue;
+        }
+
+        emit transcriptionProgress(50 + static_cast<int>((c + 1) * 50 / threads.size()));
+    }
+
+    if (failedChunk >= 0) {
+        m_lastError = QString("Transcription failed in chunk %1, error code: %2")
+            .arg(failedChunk)
+            .arg(chunkResults[failedChunk]);
+        return false;
+    }
+
+    return !stopped;
+}
@@ -4,8 +4,15 @@
 #include <QObject>
 #include <QString>
 #include <QThread>
+#include <QDateTime>
+#include <QMutex>
+#include <atomic>
 #include <memory>
 #include "audioconverter.h"
+#include "audiodecodeservice.h"
+#include "whispermodelcache.h"
+#include "voiceactivitydetector.h"
+#include "transcriptionjournal.h"
 
 extern "C" {
 #include "whisper.h"
@@ -33,6 +40,42 @@ struct SystemCapabilities {
     }
 };
 
+// parallelStates: 0 picks a count from the core budget, 1 forces the single
+// whisper_full call. skipSilence runs VAD and only infers speech spans.
+// benchmark re-runs the legacy single call afterwards for timing.
+// privateState runs inference on a whisper_state owned by the worker, so
+// several workers can share one cached context at the same time.
+// journal records segments on disk as they are produced and resumes an
+// interrupted run of the same file and settings after its last segment.
+struct TranscriptionOptions {
+    bool streaming;
+    int windowMs;
+    int overlapMs;
+    int queueCapacity;
+    int parallelStates;
+    bool skipSilence;
+    bool benchmark;
+    bool privateState;
+    bool journal;
+    // CPU threads this worker may use across all of its states; 0 means every
+    // core. Owners running several workers at once split the cores with it.
+    int threadBudget;
+
+    TranscriptionOptions()
+        : streaming(false)
+        , windowMs(30000)
+        , overlapMs(2000)
+        , queueCapacity(4)
+        , parallelStates(0)
+        , skipSilence(true)
+        , benchmark(false)
+        , privateState(false)
+        , journal(false)
+        , threadBudget(0)
+    {
+    }
+};
+
 class WhisperWorker : public QObject
 {
     Q_OBJECT
@@ -41,11 +84,27 @@ public:
     explicit WhisperWorker(QObject* parent = nullptr);
     ~WhisperWorker();
 
+    void setDecodeService(AudioDecodeService* service) { m_decodeService = service; }
+    void setTranscriptionOptions(const TranscriptionOptions& options) { m_options = options; }
+    TranscriptionOptions transcriptionOptions() const { return m_options; }
+
     Q_INVOKABLE bool initModel(const QString& modelPath);
     Q_INVOKABLE void transcribe(const QString& audioPath);
     Q_INVOKABLE ComputeMode getComputeMode() const { return m_computeMode; }
     Q_INVOKABLE SystemCapabilities getSystemCapabilities() const { return m_capabilities; }
 
+    // Thread-safe. Stops the running (or next) transcribe() at the next decode
+    // packet, whisper compute step or streaming window. Segments emitted so far
+    // are kept and reported by transcriptionCancelled(). The request stays
+    // raised until resetCancel(), which owners call before queuing new work.
+    void requestCancel();
+    void resetCancel() { m_cancelRequested = false; }
+    bool isCancelRequested() const { return m_cancelRequested; }
+
+    // Thread-safe. Cores kept free of inference, e.g. for playback and the UI.
+    // Streaming picks it up at the next window, other paths at their next start.
+    void setReservedCores(int cores) { m_reservedCores = qMax(0, cores); }
+
     QString getLastError() const { return m_lastError; }
     float getAudioDuration() const { return m_audioDuration; }
 
@@ -54,29 +113,78 @@ signals:
     void transcriptionProgress(int progress);
     void transcriptionCompleted(const QString& text);
     void transcriptionFailed(const QString& error);
+    void transcriptionCancelled(const QString& partialText, int segmentCount);
     void logMessage(const QString& message);
     void modelLoaded(bool success, const QString& message);
     void computeModeDetected(const QString& mode, const QString& details);
     void segmentTranscribed(const QString& segmentText);
+    // Same segment as segmentTranscribed, already parsed.
+    void segmentReady(qint64 startMs, qint64 endMs, const QString& text);
+    void modelCacheStatsChanged(int hits, int misses, qint64 lastLoadMs);
 
 private:
+    std::shared_ptr<whisper_context> m_model;
     struct whisper_context* m_ctx;
+    struct whisper_state* m_state;
+    QString m_modelPath;
+    QDateTime m_modelModified;
     QString m_lastError;
     ComputeMode m_computeMode;
     SystemCapabilities m_capabilities;
     AudioConverter* m_audioConverter;
+    AudioDecodeService* m_decodeService;
     float m_audioDuration;
+    TranscriptionOptions m_options;
+    std::vector<VoiceActivityDetector::Span> m_speechSpans;
+    std::atomic<bool> m_cancelRequested;
+    std::atomic<qint64> m_cancelRequestedAtMs;
+    std::atomic<int> m_reservedCores;
+    TranscriptionJournal m_journal;
+    int64_t m_resumeCs;
+    QByteArray m_resumePrompt;
 
     SystemCapabilities detectSystemCapabilities();
+    SystemCapabilities cachedSystemCapabilities();
+    bool acquireModel(const QString& modelPath, bool useGpu);
+    void reportModelCacheStats();
     bool checkCudaRuntime(QString& version);
     bool checkNvidiaGpu(QString& gpuName);
     bool tryInitWithGpu(const QString& modelPath, QString& errorMsg);
     bool tryInitWithCpu(const QString& modelPath, QString& errorMsg);
     QString formatCapabilities(const SystemCapabilities& caps);
-    bool loadAndConvertAudio(const QString& audioPath, std::vector<float>& audioData);
+    bool loadAndConvertAudio(const QString& audioPath, std::shared_ptr<const std::vector<float>>& audioData);
+    bool loadSharedAudio(const QString& audioPath, std::shared_ptr<const std::vector<float>>& audioData);
     bool needsConversion(const QString& filePath);
     bool readWavFile(const QString& path, std::vector<float>& audio);
+    void transcribeStreaming(const QString& audioPath);
+    bool transcribeSingle(const std::vector<float>& audio, size_t startSample, QString& result, int& segmentCount);
+    bool transcribeParallel(const std::vector<float>& audio, size_t startSample, int stateCount, QString& result, int& segmentCount);
+    void runBaselineBenchmark(const std::vector<float>& audio, qint64 elapsedMs);
+    int64_t toSourceCs(int64_t cs, bool isStart) const;
+    int planParallelStates(size_t sampleCount) const;
+    bool prefersParallel(const QString& audioPath);
+    int threadBudget() const;
+    int threadsPerState(int stateCount) const;
+    struct whisper_full_params defaultFullParams(int threads);
+    void emitSegment(int64_t t0, int64_t t1, const QString& text, bool journal = true);
+    int64_t resumeFromJournal(const QString& audioPath, QString& result, int& segmentCount);
+    void reportJournalOverhead(qint64 elapsedMs);
+    void finishCancelled(const QString& partialText, int segmentCount);
+
+    // whisper_full and its results on the private state when one is in use,
+    // otherwise on the context's default state.
+    int runFull(struct whisper_full_params params, const float* samples, int count);
+    void releaseState();
+    int fullSegmentCount() const;
+    int64_t fullSegmentT0(int index) const;
+    int64_t fullSegmentT1(int index) const;
+    QString fullSegmentText(int index) const;
+
+    static QMutex s_capabilitiesMutex;
+    static bool s_capabilitiesDetected;
+    static SystemCapabilities s_capabilities;
 
+    static bool abortCallback(void* user_data);
     static void newSegmentCallback(struct whisper_context* ctx, struct whisper_state* state, int n_new, void* user_data);
 };
 